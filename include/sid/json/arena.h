@@ -0,0 +1,117 @@
+/*
+LICENSE: BEGIN
+===============================================================================
+@author Shan Anand
+@email anand.gs@gmail.com
+@source https://github.com/shan-anand
+@brief Json handling using c++
+===============================================================================
+MIT License
+
+Copyright (c) 2017 Shanmuga (Anand) Gunasekaran
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+===============================================================================
+LICENSE: END
+*/
+
+#pragma once
+
+#include <memory_resource>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace sid::json {
+
+/**
+ * @class arena
+ * @brief Monotonic memory resource for whole documents (see parser_output::memory)
+ *
+ * Memory is handed out from large chunks and is not freed one allocation at a time. Rewinding
+ * the arena makes all of it available again at once, keeping the chunks for the next document.
+ * Small blocks that are given back, like the storage of a container that grows, are handed out
+ * again for the same size. An arena must not be used by two threads at the same time.
+ */
+class arena : public std::pmr::memory_resource
+{
+public:
+  //! Size of the first chunk. Each chunk is twice as big as the previous one, up to max_chunk_size.
+  static constexpr size_t default_chunk_size = 1 << 20;
+  static constexpr size_t max_chunk_size = 64 << 20;
+  //! Largest block that is reused once it is given back
+  static constexpr size_t small_size = 1024;
+
+  /**
+   * @fn arena
+   * @brief Create an arena without chunks
+   * @param _upstream resource of the chunks. nullptr for the global heap, or for huge pages.
+   * @param _hugePages back the chunks with transparent huge pages when there is no _upstream
+   * @param _chunkSize size of the first chunk
+   */
+  explicit arena(
+    std::pmr::memory_resource* _upstream = nullptr,
+    const bool                 _hugePages = false,
+    const size_t               _chunkSize = default_chunk_size
+  );
+  arena(const arena&) = delete;
+  arena& operator=(const arena&) = delete;
+  ~arena() override;
+
+  //! Make all the memory available again. The chunks are kept.
+  void rewind();
+  //! Give the chunks back
+  void release();
+
+  //! Number of chunks taken since the arena was created
+  uint64_t chunk_allocations() const { return m_allocations; }
+  //! Bytes handed out since the arena was rewound
+  size_t used() const;
+  //! Bytes of all the chunks
+  size_t capacity() const;
+
+protected:
+  void* do_allocate(size_t _bytes, size_t _alignment) override;
+  void do_deallocate(void* _ptr, size_t _bytes, size_t _alignment) override;
+  bool do_is_equal(const std::pmr::memory_resource& _other) const noexcept override { return this == &_other; }
+
+private:
+  struct chunk
+  {
+    char*  begin;
+    size_t size;
+  };
+  //! Move to the next chunk with room for the allocation, taking a new one if there is none
+  void next_chunk(const size_t _bytes, const size_t _alignment);
+  chunk allocate_chunk(const size_t _size);
+  void free_chunk(const chunk& _chunk);
+
+  std::pmr::memory_resource* m_upstream;
+  bool                       m_hugePages;
+  size_t                     m_chunkSize;
+  std::vector<chunk>         m_chunks;
+  size_t                     m_current;     //! Chunk being handed out
+  char*                      m_pos;         //! Next free byte of the current chunk
+  char*                      m_end;         //! End of the current chunk
+  uint64_t                   m_allocations;
+  //! Blocks given back, by size in pointers. Each one starts with a pointer to the next one.
+  void*                      m_free[small_size / sizeof(void*) + 1];
+}; // class arena
+
+} // namespace sid::json
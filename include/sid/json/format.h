@@ -51,12 +51,17 @@ struct format
   uint32_t    indent;
   bool        key_no_quotes;
   bool        string_no_quotes;
+  bool        escape_unicode; //! Write the characters that are not ASCII as \u escapes
+  bool        sort_keys;      //! Write the members of objects in key order instead of the order
+                              //!   they are stored in
 
   format() :
     type(format_type::compact), separator(' '),
     indent(2),
     key_no_quotes(false),
-    string_no_quotes(false)
+    string_no_quotes(false),
+    escape_unicode(false),
+    sort_keys(false)
     {}
   format(
     const format_type& _type,
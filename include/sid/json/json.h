@@ -33,10 +33,18 @@ LICENSE: END
 
 #pragma once
 
+#include "parse_error.h"
 #include "parser_control.h"
 #include "parser_stats.h"
 #include "format.h"
+#include "arena.h"
+#include "key.h"
+#include "object.h"
 #include "value.h"
+#include "lazy_document.h"
+#include "push_parser.h"
+#include "reader.h"
+#include "sax_handler.h"
 #include "schema.h"
 
 namespace sid::json {
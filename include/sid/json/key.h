@@ -0,0 +1,173 @@
+/*
+LICENSE: BEGIN
+===============================================================================
+@author Shan Anand
+@email anand.gs@gmail.com
+@source https://github.com/shan-anand
+@brief Json handling using c++
+===============================================================================
+MIT License
+
+Copyright (c) 2017 Shanmuga (Anand) Gunasekaran
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+===============================================================================
+LICENSE: END
+*/
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <atomic>
+#include <iosfwd>
+#include <cstddef>
+#include <cstdint>
+
+namespace sid::json {
+
+//! Forward declaration of the memory arena of documents (see arena.h)
+class arena;
+
+/**
+ * @class key
+ * @brief Key of an object member
+ *
+ * A key is 16 bytes. A key of up to 15 characters is stored in the key itself. A longer key is
+ * stored once out of line and shared by its copies, and by all the keys interned from the same
+ * characters (see key_table). The characters of a key cannot be changed.
+ */
+class key
+{
+public:
+  //! Longest key that is stored in place
+  static constexpr size_t short_capacity = 15;
+
+  key() noexcept : m_size(0) {}
+  explicit key(const std::string_view _str);
+  explicit key(const std::string& _str) : key(std::string_view(_str)) {}
+  explicit key(const char* _str) : key(std::string_view(_str)) {}
+  //! A long key is stored in the arena. A copy of it is stored on the heap.
+  key(const std::string_view _str, arena& _arena);
+  key(const key& _key);
+  key(key&& _key) noexcept;
+  ~key() { if ( is_shared() ) release(); }
+  key& operator=(const key& _key);
+  key& operator=(key&& _key) noexcept;
+
+  size_t size() const { return is_shared()? m_entry->size : m_size; }
+  bool empty() const { return m_size == 0; }
+  const char* data() const { return is_shared()? m_entry->chars : short_str(); }
+  std::string_view view() const { return std::string_view(data(), size()); }
+  operator std::string_view() const { return view(); }
+  std::string str() const { return std::string(view()); }
+  //! true if the characters are stored out of line, and shared by the copies of the key
+  bool is_shared() const { return m_size == shared_size; }
+  //! hash of the characters, which is std::hash<std::string_view>
+  size_t hash() const;
+
+  friend bool operator==(const key& _a, const key& _b)
+  {
+    return ( _a.is_shared() && _b.is_shared() && _a.m_entry == _b.m_entry ) || _a.view() == _b.view();
+  }
+  friend bool operator==(const key& _a, const std::string_view _b) { return _a.view() == _b; }
+  friend bool operator==(const std::string_view _a, const key& _b) { return _a == _b.view(); }
+  friend bool operator!=(const key& _a, const key& _b) { return !( _a == _b ); }
+  friend bool operator!=(const key& _a, const std::string_view _b) { return _a.view() != _b; }
+  friend bool operator!=(const std::string_view _a, const key& _b) { return _a != _b.view(); }
+  friend bool operator<(const key& _a, const key& _b) { return _a.view() < _b.view(); }
+  friend bool operator<(const key& _a, const std::string_view _b) { return _a.view() < _b; }
+  friend bool operator<(const std::string_view _a, const key& _b) { return _a < _b.view(); }
+
+private:
+  friend class key_table;
+
+  //! Characters of a long key, with the number of keys sharing them (none in an arena)
+  struct entry
+  {
+    std::atomic<uint32_t> refs;
+    uint32_t              size;
+    size_t                hash;
+    char                  chars[1];
+  };
+  //! m_size of a key stored out of line
+  static constexpr uint8_t shared_size = 0xFF;
+
+  //! Characters of a short key
+  char* short_str() { return reinterpret_cast<char*>(this); }
+  const char* short_str() const { return reinterpret_cast<const char*>(this); }
+  //! Entry of a long key, with one reference. It has none in an arena.
+  static entry* new_entry(const std::string_view _str, arena* _arena);
+  //! Drop the reference to the entry
+  void release() noexcept;
+
+  union
+  {
+    entry* m_entry;                       //! Characters of a long key
+    char   m_head[sizeof(entry*)];        //! Start of a short key
+  };
+  char    m_tail[short_capacity - sizeof(entry*)]; //! Rest of a short key
+  uint8_t m_size;                         //! Length of a short key, or shared_size
+}; // class key
+
+std::ostream& operator<<(std::ostream& _out, const key& _key);
+
+/**
+ * @class key_table
+ * @brief Keys interned for sharing among the members of one or more documents
+ *
+ * Keys that are too long to be stored in place are looked up by their characters. The same
+ * characters give a key sharing the same storage, so repeated keys take memory only once.
+ * A table must not be used by two threads at the same time. The keys it gives can.
+ */
+class key_table
+{
+public:
+  //! Number of keys after which new ones are no longer interned
+  static constexpr size_t default_max_size = 65536;
+
+  explicit key_table(const size_t _maxSize = default_max_size) : m_size(0), m_maxSize(_maxSize) {}
+
+  /**
+   * @fn intern
+   * @brief Set a key to the given characters, shared with the table if it is long
+   * @param _key key to set
+   * @param _str characters of the key
+   * @return true if memory was allocated for it
+   */
+  bool intern(key& _key, const std::string_view _str);
+  //! Key of the given characters, shared with the table if it is long
+  key intern(const std::string_view _str);
+
+  //! Number of keys in the table
+  size_t size() const { return m_size; }
+  //! Forget the keys. Their storage is freed when no member uses it any more.
+  void clear();
+
+private:
+  //! Double the slots, keeping at most half of them used
+  void grow();
+
+  std::vector<key> m_slots;   //! Open addressing hash table. An empty key is a free slot.
+  size_t           m_size;
+  size_t           m_maxSize;
+}; // class key_table
+
+} // namespace sid::json
@@ -0,0 +1,149 @@
+/*
+LICENSE: BEGIN
+===============================================================================
+@author Shan Anand
+@email anand.gs@gmail.com
+@source https://github.com/shan-anand
+@brief Json handling using c++
+===============================================================================
+MIT License
+
+Copyright (c) 2017 Shanmuga (Anand) Gunasekaran
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+===============================================================================
+LICENSE: END
+*/
+
+#pragma once
+
+#include "value.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+
+namespace sid::json {
+
+/**
+ * @class lazy_value
+ * @brief A value of a lazy_document. The members of an object or array are parsed when one of
+ *        them is first accessed. Then its scalar members are decoded, and its nested objects and
+ *        arrays are only located in the input until they are accessed.
+ *
+ * The first access to the members of an object or array changes the value. So, a lazy_value
+ * must not be used by more than one thread at a time.
+ */
+class lazy_value
+{
+public:
+  //! Default constructor (null)
+  lazy_value();
+  ~lazy_value();
+  lazy_value(lazy_value&&) noexcept;
+  lazy_value& operator=(lazy_value&&) noexcept;
+  lazy_value(const lazy_value&) = delete;
+  lazy_value& operator=(const lazy_value&) = delete;
+
+  //! get the value_type
+  value_type type() const { return m_type; }
+  //! value_type check as functions
+  bool is_null() const { return m_type == value_type::null; }
+  bool is_string() const { return m_type == value_type::string; }
+  bool is_signed() const { return m_type == value_type::_signed; }
+  bool is_unsigned() const { return m_type == value_type::_unsigned; }
+  bool is_decimal() const { return is_signed() || is_unsigned(); }
+  bool is_double() const { return m_type == value_type::_double; }
+  bool is_num() const { return is_decimal() || is_double(); }
+  bool is_bool() const { return m_type == value_type::boolean; }
+  bool is_array() const { return m_type == value_type::array; }
+  bool is_object() const { return m_type == value_type::object; }
+
+  bool has_index(const size_t _index) const;
+  bool has_key(const std::string& _key) const;
+  std::vector<std::string> get_keys() const;
+  size_t size() const; // For array and object type
+
+  //! get the scalar value. They throw std::exception for other types, like value does.
+  int64_t get_int64() const { return m_scalar.get_int64(); }
+  uint64_t get_uint64() const { return m_scalar.get_uint64(); }
+  long double get_double() const { return m_scalar.get_double(); }
+  bool get_bool() const { return m_scalar.get_bool(); }
+  std::string get_str() const { return m_scalar.get_str(); }
+
+  //! get the member. They throw std::exception if it does not exist.
+  const lazy_value& operator[](const size_t _index) const;
+  const lazy_value& operator[](const std::string& _key) const;
+
+  //! get the json text of an object or array as it is in the input (empty for the other types,
+  //! and for the array of the values of a duplicate key with dup_key::append)
+  std::string_view text() const { return m_text; }
+  //! decode all of it into a value. Throws std::exception if parsing fails.
+  value to_value() const;
+
+private:
+  friend class lazy_document;
+  struct members;
+  //! Constructor for an object or array that is not parsed yet
+  lazy_value(const value_type _type, const std::string_view _text, const char* _origin,
+             const parser_control* _ctrl);
+  //! Parse the members if it is not done yet. Throws std::exception if parsing fails.
+  const members& get_members() const;
+  //! Apply the duplicate key policy of m_ctrl to a later value of the key of _existing
+  void add_duplicate(lazy_value& _existing, lazy_value&& _jval) const;
+
+private:
+  value_type                       m_type;
+  value                            m_scalar;  //! Value of a scalar
+  std::string_view                 m_text;    //! Input of an object or array
+  const char*                      m_origin;  //! Start of the input, for the error locations
+  const parser_control*            m_ctrl;
+  mutable std::unique_ptr<members> m_members; //! Members, once parsed
+};
+
+/**
+ * @class lazy_document
+ * @brief A json file whose values are decoded only when they are accessed (see
+ *        value::parse_file with a lazy_document). It keeps the file mapped in memory.
+ */
+class lazy_document
+{
+public:
+  lazy_document();
+  ~lazy_document();
+  lazy_document(const lazy_document&) = delete;
+  lazy_document& operator=(const lazy_document&) = delete;
+
+  //! The root object or array
+  const lazy_value& root() const { return m_root; }
+  const lazy_value& operator[](const size_t _index) const { return m_root[_index]; }
+  const lazy_value& operator[](const std::string& _key) const { return m_root[_key]; }
+
+private:
+  friend class value;
+  struct impl;
+  //! Map the file and check it. Throws std::exception if it fails.
+  void open(const std::string& _filePath, const parser_control& _ctrl);
+
+private:
+  std::unique_ptr<impl> m_impl;
+  lazy_value            m_root;
+};
+
+} // namespace sid::json
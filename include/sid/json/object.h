@@ -0,0 +1,233 @@
+/*
+LICENSE: BEGIN
+===============================================================================
+@author Shan Anand
+@email anand.gs@gmail.com
+@source https://github.com/shan-anand
+@brief Json handling using c++
+===============================================================================
+MIT License
+
+Copyright (c) 2017 Shanmuga (Anand) Gunasekaran
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+===============================================================================
+LICENSE: END
+*/
+
+#pragma once
+
+#include "key.h"
+#include <iterator>
+#include <memory_resource>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <cstddef>
+#include <cstdint>
+
+namespace sid::json {
+
+//! Forward declaration of json value
+class value;
+
+//! Storage layout of the members of an object
+enum class object_layout : uint8_t {
+  ordered, //! In the order they are added. Searched one by one, and through a hash index past
+           //!   object::small_size members. Erasing a member keeps the order of the others.
+           //!   The members are never moved, so references to them stay valid until they are
+           //!   erased.
+  flat,    //! In one allocation. Searched one by one. Sorted by key once there are more than
+           //!   object::small_size members, and kept sorted.
+  hash     //! In one allocation. Always found through a hash index. Erasing a member moves the last
+           //!   one to its place.
+};
+
+/**
+ * @class object
+ * @brief Members of a json object
+ *
+ * The storage of an object is a single allocation, followed by the open addressing hash index
+ * of the layouts that use one. The flat and hash layouts store the members in it, so that like
+ * a vector, adding or erasing a member may move the others. The ordered layout stores pointers
+ * to the members in it instead. Its members are allocated in chunks, one for each time the
+ * storage grows, and are not moved until they are erased. An object without members allocates
+ * nothing.
+ */
+class object
+{
+public:
+  //! Key and value of a member. The key must not be changed through an iterator.
+  using member = std::pair<key, value>;
+
+  //! Random access iterator over the members, in the order they are stored
+  template <typename T> class basic_iterator
+  {
+  public:
+    using iterator_category = std::random_access_iterator_tag;
+    using value_type = member;
+    using difference_type = std::ptrdiff_t;
+    using pointer = T*;
+    using reference = T&;
+
+    basic_iterator() noexcept : m_ptr(nullptr), m_entry(nullptr) {}
+    //! An iterator converts to a const_iterator
+    template <typename U, typename = std::enable_if_t<std::is_same_v<const U, T>>>
+    basic_iterator(const basic_iterator<U>& _it) noexcept : m_ptr(_it.m_ptr), m_entry(_it.m_entry) {}
+
+    reference operator*() const { return m_entry? **m_entry : *m_ptr; }
+    pointer operator->() const { return &**this; }
+    reference operator[](const difference_type _n) const { return *(*this + _n); }
+
+    basic_iterator& operator+=(const difference_type _n)
+    {
+      if ( m_entry ) m_entry += _n; else m_ptr += _n;
+      return *this;
+    }
+    basic_iterator& operator-=(const difference_type _n) { return *this += -_n; }
+    basic_iterator& operator++() { return *this += 1; }
+    basic_iterator& operator--() { return *this -= 1; }
+    basic_iterator operator++(int) { basic_iterator it(*this); *this += 1; return it; }
+    basic_iterator operator--(int) { basic_iterator it(*this); *this -= 1; return it; }
+    basic_iterator operator+(const difference_type _n) const { basic_iterator it(*this); return it += _n; }
+    basic_iterator operator-(const difference_type _n) const { basic_iterator it(*this); return it -= _n; }
+    friend basic_iterator operator+(const difference_type _n, const basic_iterator& _it) { return _it + _n; }
+    difference_type operator-(const basic_iterator& _it) const
+    {
+      return m_entry? m_entry - _it.m_entry : m_ptr - _it.m_ptr;
+    }
+
+    bool operator==(const basic_iterator& _it) const { return m_ptr == _it.m_ptr && m_entry == _it.m_entry; }
+    bool operator!=(const basic_iterator& _it) const { return ! (*this == _it); }
+    bool operator<(const basic_iterator& _it) const { return (*this - _it) < 0; }
+    bool operator>(const basic_iterator& _it) const { return _it < *this; }
+    bool operator<=(const basic_iterator& _it) const { return ! (_it < *this); }
+    bool operator>=(const basic_iterator& _it) const { return ! (*this < _it); }
+
+  private:
+    friend class object;
+    template <typename> friend class basic_iterator;
+    basic_iterator(T* _ptr, member* const* _entry) noexcept : m_ptr(_ptr), m_entry(_entry) {}
+
+    T*             m_ptr;   //! Member of the flat and hash layouts
+    member* const* m_entry; //! Pointer to the member of the ordered layout
+  }; // class basic_iterator
+
+  using iterator = basic_iterator<member>;
+  using const_iterator = basic_iterator<const member>;
+
+  //! Number of members up to which the ordered and flat layouts search them one by one
+  static constexpr size_t small_size = 16;
+  //! Layout of the objects that are not given one. It is ordered unless the library is
+  //! configured with another SID_JSON_OBJECT_LAYOUT.
+  static object_layout default_layout();
+
+  explicit object(const object_layout _layout = default_layout()) noexcept;
+  //! An object whose storage is allocated from the resource. Its copies use the heap.
+  object(const object_layout _layout, std::pmr::memory_resource* _resource);
+  object(const object& _obj);
+  object(object&& _obj) noexcept;
+  ~object();
+  object& operator=(const object& _obj);
+  object& operator=(object&& _obj) noexcept;
+
+  object_layout layout() const { return m_block->layout; }
+  size_t size() const { return m_block->size; }
+  bool empty() const { return m_block->size == 0; }
+  size_t capacity() const { return m_block->capacity; }
+  //! true if the members are in key order
+  bool is_sorted() const;
+
+  iterator begin();
+  iterator end();
+  const_iterator begin() const;
+  const_iterator end() const;
+
+  iterator find(const std::string_view _key);
+  const_iterator find(const std::string_view _key) const;
+  bool contains(const std::string_view _key) const { return lookup(_key) != size(); }
+
+  //! Add a member with a null value, or find the existing one. The bool is true if it is added.
+  std::pair<iterator, bool> try_emplace(const std::string_view _key);
+  //! Add a member with a null value. The key must not be in the object already.
+  iterator add(key&& _key);
+  //! Value of the key. A member with a null value is added if there is none.
+  value& operator[](const std::string_view _key);
+
+  //! Erase the member of the key. Returns the number of members erased.
+  size_t erase(const std::string_view _key);
+  //! Erase a member. Returns the position of the member that took its place.
+  iterator erase(const_iterator _pos);
+  //! Erase all the members. The storage is kept.
+  void clear();
+  void reserve(const size_t _size);
+
+private:
+  //! Alignment of the members, which is the alignment of a value (see value::number_t)
+#ifdef SID_JSON_LONG_DOUBLE
+  static constexpr size_t member_alignment = alignof(long double);
+#else
+  static constexpr size_t member_alignment = alignof(double);
+#endif
+  //! Header of a chunk of members of an ordered object, followed by the members
+  struct alignas(member_alignment) chunk
+  {
+    chunk*   next;
+    uint32_t count;
+  };
+  //! Header of the allocation, followed by the members (or the pointers to them) and the hash
+  //! index. It is padded so that the members that follow it are aligned.
+  struct alignas(member_alignment) block
+  {
+    uint32_t      size;
+    uint32_t      capacity;
+    uint32_t      mask;     //! Number of hash index slots less one. 0 if there is no index.
+    object_layout layout;
+    bool          sorted;   //! The members of a flat object are in key order
+    std::pmr::memory_resource* resource; //! Where the block is allocated. nullptr for the heap.
+    chunk*        chunks;   //! Chunks of the members of an ordered object, the last one first
+  };
+  //! Blocks of no capacity, one for each layout, shared by the objects without members
+  static block s_empty[3];
+
+  //! The members of the flat and hash layouts
+  member* members() const;
+  //! The pointers to the members of the ordered layout, followed by the free places
+  member** entries() const;
+  //! The member at the position, or the place for it
+  member* entry(const size_t _pos) const;
+  //! Slot i of the index is the position of a member plus one, or 0 if it is free
+  uint32_t* slots() const;
+  static size_t block_bytes(const object_layout _layout, const size_t _capacity, const size_t _slotCount);
+  size_t lookup(const std::string_view _key) const;
+  void grow(const size_t _capacity);
+  void index_insert(const size_t _pos);
+  void index_erase(const size_t _pos);
+  void rebuild_index();
+  //! false for the shared blocks of no capacity
+  bool has_storage() const { return m_block->capacity != 0 || m_block->resource != nullptr; }
+  static void free_block(block* _block);
+  static void free_chunks(chunk* _chunk, std::pmr::memory_resource* _resource);
+  void destroy();
+
+  block* m_block;
+}; // class object
+
+} // namespace sid::json
@@ -0,0 +1,87 @@
+/*
+LICENSE: BEGIN
+===============================================================================
+@author Shan Anand
+@email anand.gs@gmail.com
+@source https://github.com/shan-anand
+@brief Json handling using c++
+===============================================================================
+MIT License
+
+Copyright (c) 2017 Shanmuga (Anand) Gunasekaran
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+===============================================================================
+LICENSE: END
+*/
+
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+namespace sid::json {
+
+/**
+ * @struct parse_error
+ * @brief Error returned by the parsers that do not throw (see value::try_parse). Only the code and
+ *        the position are kept. The message is formatted when it is asked for.
+ */
+struct parse_error
+{
+  enum class code : uint8_t {
+    none = 0,
+    invalid_schema,      //! The schema cannot be used for validation
+    end_of_data,         //! The input ends before the root is closed
+    expected_root,       //! The root is not an object or an array
+    expected_colon,      //! No : after an object key
+    expected_key,        //! A } after a ,
+    expected_element,    //! A ] after a ,
+    expected_value,      //! No value where one is expected
+    expected_separator,  //! No , or closing bracket after a value
+    trailing_data,       //! Something other than spaces and comments after the root
+    max_depth,           //! Deeper nesting than parser_control::maxDepth
+    duplicate_key,       //! A repeated key with parser_control::dup_key::reject
+    invalid_string,      //! A string that does not start with " or has an unescaped "
+    invalid_escape,      //! An unknown escape sequence in a string
+    invalid_unicode,     //! A \u escape without 4 hexadecimal digits or with an unpaired surrogate
+    invalid_utf8,        //! A string that is not valid UTF-8 (parser_control::checkUtf8)
+    invalid_value,       //! Not a string, a number, true, false or null
+    invalid_number,      //! A number with a missing digit or a leading zero
+    number_out_of_range, //! A number too large for a double
+    invalid_comment,     //! A comment that is not closed, or a / that starts no comment
+    unsupported_mode,    //! A parsing mode that cannot be used for the operation
+    schema_violation     //! A value that does not match the schema
+  };
+
+  code     id;     //! What went wrong (code::none if nothing)
+  uint64_t offset; //! Input bytes before the position of the error
+
+  parse_error() : id(code::none), offset(0) {}
+
+  explicit operator bool() const { return id != code::none; }
+  void clear() { id = code::none; offset = 0; }
+  //! description of the error with its offset
+  std::string message() const;
+
+  //! description of an error code
+  static const char* to_str(const code _code);
+};
+
+} // namespace sid::json
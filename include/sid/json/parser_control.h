@@ -33,6 +33,7 @@ LICENSE: END
 
 #pragma once
 
+#include "object.h"
 #include <string>
 #include <cstdint>
 
@@ -74,15 +75,30 @@ struct parser_control
     parse_mode(uint8_t _flags = 0) : flags(_flags) {}
   };
 
+  //! Default maximum nesting depth of objects and arrays
+  static constexpr uint32_t default_max_depth = 1024;
+
   //! Members
-  parse_mode mode;    //! Parser control modes
-  dup_key    dupKey;  //! Duplicate key handling
+  parse_mode mode;     //! Parser control modes
+  dup_key    dupKey;   //! Duplicate key handling
+  uint32_t   maxDepth; //! Maximum nesting depth of objects and arrays. 0 for no limit.
+                       //!   The parser itself does not recurse, but copying, formatting and
+                       //!   destroying the parsed value do.
+  bool       checkUtf8; //! Reject keys and strings that are not valid UTF-8. The \u escapes
+                        //!   are always decoded to valid UTF-8.
+  object_layout objectLayout; //! Storage layout of the parsed objects
+  bool       stopWhenFound; //! When parsing only some paths, stop as soon as the values of all the
+                            //!   paths without a wildcard are parsed. Later duplicate keys and the
+                            //!   rest of the input are not checked.
 
   //! Default constructor
   parser_control(
     const dup_key&    _dupKey = dup_key::overwrite,
-    const parse_mode& _mode = parse_mode()
-    ) : mode(_mode), dupKey(_dupKey)
+    const parse_mode& _mode = parse_mode(),
+    const uint32_t    _maxDepth = default_max_depth,
+    const bool        _checkUtf8 = false
+    ) : mode(_mode), dupKey(_dupKey), maxDepth(_maxDepth), checkUtf8(_checkUtf8),
+        objectLayout(object::default_layout()), stopWhenFound(false)
     {}
 };
 
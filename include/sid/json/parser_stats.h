@@ -41,6 +41,7 @@ namespace sid::json {
 struct parser_stats
 {
   size_t   data_size;
+  uint64_t documents;
   uint64_t objects;
   uint64_t arrays;
   uint64_t strings;
@@ -48,10 +49,13 @@ struct parser_stats
   uint64_t booleans;
   uint64_t nulls;
   uint64_t keys;
+  uint64_t allocations; //! Memory allocations made for the document's strings, arrays and objects
   uint64_t time_ms;
 
   parser_stats();
   void clear();
+  //! Add the statistics of another document
+  parser_stats& operator+=(const parser_stats& _stats);
   std::string to_string() const;
 };
 
@@ -0,0 +1,89 @@
+/*
+LICENSE: BEGIN
+===============================================================================
+@author Shan Anand
+@email anand.gs@gmail.com
+@source https://github.com/shan-anand
+@brief Json handling using c++
+===============================================================================
+MIT License
+
+Copyright (c) 2017 Shanmuga (Anand) Gunasekaran
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+===============================================================================
+LICENSE: END
+*/
+
+#pragma once
+
+#include "value.h"
+#include <string>
+#include <memory>
+
+namespace sid::json {
+
+/**
+ * @class push_parser
+ * @brief json parser for input that arrives in chunks
+ *
+ * Each chunk is parsed as it is fed. Input that ends within a token (a string, a number, an
+ * escape sequence or a comment) is kept until the rest of it arrives, so only the unparsed tail
+ * of the input is held in memory. The output is filled the same way as value::parse() does.
+ */
+class push_parser
+{
+public:
+  /**
+   * @fn push_parser
+   * @brief Constructor. The output is cleared.
+   * @param _out output data. It must outlive the parser.
+   * @param _ctrl parser control flags
+   */
+  push_parser(parser_output& _out, const parser_control& _ctrl = parser_control());
+  ~push_parser();
+  push_parser(const push_parser&) = delete;
+  push_parser& operator=(const push_parser&) = delete;
+
+  /**
+   * @fn feed
+   * @brief parse the next chunk of the input
+   * @param _data chunk data. Only the part that cannot be parsed yet is copied.
+   * @param _len length of the chunk
+   * @throws std::exception if parsing fails. The parser cannot be used after that.
+   */
+  void feed(const char* _data, size_t _len);
+  void feed(const std::string& _data) { feed(_data.data(), _data.length()); }
+
+  /**
+   * @fn finish
+   * @brief parse the rest of the input once all of it is fed
+   * @throws std::exception if the input ends before the root object or array is closed
+   */
+  void finish();
+
+  //! The root object or array is closed
+  bool done() const;
+
+private:
+  struct impl;
+  std::unique_ptr<impl> m_impl;
+};
+
+} // namespace sid::json
@@ -0,0 +1,133 @@
+/*
+LICENSE: BEGIN
+===============================================================================
+@author Shan Anand
+@email anand.gs@gmail.com
+@source https://github.com/shan-anand
+@brief Json handling using c++
+===============================================================================
+MIT License
+
+Copyright (c) 2017 Shanmuga (Anand) Gunasekaran
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+===============================================================================
+LICENSE: END
+*/
+
+#pragma once
+
+#include "value.h"
+#include <string>
+#include <string_view>
+#include <streambuf>
+#include <istream>
+#include <memory>
+
+namespace sid::json {
+
+//! Type of the tokens given by reader
+enum class token_type : uint8_t {
+  end, start_object, end_object, start_array, end_array, string, _signed, _unsigned, _double, boolean, null
+};
+std::string to_str(const token_type& _type);
+
+/**
+ * @struct token
+ * @brief A token given by reader. The views are valid until the next call to the reader.
+ */
+struct token
+{
+  token_type       type;  //! Type of the token. token_type::end once the root is closed.
+  uint32_t         depth; //! Number of objects and arrays that enclose the token
+  std::string_view key;   //! Key of the member, for the tokens that start a member of an object
+  std::string_view str;   //! Value of a string
+  union
+  {
+    int64_t     i64;      //! Value of a signed number
+    uint64_t    u64;      //! Value of an unsigned number
+    long double dbl;      //! Value of a double number
+    bool        bval;     //! Value of a boolean
+  };
+  token() : type(token_type::end), depth(0), key(), str(), dbl(0) {}
+};
+
+/**
+ * @class reader
+ * @brief Pull parser. Each call to next() parses the input up to the next token, without
+ *        building a value.
+ *
+ * The input is checked the same way as value::parse() does, except for the contents of the
+ * objects and arrays passed to skip(). Keys and strings without escape sequences are views of the
+ * input if it is string data or a file.
+ */
+class reader
+{
+public:
+  /**
+   * @fn reader
+   * @brief Constructor for string data or a file. The input must outlive the reader.
+   * @param _in input string data, or the path of the input file
+   * @param _type type of _in
+   * @param _ctrl parser control flags. The duplicate key handling is not used.
+   * @throws std::exception if the input does not start with an object or array
+   */
+  reader(const std::string& _in, const input_type _type = input_type::data,
+         const parser_control& _ctrl = parser_control());
+  //! The data of a temporary string would not outlive the reader
+  reader(std::string&& _in, const input_type _type = input_type::data,
+         const parser_control& _ctrl = parser_control()) = delete;
+  /**
+   * @fn reader
+   * @brief Constructor for a stream buffer. The input must outlive the reader.
+   * @param _in stream buffer input
+   * @param _ctrl parser control flags. The duplicate key handling is not used.
+   * @throws std::exception if the input does not start with an object or array
+   */
+  reader(std::streambuf& _in, const parser_control& _ctrl = parser_control());
+  reader(std::istream& _in, const parser_control& _ctrl = parser_control())
+    : reader(*_in.rdbuf(), _ctrl) {}
+  ~reader();
+  reader(const reader&) = delete;
+  reader& operator=(const reader&) = delete;
+
+  /**
+   * @fn next
+   * @brief get the next token
+   * @param _token [out] the token
+   * @return false, with _token set to token_type::end, once the root is closed
+   * @throws std::exception if parsing fails. The reader cannot be used after that.
+   */
+  bool next(token& _token);
+
+  /**
+   * @fn skip
+   * @brief skip the rest of the object or array started by the last token, including its end.
+   *        The skipped values are not decoded. Only their strings and nesting are checked.
+   *        Nothing is skipped after the other tokens.
+   * @throws std::exception if parsing fails. The reader cannot be used after that.
+   */
+  void skip();
+
+private:
+  struct impl;
+  std::unique_ptr<impl> m_impl;
+};
+
+} // namespace sid::json
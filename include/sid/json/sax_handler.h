@@ -0,0 +1,68 @@
+/*
+LICENSE: BEGIN
+===============================================================================
+@author Shan Anand
+@email anand.gs@gmail.com
+@source https://github.com/shan-anand
+@brief Json handling using c++
+===============================================================================
+MIT License
+
+Copyright (c) 2017 Shanmuga (Anand) Gunasekaran
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+===============================================================================
+LICENSE: END
+*/
+
+#pragma once
+
+#include <string_view>
+#include <cstdint>
+
+namespace sid::json {
+
+/**
+ * @class sax_handler
+ * @brief Receives the events of a parse that builds no value (see value::parse with a
+ *        sax_handler). Every event returns false to stop parsing.
+ *
+ * Keys and strings without escape sequences are views of the input. The others are decoded into
+ * a buffer of the parser. Either way, a view is valid only during the call. Duplicate keys are
+ * given as they are, since no object is built to check them against.
+ */
+class sax_handler
+{
+public:
+  virtual ~sax_handler() = default;
+
+  virtual bool start_object() { return true; }
+  virtual bool key(std::string_view /*_key*/) { return true; }
+  virtual bool end_object() { return true; }
+  virtual bool start_array() { return true; }
+  virtual bool end_array() { return true; }
+  virtual bool string(std::string_view /*_val*/) { return true; }
+  virtual bool number(int64_t /*_val*/) { return true; }
+  virtual bool number(uint64_t /*_val*/) { return true; }
+  virtual bool number(long double /*_val*/) { return true; }
+  virtual bool boolean(bool /*_val*/) { return true; }
+  virtual bool null() { return true; }
+};
+
+} // namespace sid::json
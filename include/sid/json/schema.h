@@ -87,6 +87,11 @@ struct schema_types : public std::set<schema_type>
   void add(const value& _value);
   bool exists(const schema_type& _type) const { return this->find(_type) != this->end(); }
   void remove(const schema_type& _type) { this->erase(_type); }
+  //! check if a value of the type matches one of the types. Any type matches if there are none.
+  //! An integer matches number, but a double does not match integer.
+  bool allows(const json::value_type _type) const;
+  //! the name of the type, or a json array of the names if there are more
+  std::string to_string() const;
   value to_json() const;
 };
 
@@ -136,6 +141,9 @@ public:
     property();
     void clear();
     void set(const value& _jproperties, const std::string& _key);
+    //! check the type of a scalar value and the number or string constraints for it. Gets the
+    //! reason in _error if it does not match.
+    bool check(const value& _jval, std::string& _error) const;
     std::string to_string() const;
     value to_json() const;
   };
@@ -36,11 +36,19 @@ LICENSE: END
 #include "format.h"
 #include "parser_control.h"
 #include "parser_stats.h"
+#include "parse_error.h"
+#include "object.h"
+#include "arena.h"
 #include <string>
+#include <string_view>
 #include <vector>
-#include <map>
 #include <set>
+#include <memory>
+#include <memory_resource>
+#include <functional>
+#include <utility>
 #include <cstdint>
+#include <cstring>
 #include <stdexcept>
 
 namespace sid::json {
@@ -57,21 +65,36 @@ enum class input_type : uint8_t { data, file_path };
 class schema;
 //! Forward declaration of parser_output
 struct parser_output;
-
-#pragma pack(push)
-#pragma pack(1)
+//! Forward declaration of the storage pool of parser_output
+class value_pool;
+//! Forward declaration of the event handler (see sax_handler.h)
+class sax_handler;
+//! Forward declaration of the lazily decoded document (see lazy_document.h)
+class lazy_document;
+//! Forward declaration of the internal parser
+template <typename Derived, typename parser_input, typename pos_type> struct parser;
 
 /**
  * @class value
  * @brief json value class
+ *
+ * A value is 16 bytes. A string of up to 14 characters is stored in the value itself. Longer
+ * strings, arrays and the members of objects are stored out of line.
  */
 class value
 {
 public:
-  //! Array type definition
-  using array_t = std::vector<value>;
-  //! Object type definition
-  using object_t = std::map<std::string, value>;
+  //! Array type definition. The elements of a document parsed into an arena are allocated from
+  //! it (see parser_output::memory). A copy of an array uses the default resource, the heap.
+  using array_t = std::pmr::vector<value>;
+  //! Object type definition (see object_layout for the order of the members)
+  using object_t = object;
+  //! Storage of floating point numbers. long double makes every value 32 bytes.
+#ifdef SID_JSON_LONG_DOUBLE
+  using number_t = long double;
+#else
+  using number_t = double;
+#endif
 public:
   /**
    * @fn parse_file
@@ -126,6 +149,379 @@ public:
     const parser_control& _ctrl = parser_control()
   );
 
+  /**
+   * @fn parse
+   * @brief parse only the values of some paths of json string data. The objects and arrays on the
+   *        way to them are parsed with only the members on the paths. Array elements that are
+   *        skipped before one that is parsed are null, so that it keeps its index. The rest of
+   *        the input is skipped without decoding it, but is still read and checked to the end.
+   *        Parsing stops once the values of all the paths are parsed only if
+   *        parser_control::stopWhenFound is set and no path has a wildcard. Later duplicate keys
+   *        and the rest of the input are then not checked.
+   * @param _out output data
+   * @param _in input string data
+   * @param _paths JSON Pointers (RFC 6901) of the values, like /meta/id. A * step matches all the
+   *        members of an object or array, like /items/ * /price (without the spaces).
+   * @param _ctrl parser control flags
+   * @throws std::exception if parsing fails or if a path is invalid
+   */
+  static void parse(
+    parser_output&                  _out,
+    const std::string&              _in,
+    const std::vector<std::string>& _paths,
+    const parser_control&           _ctrl = parser_control()
+  );
+  /**
+   * @fn parse_file
+   * @brief parse only the values of some paths of a json file (see parse with _paths).
+   *        Stopping early requires parser_control::stopWhenFound.
+   * @param _out output data
+   * @param _filePath input json file
+   * @param _paths JSON Pointers of the values
+   * @param _ctrl parser control flags
+   * @throws std::exception if parsing fails or if a path is invalid
+   */
+  static void parse_file(
+    parser_output&                  _out,
+    const std::string&              _filePath,
+    const std::vector<std::string>& _paths,
+    const parser_control&           _ctrl = parser_control()
+  );
+  /**
+   * @fn parse
+   * @brief parse only the values of some paths of a json stream buffer (see parse with _paths).
+   *        Stopping early requires parser_control::stopWhenFound.
+   * @param _out output data
+   * @param _in stream buffer input
+   * @param _paths JSON Pointers of the values
+   * @param _ctrl parser control flags
+   * @throws std::exception if parsing fails or if a path is invalid
+   */
+  static void parse(
+    parser_output&                  _out,
+    std::streambuf&                 _in,
+    const std::vector<std::string>& _paths,
+    const parser_control&           _ctrl = parser_control()
+  );
+  /**
+   * @fn parse
+   * @brief parse only the values of some paths of a json input stream (see parse with _paths).
+   *        Stopping early requires parser_control::stopWhenFound.
+   * @param _out output data
+   * @param _in input stream
+   * @param _paths JSON Pointers of the values
+   * @param _ctrl parser control flags
+   * @throws std::exception if parsing fails or if a path is invalid
+   */
+  static void parse(
+    parser_output&                  _out,
+    std::istream&                   _in,
+    const std::vector<std::string>& _paths,
+    const parser_control&           _ctrl = parser_control()
+  );
+
+  /**
+   * @fn parse
+   * @brief parse json string data and validate it against a schema in the same pass. Parsing
+   *        fails at the first value that does not match the types and the number, string, array
+   *        and object constraints of its property. A container is checked for its required
+   *        members and minimum size when it is closed.
+   * @param _out output data
+   * @param _in input string data
+   * @param _schema schema to validate against
+   * @param _ctrl parser control flags
+   * @throws std::exception if parsing fails or if the data does not match the schema
+   */
+  static void parse(
+    parser_output&        _out,
+    const std::string&    _in,
+    const schema&         _schema,
+    const parser_control& _ctrl = parser_control()
+  );
+  /**
+   * @fn parse_file
+   * @brief parse a json file and validate it against a schema (see parse with _schema)
+   * @param _out output data
+   * @param _filePath input json file
+   * @param _schema schema to validate against
+   * @param _ctrl parser control flags
+   * @throws std::exception if parsing fails or if the data does not match the schema
+   */
+  static void parse_file(
+    parser_output&        _out,
+    const std::string&    _filePath,
+    const schema&         _schema,
+    const parser_control& _ctrl = parser_control()
+  );
+  /**
+   * @fn parse
+   * @brief parse a json stream buffer and validate it against a schema (see parse with _schema)
+   * @param _out output data
+   * @param _in stream buffer input
+   * @param _schema schema to validate against
+   * @param _ctrl parser control flags
+   * @throws std::exception if parsing fails or if the data does not match the schema
+   */
+  static void parse(
+    parser_output&        _out,
+    std::streambuf&       _in,
+    const schema&         _schema,
+    const parser_control& _ctrl = parser_control()
+  );
+  /**
+   * @fn parse
+   * @brief parse a json input stream and validate it against a schema (see parse with _schema)
+   * @param _out output data
+   * @param _in input stream
+   * @param _schema schema to validate against
+   * @param _ctrl parser control flags
+   * @throws std::exception if parsing fails or if the data does not match the schema
+   */
+  static void parse(
+    parser_output&        _out,
+    std::istream&         _in,
+    const schema&         _schema,
+    const parser_control& _ctrl = parser_control()
+  );
+
+  /**
+   * @fn try_parse
+   * @brief parse json string data without throwing for malformed data. Nothing is formatted or
+   *        thrown for the error. Parsing stops at the first one, which is returned with its offset.
+   *        Errors that are not about the data are still thrown, like std::bad_alloc, or
+   *        std::length_error for a key that is too long or an object with too many members.
+   * @param _out output data. It is partially filled if parsing fails.
+   * @param _in input string data
+   * @param _ctrl parser control flags
+   * @return the first error, which is false if there is none
+   * @throws std::exception for errors other than malformed data
+   */
+  static parse_error try_parse(
+    parser_output&        _out,
+    const std::string&    _in,
+    const parser_control& _ctrl = parser_control()
+  );
+  /**
+   * @fn try_parse
+   * @brief parse json stream buffer without throwing for malformed data (see try_parse). An
+   *        exception thrown by the stream buffer while reading, like an I/O error, is passed on.
+   * @param _out output data. It is partially filled if parsing fails.
+   * @param _in stream buffer input
+   * @param _ctrl parser control flags
+   * @return the first error, which is false if there is none
+   * @throws std::exception for errors other than malformed data
+   */
+  static parse_error try_parse(
+    parser_output&        _out,
+    std::streambuf&       _in,
+    const parser_control& _ctrl = parser_control()
+  );
+  /**
+   * @fn try_parse
+   * @brief parse json string data and validate it against a schema without throwing. A value
+   *        that does not match the schema is parse_error::code::schema_violation.
+   * @param _out output data. It is partially filled if parsing fails.
+   * @param _in input string data
+   * @param _schema schema to validate against
+   * @param _ctrl parser control flags
+   * @return the first error, which is false if there is none
+   * @throws std::exception for errors other than malformed data (see try_parse)
+   */
+  static parse_error try_parse(
+    parser_output&        _out,
+    const std::string&    _in,
+    const schema&         _schema,
+    const parser_control& _ctrl = parser_control()
+  );
+
+  /**
+   * @fn parse
+   * @brief parse json string data, calling the handler for every event instead of building
+   *        a value
+   * @param _handler receives the events
+   * @param _in input string data
+   * @param _ctrl parser control flags. The duplicate key handling is not used.
+   * @return statistics of the parsing
+   * @throws std::exception if parsing fails
+   */
+  static parser_stats parse(
+    sax_handler&          _handler,
+    const std::string&    _in,
+    const parser_control& _ctrl = parser_control()
+  );
+  /**
+   * @fn parse_file
+   * @brief parse json file, calling the handler for every event instead of building a value
+   * @param _handler receives the events
+   * @param _filePath input json file
+   * @param _ctrl parser control flags. The duplicate key handling is not used.
+   * @return statistics of the parsing
+   * @throws std::exception if parsing fails
+   */
+  static parser_stats parse_file(
+    sax_handler&          _handler,
+    const std::string&    _filePath,
+    const parser_control& _ctrl = parser_control()
+  );
+  /**
+   * @fn parse
+   * @brief parse json stream buffer, calling the handler for every event instead of building
+   *        a value
+   * @param _handler receives the events
+   * @param _in stream buffer input
+   * @param _ctrl parser control flags. The duplicate key handling is not used.
+   * @return statistics of the parsing
+   * @throws std::exception if parsing fails
+   */
+  static parser_stats parse(
+    sax_handler&          _handler,
+    std::streambuf&       _in,
+    const parser_control& _ctrl = parser_control()
+  );
+  /**
+   * @fn parse
+   * @brief parse json input stream, calling the handler for every event instead of building
+   *        a value
+   * @param _handler receives the events
+   * @param _in input stream
+   * @param _ctrl parser control flags. The duplicate key handling is not used.
+   * @return statistics of the parsing
+   * @throws std::exception if parsing fails
+   */
+  static parser_stats parse(
+    sax_handler&          _handler,
+    std::istream&         _in,
+    const parser_control& _ctrl = parser_control()
+  );
+
+  /**
+   * @fn parse_file
+   * @brief map a json file without decoding it. Its values are decoded when they are accessed.
+   *        Only the strings and the nesting are checked until then.
+   * @param _doc output document. It keeps the file mapped.
+   * @param _filePath input json file
+   * @param _ctrl parser control flags. Flexible parsing modes cannot be used. A duplicate key
+   *        gives the last value, or the first one with dup_key::ignore.
+   * @throws std::exception if parsing fails
+   */
+  static void parse_file(
+    lazy_document&        _doc,
+    const std::string&    _filePath,
+    const parser_control& _ctrl = parser_control()
+  );
+
+  //! Called for each document of multi-document input, with the document in _out.jroot and its
+  //! statistics in _out.stats. Return false to stop parsing.
+  using document_handler = std::function<bool(parser_output& _out)>;
+  /**
+   * @fn parse_file
+   * @brief parse a json file of multiple documents (like JSON Lines or RFC 7464 json-seq)
+   * @param _out output data. It is reused for every document.
+   * @param _filePath input json file
+   * @param _handler called after each document is parsed
+   * @param _ctrl parser control flags
+   * @return statistics of all the documents
+   * @throws std::exception if parsing fails
+   */
+  static parser_stats parse_file(
+    parser_output&          _out,
+    const std::string&      _filePath,
+    const document_handler& _handler,
+    const parser_control&   _ctrl = parser_control()
+  );
+  /**
+   * @fn parse
+   * @brief parse json string data of multiple documents
+   * @param _out output data. It is reused for every document.
+   * @param _in input string data
+   * @param _handler called after each document is parsed
+   * @param _ctrl parser control flags
+   * @return statistics of all the documents
+   * @throws std::exception if parsing fails
+   */
+  static parser_stats parse(
+    parser_output&          _out,
+    const std::string&      _in,
+    const document_handler& _handler,
+    const parser_control&   _ctrl = parser_control()
+  );
+  /**
+   * @fn parse
+   * @brief parse json stream buffer of multiple documents
+   * @param _out output data. It is reused for every document.
+   * @param _in stream buffer input
+   * @param _handler called after each document is parsed
+   * @param _ctrl parser control flags
+   * @return statistics of all the documents
+   * @throws std::exception if parsing fails
+   */
+  static parser_stats parse(
+    parser_output&          _out,
+    std::streambuf&         _in,
+    const document_handler& _handler,
+    const parser_control&   _ctrl = parser_control()
+  );
+  /**
+   * @fn parse
+   * @brief parse json input stream of multiple documents
+   * @param _out output data. It is reused for every document.
+   * @param _in input stream
+   * @param _handler called after each document is parsed
+   * @param _ctrl parser control flags
+   * @return statistics of all the documents
+   * @throws std::exception if parsing fails
+   */
+  static parser_stats parse(
+    parser_output&          _out,
+    std::istream&           _in,
+    const document_handler& _handler,
+    const parser_control&   _ctrl = parser_control()
+  );
+
+  /**
+   * @fn parse_file
+   * @brief parse json file with several threads. If the root is an array, its elements are
+   *        split among the threads. Otherwise, and for flexible modes and comments, the file
+   *        is parsed by one thread.
+   * @param _out output data
+   * @param _filePath input json file
+   * @param _threads number of threads (0 for one per core)
+   * @param _ctrl parser control flags
+   * @throws std::exception if parsing fails. It is the first error in input order.
+   */
+  static void parse_file(
+    parser_output&        _out,
+    const std::string&    _filePath,
+    const uint32_t        _threads,
+    const parser_control& _ctrl = parser_control()
+  );
+
+  //! Called for each document of a file parsed by several threads. _index is the index of the
+  //! record (starting at 0), not counting the empty lines. It is exact for JSON Lines, where
+  //! every record is on a line of its own. A record that spans several lines is counted once
+  //! per line by the chunks of the file after it.
+  using indexed_document_handler = std::function<bool(uint64_t _index, parser_output& _out)>;
+  /**
+   * @fn parse_file
+   * @brief parse a file of line-delimited documents (like JSON Lines) with several threads. The
+   *        file is split at line boundaries and each thread parses a part of it at a time.
+   * @param _filePath input json file
+   * @param _threads number of threads (0 for one per core)
+   * @param _handler called after each document is parsed
+   * @param _ordered call the handler in input order, from one thread at a time. Otherwise it is
+   *                 called from all the threads at the same time, as the documents are parsed.
+   * @param _ctrl parser control flags
+   * @return statistics of all the documents
+   * @throws std::exception if parsing fails
+   */
+  static parser_stats parse_file(
+    const std::string&              _filePath,
+    const uint32_t                  _threads,
+    const indexed_document_handler& _handler,
+    const bool                      _ordered = true,
+    const parser_control&           _ctrl = parser_control()
+  );
+
   // Constructors
   value(const value_type _type = value_type::null);
   value(const int64_t _val);
@@ -134,6 +530,8 @@ public:
   value(const long double _val);
   value(const bool _val);
   value(const std::string& _val);
+  //! A long string keeps its characters where they are
+  value(std::string&& _val);
   value(const char* _val);
   value(const int _val);
   // Copy constructor
@@ -166,12 +564,14 @@ public:
 
   // operator= overloads
   value& operator=(const value& _obj);
+  value& operator=(value&& _obj) noexcept;
   value& operator=(const int64_t _val);
   value& operator=(const uint64_t _val);
   value& operator=(const double _val);
   value& operator=(const long double _val);
   value& operator=(const bool _val);
   value& operator=(const std::string& _val);
+  value& operator=(std::string&& _val);
   value& operator=(const char* _val);
   value& operator=(const int _val);
 
@@ -189,6 +589,8 @@ public:
   long double get_double() const;
   bool get_bool() const;
   std::string get_str() const;
+  //! get the characters of a string without copying them. Valid until the value is changed.
+  std::string_view get_str_view() const;
   std::string as_str() const;
 
   //! get functions with arguments
@@ -227,23 +629,49 @@ public:
   const value& operator[](const size_t _index) const;
   value& operator[](const size_t _index);
   const value& operator[](const std::string& _key) const;
+  //! Get the member of the key, adding a null member if it doesn't exist. Adding a member keeps
+  //! the references to the other members of an ordered object, the default layout. The flat and
+  //! hash layouts store the members in one allocation, so that adding a member to such an object
+  //! invalidates the references and iterators to its other members.
   value& operator[](const std::string& _key);
   //! Erase value from the object
   void erase(const std::string& _key);
-  //! Append value to the array
+  //! Append value to the array. It may move the elements of the array, invalidating the
+  //! references to them.
   value& append();
   value& append(const value& _obj);
+  //! Append value to the array, moving its storage. It may be an element of the array.
+  value& append(value&& _obj);
   template <typename T> value& append(const T& _val)
   {
     if ( ! is_array() )
     {
       clear();
-      m_type = m_data.init(value_type::array);
+      init(value_type::array);
     }
     value& jval = append();
-    jval.m_type = jval.m_data.init(_val);
+    jval = _val;
     return jval;
   }
+  //! Append value(_args...) to the array, constructed in place
+  template <typename... Args> value& emplace_back(Args&&... _args)
+  {
+    if ( ! is_array() )
+    {
+      clear();
+      init(value_type::array);
+    }
+    mark_changed();
+    return m_data._arr->emplace_back(std::forward<Args>(_args)...);
+  }
+  //! Set the value of the key to value(_args...). The arguments may refer to members of the object.
+  //! Adding the key to a flat or hash object invalidates the references to its other members, as
+  //! with operator[].
+  template <typename... Args> value& emplace(const std::string& _key, Args&&... _args)
+  {
+    value jval(std::forward<Args>(_args)...);
+    return (*this)[_key] = std::move(jval);
+  }
   // Erase value from the array
   void erase(const size_t _index);
 
@@ -258,63 +686,167 @@ public:
   void write(std::ostream& _out, const format& _format) const;
 
 private:
+  //! The parser decodes strings directly into the value
+  template <typename Derived, typename parser_input, typename pos_type> friend struct parser;
+  //! The pool takes the storage of values apart and hands it back
+  friend class value_pool;
+  //! The parallel parser joins the elements parsed by its threads
+  friend class parallel_array_parser;
   void p_write(std::ostream& _out, const format& _format, uint32_t _level) const;
 
 private:
   union union_data
   {
-    int64_t     _i64;
-    uint64_t    _u64;
-    long double _dbl;
-    bool        _bval;
-    std::string _str;
-    array_t     _arr;
-    object_t*   _map;
-    //! Default constructor
-    union_data(const value_type _type = value_type::null);
-    //! Copy constructor
-    union_data(const union_data& _obj, const value_type _type = value_type::null);
-    //! Move constructor
-    union_data(union_data&& _obj, const value_type _type = value_type::null) noexcept;
-    //! Destructor
-    ~union_data();
-
-    //! Clear the memory used by the object
-    value_type clear(const value_type _type);
-
-    //! Copy initializer routines
-    value_type init(const value_type _type = value_type::null);
-    value_type init(const union_data& _obj, const bool _new = true,
-                       const value_type _type = value_type::null);
-    value_type init(const int _val);
-    value_type init(const int64_t _val);
-    value_type init(const uint64_t _val);
-    value_type init(const long double _val);
-    value_type init(const bool _val);
-    value_type init(const std::string& _val);
-    value_type init(const char* _val);
-    value_type init(const array_t& _val);
-    value_type init(const object_t& _val, const bool _new = true);
-    //! Move initializer routine
-    value_type init(union_data&& _obj, value_type _type) noexcept;
-
-    union_data& operator=(const union_data& _obj) { *this = std::move(_obj); return *this; }
-    const object_t& map() const { return (*_map); }
-    object_t& map() { return (*_map); }
+    int64_t      _i64;
+    uint64_t     _u64;
+    number_t     _dbl;
+    bool         _bval;
+    std::string* _str; //! A string longer than short_capacity
+    const char*  _chars; //! A string longer than short_capacity in an arena
+    array_t*     _arr;
+    object_t     _map; //! Constructed and destroyed by the value
+
+    union_data() {}
+    ~union_data() {}
   }; // union union_data
 
-  value_type m_type; //! Type of the object
-  union_data m_data; //! The object
+  //! A short string starts in m_data and continues in m_chars, which fill the rest of the value
+  //! up to m_size
+  static constexpr size_t  short_tail = alignof(union_data) - 2;
+  static constexpr size_t  short_capacity = sizeof(union_data) + short_tail;
+  //! m_size of a string stored out of line
+  static constexpr uint8_t long_size = 0xFF;
+  //! m_size of a string stored in an arena. Its length is in m_chars.
+  static constexpr uint8_t arena_size = 0xFE;
+  //! m_size flags of an array or object allocated in an arena. It is not destroyed, nor its
+  //! children, unless it is changed after it is parsed. Then it may hold storage of the heap.
+  static constexpr uint8_t arena_flag = 0x01;
+  static constexpr uint8_t changed_flag = 0x02;
+
+  //! Characters of a short string
+  char* short_str() { return reinterpret_cast<char*>(this); }
+  const char* short_str() const { return reinterpret_cast<const char*>(this); }
+  //! Characters of a string value
+  std::string_view str_view() const
+  {
+    if ( m_size <= short_capacity )
+      return std::string_view(short_str(), m_size);
+    if ( m_size == long_size )
+      return std::string_view(*m_data._str);
+    uint32_t size;
+    ::memcpy(&size, m_chars, sizeof(size));
+    return std::string_view(m_data._chars, size);
+  }
+  //! Make a null value the given string
+  void init_str(const std::string_view _val);
+  //! Make a null value the given string, taking its characters if it is long
+  void move_str(std::string&& _val);
+  //! Make a null value the given string, stored in the arena if it is long
+  void init_str(const std::string_view _val, arena& _arena);
+  //! Make a null value an empty array or object allocated in the arena
+  void init(const value_type _type, const object_layout _layout, arena& _arena);
+  //! Note that an array or object of an arena may no longer be skipped when it is cleared
+  void mark_changed() { if ( m_size == arena_flag ) m_size |= changed_flag; }
+  //! Copy the content of the value into this null value
+  void copy_from(const value& _obj);
+  //! Move the content of the value into this null value. The value becomes null.
+  void move_from(value& _obj) noexcept;
+
+  union_data m_data;              //! The value, or the start of a short string
+  char       m_chars[short_tail]; //! The rest of a short string
+  uint8_t    m_size;              //! Length of a short string, long_size or arena_size, or the
+                                  //!   arena flags of a container
+  value_type m_type;              //! Type of the value
 }; // class value
 
-#pragma pack(pop)
+/**
+ * @class value_pool
+ * @brief Storage taken from a discarded document and handed back to the next parse
+ *
+ * Long strings, arrays and objects keep their capacity and long object keys are interned, so
+ * parsing a document of a similar shape does almost no memory allocation.
+ */
+class value_pool
+{
+public:
+  value_pool() = default;
+  //! The storage is not shared. A copy starts with an empty pool.
+  value_pool(const value_pool&) : value_pool() {}
+  value_pool(value_pool&&) = default;
+  value_pool& operator=(const value_pool&) { return *this; }
+  value_pool& operator=(value_pool&&) = default;
+
+  //! Move the storage of the value and all its children to the pool. The value becomes null.
+  void recycle(value& _jval);
+  //! Free the storage kept in the pool
+  void release();
+  bool empty() const;
+
+  /**
+   * @fn take
+   * @brief Initialize a null value of the given type, using pooled storage if available
+   * @param _layout layout of an object. A pooled object of another layout is not used.
+   * @return true if memory was allocated for it
+   */
+  bool take(value& _jval, const value_type _type, const object_layout _layout = object::default_layout());
+  /**
+   * @fn take
+   * @brief Initialize a null value with the given string. A string that is too long to be kept in
+   *        the value is copied into pooled storage if available.
+   * @return true if memory was allocated for it
+   */
+  bool take(value& _jval, const std::string_view _str);
+  /**
+   * @fn take_key
+   * @brief Set the key of a new object member. A long key is interned in the pool, so that it is
+   *        shared with the same key of the previous and next documents.
+   * @return true if memory was allocated for it
+   */
+  bool take_key(key& _key, const std::string_view _src) { return m_keys.intern(_key, _src); }
+
+private:
+  std::vector<std::unique_ptr<std::string>>     m_strings;
+  std::vector<std::unique_ptr<value::array_t>>  m_arrays;
+  std::vector<value::object_t>                  m_objects;
+  key_table                                     m_keys;
+  std::vector<value*>                           m_pending; //! Values yet to be recycled
+};
 
+/**
+ * @struct parser_output
+ * @brief The parsed document and the statistics of the parse
+ */
 struct parser_output
 {
+  //! Allocate the arrays, objects, long strings and long keys of the documents from this arena
+  //! if set. Clearing the document then frees all of it at once, without visiting its values,
+  //! unless they were changed after parsing. The pool and the key table are not used with it.
+  //! A value moved out of the document must not be used after the document is cleared.
+  //! The parallel parsers do not use it.
+  std::unique_ptr<arena> memory;
   value        jroot;
   parser_stats stats;
-
-  void clear() { jroot.clear(); stats.clear(); }
+  //! Keep the storage of the previous document for the next parse (see value_pool)
+  bool         reuse = false;
+  value_pool   pool;
+  //! Intern the long object keys in this table if set. It may be shared by the outputs of several
+  //! documents that are not parsed at the same time. The parallel parsers do not use it.
+  std::shared_ptr<key_table> keys;
+
+  //! Clear the document. Its storage goes back to the arena, or to the pool if reuse is set.
+  void clear()
+  {
+    if ( memory )
+    {
+      jroot.clear();
+      memory->rewind();
+    }
+    else if ( reuse )
+      pool.recycle(jroot);
+    else
+      jroot.clear();
+    stats.clear();
+  }
 };
 
 
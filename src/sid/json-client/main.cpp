@@ -74,6 +74,8 @@ int main(int argc, char* argv[])
     std::optional<json::format> outputFmt;
     bool isStdin = false;
     bool showOutput = false;
+    bool isLines = false;
+    uint32_t threads = 0;
     std::optional<Use> use;
     std::optional<std::string> filename;
     // Parse for options and filename
@@ -134,6 +136,20 @@ int main(int argc, char* argv[])
         ctrl.mode.allowFlexibleStrings = 1;
       else if ( key == "-n" || key == "--allow-nocase" || key == "--allow-nocase-values" )
         ctrl.mode.allowNocaseValues = 1;
+      else if ( key == "-m" || key == "--max-depth" )
+      {
+        if ( value.empty() || value.find_first_not_of("0123456789") != std::string::npos )
+          throw std::invalid_argument(key + " must be a number (0 for no limit)");
+        ctrl.maxDepth = static_cast<uint32_t>(std::stoul(value));
+      }
+      else if ( key == "-l" || key == "--lines" )
+        isLines = true;
+      else if ( key == "-t" || key == "--threads" )
+      {
+        if ( value.empty() || value.find_first_not_of("0123456789") != std::string::npos || std::stoul(value) == 0 )
+          throw std::invalid_argument(key + " must be a number greater than 0");
+        threads = static_cast<uint32_t>(std::stoul(value));
+      }
       else if ( key == "-o" || key == "--show-output" )
       {
         showOutput = true;
@@ -182,6 +198,26 @@ int main(int argc, char* argv[])
     // If use is not set, set the default value based on --stdin/interactive or <filename>
     if ( !use.has_value() )
       use = filename.has_value()? Use::MMap : Use::FileStream;
+    // Only a memory mapped file can be split among threads
+    if ( threads != 0 && use.value() != Use::MMap )
+      throw std::invalid_argument("--threads can only be used with mmap of <filename>");
+
+    // Parse the input as a single document, or as one document after another with --lines
+    parser_stats total;
+    out.reuse = isLines;
+    auto on_document = [&](parser_output& _out)->bool
+      {
+        if ( showOutput )
+          cout << (outputFmt.has_value()? _out.jroot.to_string(outputFmt.value()) : _out.jroot.to_string()) << endl;
+        return true;
+      };
+    auto parse_input = [&](auto& _in)
+      {
+        if ( isLines )
+          total = json::value::parse(out, _in, on_document, ctrl);
+        else
+          json::value::parse(out, _in, ctrl);
+      };
 
     if ( filename.has_value() )
     {
@@ -190,14 +226,23 @@ int main(int argc, char* argv[])
       case Use::MMap:
         {
           cerr << "Using mmap for parsing...." << endl;
-          json::value::parse_file(out, filename.value(), ctrl);
+          if ( isLines && threads != 0 )
+            total = json::value::parse_file(filename.value(), threads,
+                                            [&](uint64_t, parser_output& _out) { return on_document(_out); },
+                                            true, ctrl);
+          else if ( isLines )
+            total = json::value::parse_file(out, filename.value(), on_document, ctrl);
+          else if ( threads != 0 )
+            json::value::parse_file(out, filename.value(), threads, ctrl);
+          else
+            json::value::parse_file(out, filename.value(), ctrl);
         }
         break;
       case Use::String:
         {
           cerr << "Using string data for parsing...." << endl;
           std::string data; local::get_file_contents(data, filename.value());
-          json::value::parse(out, data, ctrl);
+          parse_input(data);
         }
         break;
       case Use::FileBuffer:
@@ -208,7 +253,7 @@ int main(int argc, char* argv[])
           //fbuf.pubsetbuf(buffer.data(), buffer.size());
           if ( !fbuf.open(filename.value().c_str(), std::ios::in) )
             throw std::system_error(errno, std::system_category(), "Failed to open file: " + filename.value());
-          json::value::parse(out, fbuf, ctrl);
+          parse_input(fbuf);
         }
         break;
       case Use::StringBuffer:
@@ -216,7 +261,7 @@ int main(int argc, char* argv[])
           cerr << "Using string buffer for parsing...." << endl;
           std::string data; local::get_file_contents(data, filename.value());
           std::stringbuf sbuf(data, std::ios_base::in);
-          json::value::parse(out, sbuf, ctrl);
+          parse_input(sbuf);
         }
         break;
       case Use::FileStream:
@@ -226,7 +271,7 @@ int main(int argc, char* argv[])
           fstream.open(filename.value());
           if ( !fstream.is_open() )
             throw std::system_error(errno, std::system_category(), "Failed to open file: " + filename.value());
-          json::value::parse(out, fstream, ctrl);
+          parse_input(fstream);
         }
         break;
       case Use::StringStream:
@@ -234,7 +279,7 @@ int main(int argc, char* argv[])
           cerr << "Using string stream for parsing...." << endl;
           std::string data; local::get_file_contents(data, filename.value());
           std::istringstream sstream(data);
-          json::value::parse(out, sstream, ctrl);
+          parse_input(sstream);
         }
         break;
       }
@@ -255,18 +300,13 @@ int main(int argc, char* argv[])
         {
           cerr << "Using stdin string data for parsing...." << endl;
           std::string data; local::get_stdin(data);
-          json::value::parse(out, data, ctrl);
+          parse_input(data);
         }
         break;
       case Use::FileBuffer:
         {
           cerr << "Using stdin file buffer for parsing...." << endl;
-          // DISABLE THIS - Makes cin MUCH faster for reading character by character
-          // This massively improves the performance
-          std::ios_base::sync_with_stdio(false);
-          // Also untie cin from cout (prevents flush on every read)
-          std::cin.tie(nullptr);
-          json::value::parse(out, *cin.rdbuf(), ctrl);
+          parse_input(*cin.rdbuf());
         }
         break;
       case Use::StringBuffer:
@@ -274,18 +314,13 @@ int main(int argc, char* argv[])
           cerr << "Using stdin string buffer for parsing...." << endl;
           std::string data; local::get_stdin(data);
           std::stringbuf sbuf(data, std::ios_base::in);
-          json::value::parse(out, sbuf, ctrl);
+          parse_input(sbuf);
         }
         break;
       case Use::FileStream:
         {
           cerr << "Using stdin file stream for parsing...." << endl;
-          // DISABLE THIS - Makes cin MUCH faster for reading character by character
-          // This massively improves the performance
-          std::ios_base::sync_with_stdio(false);
-          // Also untie cin from cout (prevents flush on every read)
-          std::cin.tie(nullptr);
-          json::value::parse(out, cin, ctrl);
+          parse_input(cin);
         }
         break;
       case Use::StringStream:
@@ -293,13 +328,13 @@ int main(int argc, char* argv[])
           cerr << "Using stdin string stream for parsing...." << endl;
           std::string data; local::get_stdin(data);
           std::istringstream sstream(data);
-          json::value::parse(out, sstream, ctrl);
+          parse_input(sstream);
         }
         break;
       }
     }
-    cerr << out.stats.to_string() << endl;
-    if ( showOutput )
+    cerr << (isLines? total : out.stats).to_string() << endl;
+    if ( showOutput && !isLines )
     {
       cout << (outputFmt.has_value()? out.jroot.to_string(outputFmt.value()) : out.jroot.to_string()) << endl;
     }
@@ -336,6 +371,13 @@ Options: <key>[=<value>]
       --allow-flexible-strings
   -n, --allow-nocase,            Allow case-insensitive values for true, false, null
       --allow-nocase-values         * True, TRUE, False, FALSE, Null, NULL
+  -m, --max-depth=<depth>        Maximum nesting depth of objects and arrays
+                                   If omitted, it defaults to 1024. 0 for no limit.
+  -l, --lines                    Parse one document after another, like JSON Lines or
+                                   RFC 7464 json-seq. The output is shown per document.
+  -t, --threads=<n>              Parse <filename> with <n> threads. The elements of a root
+                                   array are split among them. With --lines, the file is
+                                   split at line boundaries, so a document cannot span lines.
   -o, --show-output[=<format>]   Show parsed JSON output
                                    (format: compact|pretty)
                                    If <format> is omitted, it defaults to compact
@@ -351,6 +393,9 @@ Examples:
   ${PNAME} -o=pretty ./data.json     # Parse and show pretty output
   ${PNAME} -k -s ./data.json         # Allow flexible keys and strings
   ${PNAME} --dup=append ./data.json  # Append duplicate keys
+  ${PNAME} -l -o ./logs.jsonl        # Parse and show each record of a JSON Lines file
+  ${PNAME} -l -t=8 ./logs.jsonl      # Parse a JSON Lines file with 8 threads
+  ${PNAME} -t=8 ./data.json          # Parse the root array of data.json with 8 threads
   echo '{"key":"value"}' | ${PNAME}  # Parse from stdin (pipe)
   cat ./data.json | ${PNAME}         # Parse from stdin (pipe)
 )~";
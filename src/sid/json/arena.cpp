@@ -0,0 +1,211 @@
+/*
+LICENSE: BEGIN
+===============================================================================
+@author Shan Anand
+@email anand.gs@gmail.com
+@source https://github.com/shan-anand
+@file parse_error.cpp
+@brief Json handling using c++
+===============================================================================
+MIT License
+
+Copyright (c) 2017 Shanmuga (Anand) Gunasekaran
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+===============================================================================
+LICENSE: END
+*/
+
+/**
+ * @file  arena.cpp
+ * @brief Implementation of the memory arena of documents
+ */
+#include "json/arena.h"
+#include <algorithm>
+#include <iterator>
+#include <new>
+#include <system_error>
+#include <cerrno>
+#include <sys/mman.h>
+
+using namespace sid::json;
+
+namespace {
+
+//! Size of a transparent huge page
+constexpr size_t huge_page_size = 2 << 20;
+
+size_t round_up(const size_t _size, const size_t _multiple)
+{
+  return (_size + _multiple - 1) / _multiple * _multiple;
+}
+
+//! Blocks of this alignment may be reused. Strings, which are not given back, are not aligned.
+bool reusable(const size_t _bytes, const size_t _alignment)
+{
+  return _alignment == alignof(void*) && _bytes <= arena::small_size;
+}
+
+} // namespace
+
+arena::arena(
+  std::pmr::memory_resource* _upstream/* = nullptr*/,
+  const bool                 _hugePages/* = false*/,
+  const size_t               _chunkSize/* = default_chunk_size*/
+  )
+  : m_upstream(_upstream), m_hugePages(_hugePages && _upstream == nullptr),
+    m_chunkSize(std::clamp<size_t>(_chunkSize, 4096, max_chunk_size)),
+    m_chunks(), m_current(0), m_pos(nullptr), m_end(nullptr), m_allocations(0), m_free()
+{
+}
+
+arena::~arena()
+{
+  release();
+}
+
+void arena::rewind()
+{
+  m_current = 0;
+  m_pos = m_chunks.empty()? nullptr : m_chunks[0].begin;
+  m_end = m_chunks.empty()? nullptr : m_chunks[0].begin + m_chunks[0].size;
+  std::fill(std::begin(m_free), std::end(m_free), nullptr);
+}
+
+void arena::release()
+{
+  for ( const chunk& c : m_chunks )
+    free_chunk(c);
+  m_chunks.clear();
+  rewind();
+}
+
+size_t arena::used() const
+{
+  if ( m_chunks.empty() )
+    return 0;
+  size_t bytes = m_pos - m_chunks[m_current].begin;
+  for ( size_t i = 0; i < m_current; i++ )
+    bytes += m_chunks[i].size;
+  return bytes;
+}
+
+size_t arena::capacity() const
+{
+  size_t bytes = 0;
+  for ( const chunk& c : m_chunks )
+    bytes += c.size;
+  return bytes;
+}
+
+void* arena::do_allocate(size_t _bytes, size_t _alignment)
+{
+  if ( reusable(_bytes, _alignment) )
+  {
+    // A block given back is taken for the same size. Otherwise the size is rounded up so that
+    // the block can be given back.
+    const size_t slot = std::max<size_t>(1, round_up(_bytes, sizeof(void*)) / sizeof(void*));
+    if ( void* ptr = m_free[slot] )
+    {
+      m_free[slot] = *static_cast<void**>(ptr);
+      return ptr;
+    }
+    _bytes = slot * sizeof(void*);
+  }
+  uintptr_t pos = (reinterpret_cast<uintptr_t>(m_pos) + _alignment - 1) & ~(uintptr_t(_alignment) - 1);
+  if ( m_pos == nullptr || pos > reinterpret_cast<uintptr_t>(m_end)
+       || _bytes > reinterpret_cast<uintptr_t>(m_end) - pos )
+  {
+    next_chunk(_bytes, _alignment);
+    pos = (reinterpret_cast<uintptr_t>(m_pos) + _alignment - 1) & ~(uintptr_t(_alignment) - 1);
+  }
+  m_pos = reinterpret_cast<char*>(pos + _bytes);
+  return reinterpret_cast<void*>(pos);
+}
+
+void arena::do_deallocate(void* _ptr, size_t _bytes, size_t _alignment)
+{
+  // Other blocks are only freed with the chunks
+  if ( ! reusable(_bytes, _alignment) )
+    return;
+  const size_t slot = std::max<size_t>(1, round_up(_bytes, sizeof(void*)) / sizeof(void*));
+  *static_cast<void**>(_ptr) = m_free[slot];
+  m_free[slot] = _ptr;
+}
+
+void arena::next_chunk(const size_t _bytes, const size_t _alignment)
+{
+  // A chunk kept by rewind() is used again if the allocation fits in it
+  const size_t needed = _bytes + _alignment;
+  if ( ! m_chunks.empty() )
+  {
+    while ( ++m_current < m_chunks.size() )
+    {
+      if ( m_chunks[m_current].size >= needed )
+      {
+        m_pos = m_chunks[m_current].begin;
+        m_end = m_pos + m_chunks[m_current].size;
+        return;
+      }
+    }
+  }
+  size_t size = m_chunks.empty()? m_chunkSize : std::min(2 * m_chunks.back().size, max_chunk_size);
+  size = std::max(size, needed);
+  m_chunks.reserve(m_chunks.size() + 1);
+  const chunk c = allocate_chunk(size);
+  m_chunks.push_back(c);
+  m_allocations++;
+  m_current = m_chunks.size() - 1;
+  m_pos = c.begin;
+  m_end = c.begin + c.size;
+}
+
+arena::chunk arena::allocate_chunk(const size_t _size)
+{
+  if ( m_upstream )
+    return chunk{static_cast<char*>(m_upstream->allocate(_size, alignof(std::max_align_t))), _size};
+  if ( ! m_hugePages )
+    return chunk{static_cast<char*>(::operator new(_size)), _size};
+  // Map a little more to start the chunk at a huge page boundary, and give back the rest
+  const size_t size = round_up(_size, huge_page_size);
+  void* mem = ::mmap(nullptr, size + huge_page_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if ( mem == MAP_FAILED )
+    throw std::system_error(errno, std::system_category(), "arena:mmap");
+  char* first = static_cast<char*>(mem);
+  char* begin = reinterpret_cast<char*>(round_up(reinterpret_cast<uintptr_t>(first), huge_page_size));
+  if ( begin != first )
+    ::munmap(first, begin - first);
+  if ( begin + size != first + size + huge_page_size )
+    ::munmap(begin + size, first + size + huge_page_size - (begin + size));
+#ifdef MADV_HUGEPAGE
+  // Without transparent huge pages, the chunk is made of normal pages
+  ::madvise(begin, size, MADV_HUGEPAGE);
+#endif
+  return chunk{begin, size};
+}
+
+void arena::free_chunk(const chunk& _chunk)
+{
+  if ( m_upstream )
+    m_upstream->deallocate(_chunk.begin, _chunk.size, alignof(std::max_align_t));
+  else if ( m_hugePages )
+    ::munmap(_chunk.begin, _chunk.size);
+  else
+    ::operator delete(_chunk.begin);
+}
@@ -109,6 +109,20 @@ format format::get(const std::string& _value)
       else if ( ! json::to_bool(value, fmt.string_no_quotes, &error) )
         throw std::runtime_error("Format " + key + " error: " + error);
     }
+    else if ( key == "escape-unicode" )
+    {
+      if ( ! valueFound )
+        fmt.escape_unicode = true;
+      else if ( ! json::to_bool(value, fmt.escape_unicode, &error) )
+        throw std::runtime_error("Format " + key + " error: " + error);
+    }
+    else if ( key == "sort-keys" )
+    {
+      if ( ! valueFound )
+        fmt.sort_keys = true;
+      else if ( ! json::to_bool(value, fmt.sort_keys, &error) )
+        throw std::runtime_error("Format " + key + " error: " + error);
+    }
     else if ( key == "sep" || key == "separator" )
     {
       if ( fmt.type != json::format_type::pretty )
@@ -149,5 +163,9 @@ std::string format::to_string() const
     out << ":key_no_quotes=" << json::to_string(this->key_no_quotes);
   if ( this->string_no_quotes )
     out << ":string_no_quotes=" << json::to_string(this->string_no_quotes);
+  if ( this->escape_unicode )
+    out << ":escape-unicode=" << json::to_string(this->escape_unicode);
+  if ( this->sort_keys )
+    out << ":sort-keys=" << json::to_string(this->sort_keys);
   return out.str();
 }
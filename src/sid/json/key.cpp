@@ -0,0 +1,222 @@
+/*
+LICENSE: BEGIN
+===============================================================================
+@author Shan Anand
+@email anand.gs@gmail.com
+@source https://github.com/shan-anand
+@file parse_error.cpp
+@brief Json handling using c++
+===============================================================================
+MIT License
+
+Copyright (c) 2017 Shanmuga (Anand) Gunasekaran
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+===============================================================================
+LICENSE: END
+*/
+
+/**
+ * @file  key.cpp
+ * @brief Implementation of object keys and their interning
+ */
+#include "json/key.h"
+#include "json/arena.h"
+#include <functional>
+#include <ostream>
+#include <new>
+#include <stdexcept>
+#include <cstring>
+#include <cstddef>
+
+using namespace sid::json;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Implementation of key
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+key::key(const std::string_view _str)
+{
+  static_assert(sizeof(key) == short_capacity + 1, "key must not have padding");
+  if ( _str.size() <= short_capacity )
+  {
+    ::memcpy(short_str(), _str.data(), _str.size());
+    m_size = static_cast<uint8_t>(_str.size());
+    return;
+  }
+  m_entry = new_entry(_str, nullptr);
+  m_size = shared_size;
+}
+
+key::key(const std::string_view _str, arena& _arena)
+{
+  if ( _str.size() <= short_capacity )
+  {
+    ::memcpy(short_str(), _str.data(), _str.size());
+    m_size = static_cast<uint8_t>(_str.size());
+    return;
+  }
+  m_entry = new_entry(_str, &_arena);
+  m_size = shared_size;
+}
+
+key::key(const key& _key)
+{
+  ::memcpy(static_cast<void*>(this), &_key, sizeof(key));
+  if ( ! is_shared() )
+    return;
+  // The copy of a key of an arena may outlive the arena
+  if ( m_entry->refs.load(std::memory_order_relaxed) == 0 )
+    m_entry = new_entry(_key.view(), nullptr);
+  else
+    m_entry->refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+key::key(key&& _key) noexcept
+{
+  ::memcpy(static_cast<void*>(this), &_key, sizeof(key));
+  _key.m_size = 0;
+}
+
+key& key::operator=(const key& _key)
+{
+  if ( this != &_key )
+  {
+    key tmp(_key);
+    *this = std::move(tmp);
+  }
+  return *this;
+}
+
+key& key::operator=(key&& _key) noexcept
+{
+  if ( this != &_key )
+  {
+    if ( is_shared() )
+      release();
+    ::memcpy(static_cast<void*>(this), &_key, sizeof(key));
+    _key.m_size = 0;
+  }
+  return *this;
+}
+
+size_t key::hash() const
+{
+  return is_shared()? m_entry->hash : std::hash<std::string_view>()(view());
+}
+
+/*static*/
+key::entry* key::new_entry(const std::string_view _str, arena* _arena)
+{
+  if ( _str.size() > UINT32_MAX )
+    throw std::length_error("Key is too long");
+  // The entry of an arena has no references. It is freed with the arena.
+  const size_t bytes = offsetof(entry, chars) + _str.size();
+  void* mem = _arena? _arena->allocate(bytes, alignof(entry)) : ::operator new(bytes);
+  entry* e = new (mem) entry{{_arena? 0u : 1u}, static_cast<uint32_t>(_str.size()),
+                             std::hash<std::string_view>()(_str), {}};
+  ::memcpy(e->chars, _str.data(), _str.size());
+  return e;
+}
+
+void key::release() noexcept
+{
+  if ( m_entry->refs.load(std::memory_order_relaxed) != 0
+       && m_entry->refs.fetch_sub(1, std::memory_order_acq_rel) == 1 )
+  {
+    m_entry->~entry();
+    ::operator delete(m_entry);
+  }
+  m_size = 0;
+}
+
+std::ostream& sid::json::operator<<(std::ostream& _out, const key& _key)
+{
+  return _out << _key.view();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Implementation of key_table
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+bool key_table::intern(key& _key, const std::string_view _str)
+{
+  if ( _str.size() <= key::short_capacity )
+  {
+    _key = key(_str);
+    return false;
+  }
+  const size_t hash = std::hash<std::string_view>()(_str);
+  if ( ! m_slots.empty() )
+  {
+    const size_t mask = m_slots.size() - 1;
+    for ( size_t i = hash & mask; ! m_slots[i].empty(); i = (i + 1) & mask )
+    {
+      const key& slot = m_slots[i];
+      if ( slot.m_entry->hash == hash && slot.view() == _str )
+      {
+        _key = slot;
+        return false;
+      }
+    }
+  }
+  _key = key(_str);
+  if ( m_size >= m_maxSize )
+    return true;
+  if ( 2 * (m_size + 1) > m_slots.size() )
+    grow();
+  const size_t mask = m_slots.size() - 1;
+  size_t i = hash & mask;
+  while ( ! m_slots[i].empty() )
+    i = (i + 1) & mask;
+  m_slots[i] = _key;
+  m_size++;
+  return true;
+}
+
+key key_table::intern(const std::string_view _str)
+{
+  key jkey;
+  intern(jkey, _str);
+  return jkey;
+}
+
+void key_table::clear()
+{
+  m_slots.clear();
+  m_size = 0;
+}
+
+void key_table::grow()
+{
+  std::vector<key> slots(m_slots.empty()? 64 : 2 * m_slots.size());
+  const size_t mask = slots.size() - 1;
+  for ( key& jkey : m_slots )
+  {
+    if ( jkey.empty() )
+      continue;
+    size_t i = jkey.m_entry->hash & mask;
+    while ( ! slots[i].empty() )
+      i = (i + 1) & mask;
+    slots[i] = std::move(jkey);
+  }
+  m_slots.swap(slots);
+}
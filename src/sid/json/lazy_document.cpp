@@ -0,0 +1,253 @@
+/*
+LICENSE: BEGIN
+===============================================================================
+@author Shan Anand
+@email anand.gs@gmail.com
+@source https://github.com/shan-anand
+@file lazy_document.cpp
+@brief Json handling using c++
+===============================================================================
+MIT License
+
+Copyright (c) 2017 Shanmuga (Anand) Gunasekaran
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+===============================================================================
+LICENSE: END
+*/
+
+/**
+ * @file  lazy_document.cpp
+ * @brief Implementation of the lazily decoded json document
+ */
+#include "json/lazy_document.h"
+#include "parser_io.h"
+#include "parser.h"
+#include "memory_map.h"
+#include <algorithm>
+#include <unordered_map>
+
+using namespace std;
+using namespace sid;
+using namespace sid::json;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Implementation of lazy_value
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct lazy_value::members
+{
+  std::vector<std::string> keys;   //! Keys of an object, each of them once
+  std::vector<lazy_value>  values; //! Values in the input order
+};
+
+lazy_value::lazy_value()
+  : m_type(value_type::null), m_scalar(), m_text(), m_origin(nullptr), m_ctrl(nullptr), m_members()
+{
+}
+
+lazy_value::lazy_value(const value_type _type, const std::string_view _text, const char* _origin,
+                       const parser_control* _ctrl)
+  : m_type(_type), m_scalar(), m_text(_text), m_origin(_origin), m_ctrl(_ctrl), m_members()
+{
+}
+
+lazy_value::~lazy_value()
+{
+}
+
+lazy_value::lazy_value(lazy_value&&) noexcept = default;
+lazy_value& lazy_value::operator=(lazy_value&&) noexcept = default;
+
+const lazy_value::members& lazy_value::get_members() const
+{
+  if ( m_members )
+    return *m_members;
+  if ( !is_object() && !is_array() )
+    throw std::runtime_error(__func__ + std::string("() can be used only for object and array types"));
+
+  auto result = std::make_unique<members>();
+  std::unordered_map<std::string, size_t> positions; //! Position of the value of each key
+  parser_output out;
+  char_parser_input in(m_text, m_origin, *m_ctrl);
+  char_parser parser(in, out);
+  parser.index_container([&](const std::string& _key, const char* _first, const char* _end, value* _scalar)
+    {
+      lazy_value jval;
+      if ( _scalar == nullptr )
+      {
+        const value_type type = ( *_first == '{' )? value_type::object : value_type::array;
+        jval = lazy_value(type, std::string_view(_first, _end - _first), m_origin, m_ctrl);
+      }
+      else
+      {
+        jval.m_type = _scalar->type();
+        jval.m_scalar = std::move(*_scalar);
+      }
+      if ( is_object() )
+      {
+        auto [it, isNew] = positions.try_emplace(_key, result->values.size());
+        if ( !isNew )
+        {
+          // Duplicate keys end up as they would in a value (dup_key::reject fails in the parser)
+          add_duplicate(result->values[it->second], std::move(jval));
+          return;
+        }
+        result->keys.push_back(_key);
+      }
+      result->values.push_back(std::move(jval));
+    });
+  m_members = std::move(result);
+  return *m_members;
+}
+
+void lazy_value::add_duplicate(lazy_value& _existing, lazy_value&& _jval) const
+{
+  switch ( m_ctrl->dupKey )
+  {
+  case parser_control::dup_key::overwrite:
+    _existing = std::move(_jval);
+    return;
+  case parser_control::dup_key::ignore:
+  case parser_control::dup_key::reject:
+    return;
+  case parser_control::dup_key::append:
+    break;
+  }
+  // The values are kept in an array that has no text of its own. An existing array gets the
+  // value as its last element.
+  if ( _existing.is_array() )
+    _existing.get_members();
+  else
+  {
+    lazy_value jprevious(std::move(_existing));
+    _existing = lazy_value(value_type::array, std::string_view(), m_origin, m_ctrl);
+    _existing.m_members = std::make_unique<members>();
+    _existing.m_members->values.push_back(std::move(jprevious));
+  }
+  _existing.m_text = std::string_view();
+  _existing.m_members->values.push_back(std::move(_jval));
+}
+
+bool lazy_value::has_index(const size_t _index) const
+{
+  return is_array() && _index < get_members().values.size();
+}
+
+bool lazy_value::has_key(const std::string& _key) const
+{
+  if ( !is_object() )
+    return false;
+  const members& jmembers = get_members();
+  return std::find(jmembers.keys.begin(), jmembers.keys.end(), _key) != jmembers.keys.end();
+}
+
+std::vector<std::string> lazy_value::get_keys() const
+{
+  if ( !is_object() )
+    throw std::runtime_error(__func__ + std::string("() can be used only for object type"));
+  return get_members().keys;
+}
+
+size_t lazy_value::size() const
+{
+  if ( !is_object() && !is_array() )
+    throw std::runtime_error(__func__ + std::string("() can be used only for array and object types"));
+  return get_members().values.size();
+}
+
+const lazy_value& lazy_value::operator[](const size_t _index) const
+{
+  if ( !is_array() )
+    throw std::runtime_error(__func__ + std::string("() can be used only for array type"));
+  const members& jmembers = get_members();
+  if ( _index >= jmembers.values.size() )
+    throw std::runtime_error(__func__ + std::string("() index(") + std::to_string(_index) + ") out of range");
+  return jmembers.values[_index];
+}
+
+const lazy_value& lazy_value::operator[](const std::string& _key) const
+{
+  if ( !is_object() )
+    throw std::runtime_error(__func__ + std::string("() can be used only for object type"));
+  const members& jmembers = get_members();
+  const auto& keys = jmembers.keys;
+  const size_t i = std::find(keys.begin(), keys.end(), _key) - keys.begin();
+  if ( i == keys.size() )
+    throw std::runtime_error(__func__ + std::string("() key(") + _key + ") not found");
+  return jmembers.values[i];
+}
+
+value lazy_value::to_value() const
+{
+  if ( !is_object() && !is_array() )
+    return m_scalar;
+  if ( m_text.empty() )
+  {
+    // The array of the values of a duplicate key (dup_key::append)
+    value jarr;
+    jarr.init(value_type::array);
+    for ( const lazy_value& jval : m_members->values )
+      jarr.append(jval.to_value());
+    return jarr;
+  }
+  parser_output out;
+  char_parser_input in(m_text, m_origin, *m_ctrl);
+  char_parser parser(in, out);
+  parser.parse();
+  return std::move(out.jroot);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Implementation of lazy_document
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct lazy_document::impl
+{
+  memory_map     mmap;
+  parser_control ctrl;
+
+  impl(const std::string& _filePath, const parser_control& _ctrl) : mmap(_filePath), ctrl(_ctrl) {}
+};
+
+lazy_document::lazy_document() : m_impl(), m_root()
+{
+}
+
+lazy_document::~lazy_document()
+{
+}
+
+void lazy_document::open(const std::string& _filePath, const parser_control& _ctrl)
+{
+  m_root = lazy_value();
+  m_impl.reset();
+  auto doc = std::make_unique<impl>(_filePath, _ctrl);
+  const std::string_view input(doc->mmap.begin(), doc->mmap.size());
+  parser_output out;
+  char_parser_input in(input, input.data(), doc->ctrl);
+  char_parser parser(in, out);
+  const char *first = nullptr, *end = nullptr;
+  parser.skip_document(first, end);
+  const value_type type = ( *first == '{' )? value_type::object : value_type::array;
+  m_root = lazy_value(type, std::string_view(first, end - first), input.data(), &doc->ctrl);
+  m_impl = std::move(doc);
+}
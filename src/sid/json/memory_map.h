@@ -56,7 +56,8 @@ public:
   size_t size() const { return m_size; }
 
 public:
-  memory_map(const std::string& _file)
+  //! Map the file. With _populate, all of it is read in advance.
+  memory_map(const std::string& _file, const bool _populate = true)
     : m_fd(-1), m_begin(MAP_FAILED), m_end(nullptr), m_size(0)
   {
     m_fd = ::open(_file.c_str(), O_RDONLY);
@@ -69,11 +70,20 @@ public:
       if ( ::fstat(m_fd, &fileStat) < 0 )
         throw std::system_error(errno, std::system_category(), "memory_map:fstat");
       m_size = fileStat.st_size;
-      // Memory map the entire file
-      int flags = MAP_SHARED | MAP_POPULATE;
-      m_begin = ::mmap(nullptr, m_size, PROT_READ, flags, m_fd, 0);
-      if ( m_begin == MAP_FAILED )
-        throw std::system_error(errno, std::system_category(), "memory_map:mmap");
+      if ( m_size == 0 )
+      {
+        // An empty file cannot be mapped. It is empty input, like an empty string.
+        static char empty = '\0';
+        m_begin = &empty;
+      }
+      else
+      {
+        // Memory map the entire file
+        int flags = MAP_SHARED | (_populate? MAP_POPULATE : 0);
+        m_begin = ::mmap(nullptr, m_size, PROT_READ, flags, m_fd, 0);
+        if ( m_begin == MAP_FAILED )
+          throw std::system_error(errno, std::system_category(), "memory_map:mmap");
+      }
     }
     catch (std::exception&)
     {
@@ -85,7 +95,7 @@ public:
 
   ~memory_map()
   {
-    if ( m_begin != MAP_FAILED )
+    if ( m_begin != MAP_FAILED && m_size != 0 )
     {
       ::munmap(m_begin, m_size);
       m_begin = MAP_FAILED;
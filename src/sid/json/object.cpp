@@ -0,0 +1,507 @@
+/*
+LICENSE: BEGIN
+===============================================================================
+@author Shan Anand
+@email anand.gs@gmail.com
+@source https://github.com/shan-anand
+@file parse_error.cpp
+@brief Json handling using c++
+===============================================================================
+MIT License
+
+Copyright (c) 2017 Shanmuga (Anand) Gunasekaran
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+===============================================================================
+LICENSE: END
+*/
+
+/**
+ * @file  object.cpp
+ * @brief Implementation of the object members
+ */
+#include "json/object.h"
+#include "json/value.h"
+#include <algorithm>
+#include <functional>
+#include <new>
+#include <tuple>
+#include <stdexcept>
+#include <cstring>
+
+// Layout of the objects that are not given one
+#ifndef SID_JSON_OBJECT_LAYOUT
+#define SID_JSON_OBJECT_LAYOUT ordered
+#endif
+
+using namespace sid::json;
+
+namespace {
+
+size_t key_hash(const std::string_view _key)
+{
+  return std::hash<std::string_view>()(_key);
+}
+
+size_t key_hash(const key& _key)
+{
+  return _key.hash();
+}
+
+bool key_less(const object::member& _a, const object::member& _b)
+{
+  return _a.first < _b.first;
+}
+
+//! Number of hash index slots for the capacity, at most half of them used
+size_t index_slots(const object_layout _layout, const size_t _capacity)
+{
+  if ( _layout == object_layout::flat || _capacity == 0 )
+    return 0;
+  if ( _layout == object_layout::ordered && _capacity <= object::small_size )
+    return 0;
+  size_t slots = 8;
+  while ( slots < 2 * _capacity )
+    slots *= 2;
+  return slots;
+}
+
+} // namespace
+
+object::block object::s_empty[3] = {
+  {0, 0, 0, object_layout::ordered, false, nullptr, nullptr},
+  {0, 0, 0, object_layout::flat, false, nullptr, nullptr},
+  {0, 0, 0, object_layout::hash, false, nullptr, nullptr}
+};
+
+/*static*/
+object_layout object::default_layout()
+{
+  return object_layout::SID_JSON_OBJECT_LAYOUT;
+}
+
+object::object(const object_layout _layout/* = default_layout()*/) noexcept
+  : m_block(&s_empty[static_cast<size_t>(_layout)])
+{
+}
+
+object::object(const object_layout _layout, std::pmr::memory_resource* _resource)
+  : object(_layout)
+{
+  // The block of no capacity keeps the resource for the members
+  if ( _resource == nullptr )
+    return;
+  m_block = new (_resource->allocate(sizeof(block), alignof(block))) block{0, 0, 0, _layout, false, _resource, nullptr};
+}
+
+object::object(const object& _obj)
+  : object(_obj.layout())
+{
+  if ( _obj.empty() )
+    return;
+  grow(_obj.size());
+  try
+  {
+    for ( const member& from : _obj )
+    {
+      new (entry(m_block->size)) member(from);
+      m_block->size++;
+    }
+  }
+  catch ( ... )
+  {
+    destroy();
+    throw;
+  }
+  m_block->sorted = _obj.m_block->sorted;
+  if ( m_block->mask )
+    rebuild_index();
+}
+
+object::object(object&& _obj) noexcept
+  : m_block(_obj.m_block)
+{
+  _obj.m_block = &s_empty[static_cast<size_t>(layout())];
+}
+
+object::~object()
+{
+  destroy();
+}
+
+object& object::operator=(const object& _obj)
+{
+  if ( this != &_obj )
+  {
+    object tmp(_obj);
+    std::swap(m_block, tmp.m_block);
+  }
+  return *this;
+}
+
+object& object::operator=(object&& _obj) noexcept
+{
+  // _obj may be within a member of this object. So, take it out before destroying.
+  object tmp(std::move(_obj));
+  std::swap(m_block, tmp.m_block);
+  return *this;
+}
+
+bool object::is_sorted() const
+{
+  return m_block->sorted || std::is_sorted(begin(), end(), key_less);
+}
+
+object::member* object::members() const
+{
+  static_assert(alignof(block) == alignof(member), "members must be aligned after the block");
+  static_assert(alignof(block) <= __STDCPP_DEFAULT_NEW_ALIGNMENT__, "blocks of the heap must be aligned");
+  return reinterpret_cast<member*>(m_block + 1);
+}
+
+object::member** object::entries() const
+{
+  return reinterpret_cast<member**>(m_block + 1);
+}
+
+object::member* object::entry(const size_t _pos) const
+{
+  return ( m_block->layout == object_layout::ordered )? entries()[_pos] : members() + _pos;
+}
+
+uint32_t* object::slots() const
+{
+  if ( m_block->layout == object_layout::ordered )
+    return reinterpret_cast<uint32_t*>(entries() + m_block->capacity);
+  return reinterpret_cast<uint32_t*>(members() + m_block->capacity);
+}
+
+/*static*/
+size_t object::block_bytes(const object_layout _layout, const size_t _capacity, const size_t _slotCount)
+{
+  const size_t entrySize = ( _layout == object_layout::ordered )? sizeof(member*) : sizeof(member);
+  return sizeof(block) + _capacity * entrySize + _slotCount * sizeof(uint32_t);
+}
+
+object::iterator object::begin()
+{
+  if ( m_block->layout == object_layout::ordered )
+    return iterator(nullptr, entries());
+  return iterator(members(), nullptr);
+}
+
+object::iterator object::end()
+{
+  return begin() + m_block->size;
+}
+
+object::const_iterator object::begin() const
+{
+  if ( m_block->layout == object_layout::ordered )
+    return const_iterator(nullptr, entries());
+  return const_iterator(members(), nullptr);
+}
+
+object::const_iterator object::end() const
+{
+  return begin() + m_block->size;
+}
+
+size_t object::lookup(const std::string_view _key) const
+{
+  const block& b = *m_block;
+  if ( b.mask )
+  {
+    const uint32_t* s = slots();
+    for ( size_t i = key_hash(_key) & b.mask; s[i] != 0; i = (i + 1) & b.mask )
+      if ( entry(s[i]-1)->first == _key )
+        return s[i] - 1;
+    return b.size;
+  }
+  if ( b.sorted )
+  {
+    // Only a flat object is sorted
+    const member* m = members();
+    const member* it = std::lower_bound(m, m + b.size, _key,
+                                        [](const member& _a, const std::string_view _k) { return _a.first < _k; });
+    return ( it != m + b.size && it->first == _key )? it - m : b.size;
+  }
+  for ( size_t i = 0; i < b.size; i++ )
+    if ( entry(i)->first == _key )
+      return i;
+  return b.size;
+}
+
+object::iterator object::find(const std::string_view _key)
+{
+  return begin() + lookup(_key);
+}
+
+object::const_iterator object::find(const std::string_view _key) const
+{
+  return begin() + lookup(_key);
+}
+
+std::pair<object::iterator, bool> object::try_emplace(const std::string_view _key)
+{
+  const size_t pos = lookup(_key);
+  if ( pos != m_block->size )
+    return {begin() + pos, false};
+  return {add(key(_key)), true};
+}
+
+object::iterator object::add(key&& _key)
+{
+  if ( m_block->size == m_block->capacity )
+    grow(m_block->capacity < 2? 2 : 2 * m_block->capacity);
+  block& b = *m_block;
+  if ( b.layout == object_layout::ordered )
+  {
+    // The member takes the first free place, which growing does not move
+    new (entries()[b.size]) member(std::piecewise_construct, std::forward_as_tuple(std::move(_key)), std::forward_as_tuple());
+    b.size++;
+    if ( b.mask )
+      index_insert(b.size - 1);
+    return begin() + (b.size - 1);
+  }
+  member* m = members();
+  // A flat object is sorted when it gets too big to search one by one
+  if ( b.layout == object_layout::flat && ! b.sorted && b.size == small_size )
+  {
+    std::sort(m, m + b.size, key_less);
+    b.sorted = true;
+  }
+  size_t pos = b.size;
+  if ( b.sorted )
+    pos = std::lower_bound(m, m + b.size, _key,
+                           [](const member& _a, const key& _k) { return _a.first < _k; }) - m;
+  new (m + b.size) member(std::piecewise_construct, std::forward_as_tuple(std::move(_key)), std::forward_as_tuple());
+  b.size++;
+  if ( pos != b.size - 1 )
+    std::rotate(m + pos, m + b.size - 1, m + b.size);
+  else if ( b.mask )
+    index_insert(pos);
+  return begin() + pos;
+}
+
+value& object::operator[](const std::string_view _key)
+{
+  return try_emplace(_key).first->second;
+}
+
+size_t object::erase(const std::string_view _key)
+{
+  const size_t pos = lookup(_key);
+  if ( pos == m_block->size )
+    return 0;
+  erase(begin() + pos);
+  return 1;
+}
+
+object::iterator object::erase(const_iterator _pos)
+{
+  block& b = *m_block;
+  const size_t pos = _pos - begin();
+  const size_t last = b.size - 1;
+  if ( b.layout == object_layout::ordered )
+  {
+    // The place of the member is kept free after the others
+    member** e = entries();
+    e[pos]->~member();
+    std::rotate(e + pos, e + pos + 1, e + b.size);
+    b.size--;
+    if ( b.mask )
+      rebuild_index();
+    return begin() + pos;
+  }
+  member* m = members();
+  if ( b.layout == object_layout::hash )
+  {
+    // The last member takes its place, and its slot in the index points to the new place
+    index_erase(pos);
+    if ( pos != last )
+    {
+      uint32_t* s = slots();
+      size_t i = key_hash(m[last].first) & b.mask;
+      while ( s[i] != last + 1 )
+        i = (i + 1) & b.mask;
+      s[i] = static_cast<uint32_t>(pos + 1);
+      m[pos] = std::move(m[last]);
+    }
+    m[last].~member();
+    b.size--;
+    return begin() + pos;
+  }
+  std::move(m + pos + 1, m + b.size, m + pos);
+  m[last].~member();
+  b.size--;
+  return begin() + pos;
+}
+
+void object::clear()
+{
+  if ( m_block->capacity == 0 )
+    return;
+  for ( size_t i = 0; i < m_block->size; i++ )
+    entry(i)->~member();
+  m_block->size = 0;
+  m_block->sorted = false;
+  if ( m_block->mask )
+    ::memset(slots(), 0, (m_block->mask + 1) * sizeof(uint32_t));
+}
+
+void object::reserve(const size_t _size)
+{
+  if ( _size > m_block->capacity )
+    grow(_size);
+}
+
+void object::grow(const size_t _capacity)
+{
+  // The index holds positions plus one in 32 bits
+  if ( _capacity >= UINT32_MAX / 2 )
+    throw std::length_error("Too many members in an object");
+  const object_layout layout = m_block->layout;
+  const size_t slotCount = index_slots(layout, _capacity);
+  const size_t bytes = block_bytes(layout, _capacity, slotCount);
+  std::pmr::memory_resource* resource = m_block->resource;
+  block* b = static_cast<block*>(resource? resource->allocate(bytes, alignof(block)) : ::operator new(bytes));
+  b->size = m_block->size;
+  b->capacity = static_cast<uint32_t>(_capacity);
+  b->mask = slotCount? static_cast<uint32_t>(slotCount - 1) : 0;
+  b->layout = layout;
+  b->sorted = m_block->sorted;
+  b->resource = resource;
+  b->chunks = m_block->chunks;
+  if ( layout == object_layout::ordered )
+  {
+    // The members stay where they are. The new places are in a chunk of their own.
+    const size_t count = _capacity - m_block->capacity;
+    const size_t chunkBytes = sizeof(chunk) + count * sizeof(member);
+    chunk* c = nullptr;
+    try
+    {
+      c = static_cast<chunk*>(resource? resource->allocate(chunkBytes, alignof(chunk)) : ::operator new(chunkBytes));
+    }
+    catch ( ... )
+    {
+      if ( resource )
+        resource->deallocate(b, bytes, alignof(block));
+      else
+        ::operator delete(b);
+      throw;
+    }
+    c->next = b->chunks;
+    c->count = static_cast<uint32_t>(count);
+    b->chunks = c;
+    member** to = reinterpret_cast<member**>(b + 1);
+    std::copy(entries(), entries() + m_block->capacity, to);
+    member* places = reinterpret_cast<member*>(c + 1);
+    for ( size_t i = 0; i < count; i++ )
+      to[m_block->capacity + i] = places + i;
+  }
+  else
+  {
+    member* from = members();
+    member* to = reinterpret_cast<member*>(b + 1);
+    for ( size_t i = 0; i < b->size; i++ )
+    {
+      new (to + i) member(std::move(from[i]));
+      from[i].~member();
+    }
+  }
+  if ( has_storage() )
+    free_block(m_block);
+  m_block = b;
+  if ( b->mask )
+    rebuild_index();
+}
+
+void object::index_insert(const size_t _pos)
+{
+  uint32_t* s = slots();
+  size_t i = key_hash(entry(_pos)->first) & m_block->mask;
+  while ( s[i] != 0 )
+    i = (i + 1) & m_block->mask;
+  s[i] = static_cast<uint32_t>(_pos + 1);
+}
+
+void object::index_erase(const size_t _pos)
+{
+  const uint32_t mask = m_block->mask;
+  uint32_t* s = slots();
+  size_t i = key_hash(entry(_pos)->first) & mask;
+  while ( s[i] != _pos + 1 )
+    i = (i + 1) & mask;
+  // Move back the entries after it that cannot be found past the free slot any more
+  for ( size_t j = (i + 1) & mask; s[j] != 0; j = (j + 1) & mask )
+  {
+    const size_t home = key_hash(entry(s[j]-1)->first) & mask;
+    if ( ((j - home) & mask) >= ((j - i) & mask) )
+    {
+      s[i] = s[j];
+      i = j;
+    }
+  }
+  s[i] = 0;
+}
+
+void object::rebuild_index()
+{
+  ::memset(slots(), 0, (m_block->mask + 1) * sizeof(uint32_t));
+  for ( size_t i = 0; i < m_block->size; i++ )
+    index_insert(i);
+}
+
+/*static*/
+void object::free_block(block* _block)
+{
+  if ( _block->resource == nullptr )
+    return ::operator delete(_block);
+  const size_t bytes = block_bytes(_block->layout, _block->capacity, _block->mask? _block->mask + 1 : 0);
+  _block->resource->deallocate(_block, bytes, alignof(block));
+}
+
+/*static*/
+void object::free_chunks(chunk* _chunk, std::pmr::memory_resource* _resource)
+{
+  while ( _chunk )
+  {
+    chunk* next = _chunk->next;
+    if ( _resource )
+      _resource->deallocate(_chunk, sizeof(chunk) + _chunk->count * sizeof(member), alignof(chunk));
+    else
+      ::operator delete(_chunk);
+    _chunk = next;
+  }
+}
+
+void object::destroy()
+{
+  if ( ! has_storage() )
+    return;
+  for ( size_t i = 0; i < m_block->size; i++ )
+    entry(i)->~member();
+  const object_layout layout = m_block->layout;
+  chunk* chunks = m_block->chunks;
+  std::pmr::memory_resource* resource = m_block->resource;
+  free_block(m_block);
+  free_chunks(chunks, resource);
+  m_block = &s_empty[static_cast<size_t>(layout)];
+}
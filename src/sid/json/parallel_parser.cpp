@@ -0,0 +1,503 @@
+/*
+LICENSE: BEGIN
+===============================================================================
+@author Shan Anand
+@email anand.gs@gmail.com
+@source https://github.com/shan-anand
+@file parallel_parser.cpp
+@brief Multi-threaded parser for files of line-delimited json documents
+===============================================================================
+MIT License
+
+Copyright (c) 2017 Shanmuga (Anand) Gunasekaran
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+===============================================================================
+LICENSE: END
+*/
+
+/**
+ * @file  parallel_parser.cpp
+ * @brief Implementation of the multi-threaded parser for files of line-delimited json documents
+ */
+#include "parallel_parser.h"
+#include "parser_io.h"
+#include "parser.h"
+#include "simd.h"
+#include "time_calc.h"
+#include <thread>
+#include <algorithm>
+#include <limits>
+#include <cstring>
+#include <utility>
+
+using namespace std;
+using namespace sid;
+using namespace sid::json;
+
+namespace {
+//! Bounds of the size of the chunks. A file is split into about 8 chunks per thread, so that
+//! threads that finish early take more of them.
+constexpr size_t min_chunk_size = 64 * 1024;
+constexpr size_t max_chunk_size = 256 * 1024;
+//! Chunks that can be parsed ahead of the one being delivered, per thread (ordered mode)
+constexpr size_t chunks_ahead = 2;
+constexpr size_t no_chunk = std::numeric_limits<size_t>::max();
+//! Smallest range of a file scanned by one thread to find the parts of the root array
+constexpr size_t min_range_size = 256 * 1024;
+
+//! Run _work on _threads threads and wait for them. The calling thread is one of them.
+void run_threads(const uint32_t _threads, const std::function<void()>& _work)
+{
+  std::vector<std::thread> threads;
+  threads.reserve(_threads - 1);
+  for ( uint32_t i = 1; i < _threads; i++ )
+    threads.emplace_back(_work);
+  _work();
+  for ( std::thread& thread : threads )
+    thread.join();
+}
+
+//! Number of lines in [_p, _end) that are not empty or all spaces, which are the records of
+//! JSON Lines
+uint64_t count_records(const char* _p, const char* _end)
+{
+  uint64_t count = 0;
+  while ( _p < _end )
+  {
+    const char* newline = static_cast<const char*>(::memchr(_p, '\n', _end - _p));
+    const char* eol = newline? newline : _end;
+    while ( _p < eol && ( *_p == ' ' || *_p == '\t' || *_p == '\r' ) )
+      ++_p;
+    if ( _p < eol )
+      ++count;
+    _p = eol + 1;
+  }
+  return count;
+}
+
+//! Number of threads to use. 0 is one per core.
+uint32_t thread_count(const uint32_t _threads)
+{
+  return _threads? _threads : std::max(1U, std::thread::hardware_concurrency());
+}
+} // anonymous namespace
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Implementation of parallel_parser
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+parallel_parser::parallel_parser(
+  const std::string&                     _filePath,
+  const uint32_t                         _threads,
+  const value::indexed_document_handler& _handler,
+  const bool                             _ordered,
+  const parser_control&                  _ctrl)
+  : m_mmap(_filePath, false),
+    m_threads(thread_count(_threads)),
+    m_handler(_handler), m_ordered(_ordered), m_ctrl(_ctrl), m_chunks(),
+    m_next(0), m_limit(no_chunk), m_stop(false), m_mutex(), m_cv(),
+    m_error(), m_errorChunk(no_chunk), m_results(), m_free(), m_delivered(0), m_delivering(false), m_out()
+{
+}
+
+parser_stats parallel_parser::parse()
+{
+  time_calc tc;
+  tc.start();
+  split();
+
+  m_next = 0;
+  if ( m_ordered )
+    m_results.resize(m_chunks.size());
+  std::vector<parser_stats> totals(m_threads);
+  std::atomic<uint32_t> id(0);
+  run_threads(m_threads, [&]() { parse_chunks(totals[id++]); });
+  if ( m_error )
+    std::rethrow_exception(m_error);
+
+  parser_stats total;
+  for ( const parser_stats& stats : totals )
+    total += stats;
+  tc.stop();
+  total.data_size = m_mmap.size();
+  total.time_ms = tc.diff_millisecs();
+  return total;
+}
+
+void parallel_parser::split()
+{
+  const char* first = m_mmap.begin();
+  const char* last = m_mmap.end() + 1;
+  const size_t chunkSize = std::clamp(m_mmap.size() / (m_threads * 8), min_chunk_size, max_chunk_size);
+  while ( first < last )
+  {
+    // End every chunk after a newline
+    const char* end = last;
+    if ( static_cast<size_t>(last - first) > chunkSize )
+    {
+      const char* newline = static_cast<const char*>(::memchr(first + chunkSize, '\n', last - first - chunkSize));
+      end = newline? newline + 1 : last;
+    }
+    m_chunks.push_back(chunk{first, end, 0});
+    first = end;
+  }
+
+  // Count the records of every chunk in parallel, and then add them up to get the index of the
+  // first record of each of them.
+  m_next = 0;
+  run_threads(m_threads, [this]()
+      {
+        for ( size_t i = m_next++; i < m_chunks.size(); i = m_next++ )
+          m_chunks[i].record = count_records(m_chunks[i].first, m_chunks[i].end);
+      });
+  uint64_t record = 0;
+  for ( chunk& c : m_chunks )
+    record += std::exchange(c.record, record);
+}
+
+void parallel_parser::parse_chunks(parser_stats& _total)
+{
+  // Every thread has its own output. Its storage is used again for the next document.
+  parser_output out;
+  out.reuse = true;
+  const size_t window = chunks_ahead * m_threads;
+  for ( size_t i = m_next++; i < m_chunks.size(); i = m_next++ )
+  {
+    if ( m_stop || i >= m_limit )
+      break;
+    chunk_result result;
+    if ( m_ordered )
+    {
+      // Don't get too far ahead of the delivery, so that only a few chunks are kept in memory
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_cv.wait(lock, [&]() { return i < m_delivered + window || m_stop || i >= m_limit; });
+      if ( m_stop || i >= m_limit )
+        break;
+      // Take the documents of a delivered chunk, and move their storage to the pool of this
+      // thread. The last document goes first, so that the pool gives it back in input order.
+      if ( ! m_free.empty() )
+      {
+        result = std::move(m_free.back());
+        m_free.pop_back();
+        lock.unlock();
+        for ( auto it = result.docs.rbegin(); it != result.docs.rend(); ++it )
+          out.pool.recycle(*it);
+        result.docs.clear();
+        result.stats.clear();
+        result.index.clear();
+        result.ready = false;
+      }
+    }
+
+    const chunk& c = m_chunks[i];
+    uint64_t record = c.record;
+    char_parser_input in(std::string_view(c.first, c.end - c.first), m_mmap.begin(), m_ctrl);
+    char_parser parser(in, out);
+    auto on_document = [&](parser_output& _out)
+      {
+        if ( m_ordered )
+        {
+          result.docs.push_back(std::move(_out.jroot));
+          result.stats.push_back(_out.stats);
+          result.index.push_back(record);
+        }
+        else if ( !m_handler(record, _out) )
+          m_stop = true;
+        record++;
+        // Stop if a chunk before this one failed
+        return !m_stop && i < m_limit;
+      };
+    try
+    {
+      _total += parser.parse_documents(on_document);
+    }
+    catch (...)
+    {
+      result.error = std::current_exception();
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if ( result.error )
+    {
+      // The chunks after this one are not needed any more
+      m_limit = std::min(m_limit.load(), i + 1);
+      if ( !m_ordered && i < m_errorChunk )
+      {
+        m_error = result.error;
+        m_errorChunk = i;
+      }
+      m_cv.notify_all();
+    }
+    if ( m_ordered )
+    {
+      result.ready = true;
+      m_results[i] = std::move(result);
+      deliver(lock);
+    }
+  }
+}
+
+void parallel_parser::deliver(std::unique_lock<std::mutex>& _lock)
+{
+  // Only one thread calls the handler at a time. The others leave their chunks for it.
+  if ( m_delivering )
+    return;
+  m_delivering = true;
+  while ( !m_stop && m_delivered < m_results.size() && m_results[m_delivered].ready )
+  {
+    chunk_result result = std::move(m_results[m_delivered]);
+    _lock.unlock();
+    bool proceed = true;
+    try
+    {
+      for ( size_t k = 0; proceed && k < result.docs.size(); k++ )
+      {
+        // The document goes back to the chunk, to be recycled by the next thread that takes it
+        std::swap(m_out.jroot, result.docs[k]);
+        m_out.stats = result.stats[k];
+        proceed = m_handler(result.index[k], m_out);
+        std::swap(m_out.jroot, result.docs[k]);
+      }
+    }
+    catch (...)
+    {
+      result.error = std::current_exception();
+    }
+    _lock.lock();
+    if ( result.error )
+      m_error = result.error;
+    if ( result.error || !proceed )
+      m_stop = true;
+    else
+      m_free.push_back(std::move(result));
+    m_delivered++;
+    m_cv.notify_all();
+  }
+  m_delivering = false;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Implementation of parallel_array_parser
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+parallel_array_parser::parallel_array_parser(
+  const std::string&    _filePath,
+  const uint32_t        _threads,
+  const parser_control& _ctrl)
+  : m_mmap(_filePath, false), m_threads(thread_count(_threads)), m_ctrl(_ctrl), m_ranges(), m_parts()
+{
+}
+
+void parallel_array_parser::parse(parser_output& _out)
+{
+  time_calc tc;
+  tc.start();
+  if ( ! split() )
+  {
+    // One thread for the whole file
+    char_parser_input in(std::string_view(m_mmap.begin(), m_mmap.size()), nullptr, m_ctrl);
+    char_parser parser(in, _out);
+    parser.parse();
+    return;
+  }
+
+  const size_t count = m_parts.size();
+  std::vector<parser_output> outs(count);
+  std::vector<std::exception_ptr> errors(count);
+  std::atomic<size_t> next(0), failed(count);
+  run_threads(m_threads, [&]()
+    {
+      // The parts after one that failed are not needed
+      for ( size_t i = next++; i < count && i < failed; i = next++ )
+      {
+        const char* end = ( i + 1 < count )? m_parts[i+1] : m_mmap.end() + 1;
+        try
+        {
+          char_parser_input in(std::string_view(m_parts[i], end - m_parts[i]), m_mmap.begin(), m_ctrl);
+          char_parser parser(in, outs[i]);
+          parser.parse_elements(i + 1 == count);
+        }
+        catch (...)
+        {
+          errors[i] = std::current_exception();
+          for ( size_t f = failed; i < f && !failed.compare_exchange_weak(f, i); ) {}
+        }
+      }
+    });
+  for ( const std::exception_ptr& error : errors )
+    if ( error )
+      std::rethrow_exception(error);
+
+  // Move the elements of all the parts into the root array
+  _out.clear();
+  _out.jroot.init(value_type::array);
+  value::array_t& root = *_out.jroot.m_data._arr;
+  size_t elements = 0;
+  for ( const parser_output& out : outs )
+    elements += out.jroot.m_data._arr->size();
+  root.reserve(elements);
+  for ( parser_output& out : outs )
+  {
+    value::array_t& part = *out.jroot.m_data._arr;
+    root.insert(root.end(), std::make_move_iterator(part.begin()), std::make_move_iterator(part.end()));
+    _out.stats += out.stats;
+  }
+  _out.stats.arrays++;
+  _out.stats.documents = 1;
+  _out.stats.data_size = m_mmap.size();
+  tc.stop();
+  _out.stats.time_ms = tc.diff_millisecs();
+}
+
+bool parallel_array_parser::split()
+{
+  // The pre-scan understands only the strict json syntax
+  if ( m_threads < 2 || m_ctrl.mode.flags != 0 )
+    return false;
+  const char* first = m_mmap.begin();
+  const char* last = m_mmap.end() + 1;
+  const char* root = first;
+  while ( root < last && ::isspace(static_cast<unsigned char>(*root)) )
+    root++;
+  if ( root == last || *root != '[' )
+    return false;
+
+  // Ranges are multiples of blocks so that only the last block of the file is partial
+  size_t rangeSize = std::max(m_mmap.size() / (m_threads * 8), min_range_size);
+  rangeSize = (rangeSize + simd::block_size - 1) / simd::block_size * simd::block_size;
+  for ( const char* p = first; p < last; p += std::min(rangeSize, size_t(last - p)) )
+    m_ranges.push_back(range{p, p + std::min(rangeSize, size_t(last - p)), false, {0, 0}, {false, false}, false, 0, nullptr});
+  if ( m_ranges.size() < 2 )
+    return false;
+
+  // Scan the ranges in parallel as if they started outside and inside a string. Then, going
+  // through them in order, the quotes before a range tell which of the two it is.
+  std::atomic<size_t> next(0);
+  run_threads(m_threads, [&]()
+    {
+      for ( size_t i = next++; i < m_ranges.size(); i = next++ )
+        scan(m_ranges[i]);
+    });
+  bool inString = false;
+  int64_t depth = 0;
+  for ( range& r : m_ranges )
+  {
+    r.inString = inString;
+    r.startDepth = depth;
+    // Comments cannot be split
+    if ( r.comment[inString] )
+      return false;
+    depth += r.depth[inString];
+    inString ^= r.quotes;
+  }
+
+  // Split at the first , between elements in every range, except the first one
+  next = 1;
+  run_threads(m_threads, [&]()
+    {
+      for ( size_t i = next++; i < m_ranges.size(); i = next++ )
+        find_split(m_ranges[i]);
+    });
+  m_parts.push_back(root + 1);
+  for ( const range& r : m_ranges )
+    if ( r.split != nullptr && r.split >= m_parts.back() )
+      m_parts.push_back(r.split + 1);
+  return ( m_parts.size() > 1 );
+}
+
+void parallel_array_parser::scan(range& _range) const
+{
+  uint64_t escaped = is_escaped(_range.first)? 1 : 0;
+  uint64_t inString = 0;
+  for ( const char* p = _range.first; p < _range.end; p += simd::block_size )
+  {
+    const size_t len = std::min(simd::block_size, size_t(_range.end - p));
+    const char* block = p;
+    char padded[simd::block_size];
+    if ( len < simd::block_size )
+    {
+      // Pad the last partial block with spaces. We must not read beyond the input.
+      ::memset(padded, ' ', sizeof(padded));
+      ::memcpy(padded, p, len);
+      block = padded;
+    }
+    simd::block_masks masks;
+    simd::classify(block, masks);
+    const uint64_t quote = masks.quote & ~simd::find_escaped(masks.backslash, escaped);
+    // Bits inside strings if the range starts outside a string. The others are inside strings
+    // if it starts inside one.
+    const uint64_t str = simd::prefix_xor(quote) ^ inString;
+    inString = uint64_t(int64_t(str) >> 63);
+
+    _range.depth[0] += __builtin_popcountll(masks.open & ~str) - __builtin_popcountll(masks.close & ~str);
+    _range.depth[1] += __builtin_popcountll(masks.open & str) - __builtin_popcountll(masks.close & str);
+    if ( masks.comment & ~str )
+      _range.comment[0] = true;
+    if ( masks.comment & str )
+      _range.comment[1] = true;
+  }
+  _range.quotes = ( inString != 0 );
+}
+
+void parallel_array_parser::find_split(range& _range) const
+{
+  bool inString = _range.inString;
+  bool escaped = is_escaped(_range.first);
+  int64_t depth = _range.startDepth;
+  for ( const char* p = _range.first; p < _range.end; p++ )
+  {
+    const char ch = *p;
+    if ( inString )
+    {
+      if ( escaped )
+        escaped = false;
+      else if ( ch == '\\' )
+        escaped = true;
+      else if ( ch == '"' )
+        inString = false;
+    }
+    else if ( ch == '"' )
+      inString = true;
+    else if ( ch == '{' || ch == '[' )
+      depth++;
+    else if ( ch == '}' || ch == ']' )
+    {
+      // The root array is closed
+      if ( --depth <= 0 )
+        return;
+    }
+    else if ( ch == ',' && depth == 1 )
+    {
+      _range.split = p;
+      return;
+    }
+  }
+}
+
+bool parallel_array_parser::is_escaped(const char* _p) const
+{
+  const char* p = _p;
+  while ( p > m_mmap.begin() && p[-1] == '\\' )
+    p--;
+  return ( (_p - p) % 2 ) != 0;
+}
@@ -0,0 +1,169 @@
+/*
+LICENSE: BEGIN
+===============================================================================
+@author Shan Anand
+@email anand.gs@gmail.com
+@source https://github.com/shan-anand
+@file parallel_parser.h
+@brief Multi-threaded parser for files of line-delimited json documents
+===============================================================================
+MIT License
+
+Copyright (c) 2017 Shanmuga (Anand) Gunasekaran
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+===============================================================================
+LICENSE: END
+*/
+
+/**
+ * @file  parallel_parser.h
+ * @brief Multi-threaded parsers for memory mapped json files
+ */
+#pragma once
+
+#include "json/value.h"
+#include "memory_map.h"
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <cstdint>
+
+namespace sid::json {
+
+/**
+ * @class parallel_parser
+ * @brief Parses a memory mapped file of line-delimited documents (like JSON Lines) with a pool
+ *        of threads. The file is split at line boundaries into chunks, and each thread parses
+ *        one chunk at a time with its own char_parser and parser_output.
+ */
+class parallel_parser
+{
+public:
+  //! Constructor
+  parallel_parser(
+    const std::string&                     _filePath,
+    const uint32_t                         _threads,
+    const value::indexed_document_handler& _handler,
+    const bool                             _ordered,
+    const parser_control&                  _ctrl);
+
+  //! parse all the documents. Returns the statistics of all of them.
+  parser_stats parse();
+
+private:
+  //! Part of the file parsed by one thread
+  struct chunk
+  {
+    const char* first; //! First character
+    const char* end;    //! After the last character, which is a newline except for the last chunk
+    uint64_t    record; //! Index of the first record
+  };
+  //! Documents of a chunk kept until the chunks before it are delivered (ordered mode)
+  struct chunk_result
+  {
+    bool                      ready = false;
+    std::vector<value>        docs;
+    std::vector<parser_stats> stats;
+    std::vector<uint64_t>     index;
+    std::exception_ptr        error; //! Error after the documents
+  };
+
+  //! Split the file into chunks and find the index of the first record of each of them
+  void split();
+  //! Thread routine that parses chunks until there are none left
+  void parse_chunks(parser_stats& _total);
+  //! Call the handler for the chunks that are next in input order (ordered mode)
+  void deliver(std::unique_lock<std::mutex>& _lock);
+
+private:
+  memory_map                              m_mmap;
+  uint32_t                                m_threads;
+  const value::indexed_document_handler&  m_handler;
+  bool                                    m_ordered;
+  parser_control                          m_ctrl;
+  std::vector<chunk>                      m_chunks;
+  std::atomic<size_t>                     m_next;       //! Next chunk to parse
+  std::atomic<size_t>                     m_limit;      //! Chunks to parse. Lowered by an error.
+  std::atomic<bool>                       m_stop;       //! Stop parsing (error, or the handler asked)
+  std::mutex                              m_mutex;
+  std::condition_variable                 m_cv;
+  std::exception_ptr                      m_error;      //! First error in input order (unordered mode)
+  size_t                                  m_errorChunk; //! Chunk of m_error
+  std::vector<chunk_result>               m_results;    //! Parsed chunks not yet delivered (ordered mode)
+  std::vector<chunk_result>               m_free;       //! Delivered chunks to reuse (ordered mode)
+  size_t                                  m_delivered;  //! Chunks delivered (ordered mode)
+  bool                                    m_delivering; //! A thread is delivering (ordered mode)
+  parser_output                           m_out;        //! Output given to the handler (ordered mode)
+};
+
+/**
+ * @class parallel_array_parser
+ * @brief Parses a memory mapped json file whose root is an array with a pool of threads. A
+ *        vectorized pre-scan finds the , between the elements of the root array, and the file
+ *        is split at them into parts. Each thread parses one part at a time with its own
+ *        char_parser, and the elements of all the parts are moved into the root array.
+ */
+class parallel_array_parser
+{
+public:
+  //! Constructor
+  parallel_array_parser(
+    const std::string&    _filePath,
+    const uint32_t        _threads,
+    const parser_control& _ctrl);
+
+  //! parse the file into _out. Throws std::exception if parsing fails.
+  void parse(parser_output& _out);
+
+private:
+  //! Part of the file scanned by one thread
+  struct range
+  {
+    const char* first;
+    const char* end;
+    bool        quotes;     //! Odd number of unescaped quotes
+    int64_t     depth[2];   //! Change of the nesting depth if it starts outside [0] or inside [1] a string
+    bool        comment[2]; //! Has a comment outside strings if it starts outside [0] or inside [1] a string
+    bool        inString;   //! Starts inside a string
+    int64_t     startDepth; //! Nesting depth at the start. The root array is at depth 1.
+    const char* split;      //! First , between elements of the root array, or nullptr
+  };
+
+  //! Find the parts of the file. Returns false if it must be parsed by one thread.
+  bool split();
+  //! Find the quotes, the change of the nesting depth and the comments of a range
+  void scan(range& _range) const;
+  //! Find the first , between elements of the root array in a range
+  void find_split(range& _range) const;
+  //! Whether the character at _p is escaped by the backslashes before it
+  bool is_escaped(const char* _p) const;
+
+private:
+  memory_map               m_mmap;
+  uint32_t                 m_threads;
+  parser_control           m_ctrl;
+  std::vector<range>       m_ranges;
+  std::vector<const char*> m_parts;   //! Start of each part. A part ends where the next one starts.
+};
+
+} // namespace sid::json
@@ -0,0 +1,77 @@
+/*
+LICENSE: BEGIN
+===============================================================================
+@author Shan Anand
+@email anand.gs@gmail.com
+@source https://github.com/shan-anand
+@file parse_error.cpp
+@brief Json handling using c++
+===============================================================================
+MIT License
+
+Copyright (c) 2017 Shanmuga (Anand) Gunasekaran
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+===============================================================================
+LICENSE: END
+*/
+
+/**
+ * @file  parse_error.cpp
+ * @brief Implementation of the parse errors
+ */
+#include "json/parse_error.h"
+
+using namespace sid::json;
+
+/*static*/
+const char* parse_error::to_str(const code _code)
+{
+  switch ( _code )
+  {
+  case code::none:                return "No error";
+  case code::invalid_schema:      return "Invalid schema given for validation";
+  case code::end_of_data:         return "End of data reached";
+  case code::expected_root:       return "Expecting { or [";
+  case code::expected_colon:      return "Expected : after the object key";
+  case code::expected_key:        return "End of object character } found while expecting a key";
+  case code::expected_element:    return "End of array character ] found while expecting a value";
+  case code::expected_value:      return "Expected value not found";
+  case code::expected_separator:  return "Expected , or the end of the object or array";
+  case code::trailing_data:       return "Invalid character after the root is closed";
+  case code::max_depth:           return "Maximum nesting depth exceeded";
+  case code::duplicate_key:       return "Duplicate key encountered";
+  case code::invalid_string:      return "Invalid string";
+  case code::invalid_escape:      return "Invalid escape sequence";
+  case code::invalid_unicode:     return "Invalid \\u escape sequence";
+  case code::invalid_utf8:        return "Invalid UTF-8 string";
+  case code::invalid_value:       return "Invalid value";
+  case code::invalid_number:      return "Invalid number";
+  case code::number_out_of_range: return "Number out of range";
+  case code::invalid_comment:     return "Invalid comment";
+  case code::unsupported_mode:    return "Parsing mode not supported";
+  case code::schema_violation:    return "Schema violation";
+  }
+  return "Unknown error";
+}
+
+std::string parse_error::message() const
+{
+  return std::string(to_str(id)) + " at offset " + std::to_string(offset);
+}
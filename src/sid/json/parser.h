@@ -37,19 +37,61 @@ LICENSE: END
 #include "json/schema.h"
 #include "json/parser_stats.h"
 #include "json/parser_control.h"
+#include "json/parse_error.h"
+#include "json/sax_handler.h"
+#include "path_filter.h"
 #include "parser_io.h"
 #include "time_calc.h"
 #include "utils.h"
 #include "memory_map.h"
+#include "structural_index.h"
 #include <istream>
-#include <stack>
+#include <deque>
 #include <string>
 #include <cstdint>
 #include <memory>
 #include <cstring>
+#include <cstdio>
+#include <vector>
+#include <unordered_set>
+#include <algorithm>
 
 namespace sid::json {
 
+/**
+ * @class small_stack
+ * @brief Stack that keeps the first N elements inline and spills to the heap beyond that
+ */
+template <typename T, size_t N>
+class small_stack
+{
+public:
+  bool empty() const { return m_size == 0; }
+  size_t size() const { return m_size; }
+  void clear() { m_size = 0; m_spill.clear(); }
+  T& top() { return ( m_size <= N )? m_inline[m_size-1] : m_spill.back(); }
+  const T& top() const { return ( m_size <= N )? m_inline[m_size-1] : m_spill.back(); }
+  void push(const T& _val)
+  {
+    if ( m_size < N )
+      m_inline[m_size] = _val;
+    else
+      m_spill.push_back(_val);
+    ++m_size;
+  }
+  void pop()
+  {
+    if ( m_size > N )
+      m_spill.pop_back();
+    --m_size;
+  }
+
+private:
+  T              m_inline[N];
+  std::vector<T> m_spill;
+  size_t         m_size = 0;
+};
+
 /**
  * @struct parser
  * @brief Internal json parser
@@ -59,18 +101,105 @@ struct parser
 {
   const parser_input& m_in;
   parser_output&      m_out;
-  schema*             m_schema; //! Optional schema to validate against
+  const schema*       m_schema; //! Optional schema to validate against while parsing (parse)
 
   //! parse and convert to json object. Throws std::exception if parsing fails.
   void parse();
+  //! parse and convert to json object without throwing. Returns the first error. Its message is
+  //! not formatted, and nothing is thrown or unwound for it.
+  parse_error try_parse();
+  //! parse input of multiple documents, calling the handler after each of them. Returns the
+  //! statistics of all the documents. Throws std::exception if parsing fails.
+  parser_stats parse_documents(const value::document_handler& _handler);
+  //! parse a part of the elements of the root array, for parsers that split it among threads.
+  //! The input starts at an element. Unless it is the _last part, it ends after the , that
+  //! follows its last element. The elements are parsed into m_out.jroot as an array.
+  void parse_elements(const bool _last);
+  //! parse and call the handler for every event instead of building m_out.jroot. Returns the
+  //! statistics. Throws std::exception if parsing fails.
+  parser_stats parse_events(sax_handler& _handler);
+  //! parse only the values of the paths into m_out.jroot, with the objects and arrays on the
+  //! way to them. The others are skipped without decoding them. Parsing stops once the values
+  //! of all the paths are parsed, unless they have wildcards. Throws std::exception if parsing
+  //! fails.
+  void parse_paths(path_filter& _filter);
+  //! check the start of the root and call the handler for the events one step at a time. Every
+  //! event of the handler must return false to stop at it (see next_event).
+  void begin_events(sax_handler& _handler);
+  //! continue until the handler stops at the next event. Returns false, after checking the rest
+  //! of the input, once the root is closed.
+  bool next_event();
+  //! skip the rest of the object or array whose start was the last event, up to its end event,
+  //! which is the next one. Only the strings and the nesting of the skipped values are checked.
+  //! Returns false, without skipping anything, for flexible parsing modes.
+  bool skip_container();
+  //! check the input without decoding it, for lazy decoding. Only the strings and the nesting
+  //! within the root are checked. Gets the range of the root object or array.
+  void skip_document(pos_type& _first, pos_type& _end);
+  //! parse the object or array that starts the input, for lazy decoding. _member is called for
+  //! every member with its key (empty for arrays), the range of its value and the decoded value
+  //! of a scalar (nullptr for objects and arrays). Nested objects and arrays are not decoded.
+  //! A duplicate key fails here with dup_key::reject. The other policies are left to _member.
+  template <typename Member> void index_container(Member&& _member);
 
 protected:
-  using ContinerStack = std::stack<value_type>;
-  ContinerStack       m_containerStack; //! Container stack
+  //! Object or array being parsed
+  struct frame
+  {
+    value*     container; //! The object or array value
+    value_type type;      //! value_type::object or value_type::array
+    bool       ignored;   //! The current member value goes to m_ignored (dup_key::ignore)
+    path_node* filter;    //! Only the members that match it are parsed (nullptr for all of them)
+    uint64_t   index;     //! Number of elements of a filtered array
+    bool       checked = false; //! The container is validated against m_schema
+    const schema::property* rule = nullptr; //! Constraints of the container (nullptr for the root)
+  };
+  using frame_stack = small_stack<frame, 32>;
+  frame_stack         m_frames;  //! Containers from the root to the current one
+  std::deque<value>   m_ignored; //! Values of ignored duplicate keys, one per nesting level
+
+  //! Where parse_document() continues
+  enum class doc_state : uint8_t {
+    value,   //! Parse a value into m_target
+    next,    //! A value is complete. Continue with the next member of the container or close it.
+    closing, //! Close the container. It is empty.
+    member,  //! Continue with the first member of the container
+    done     //! The root is closed
+  };
+  doc_state           m_state;   //! Where parse_document() continues
+  value*              m_target;  //! Value to parse into in doc_state::value
+  bool                m_openEnded; //! The input ends after a , of the root array (parse_elements)
+  sax_handler*        m_handler; //! Receives the events instead of building m_out.jroot (parse_events)
+  bool                m_stopped; //! The handler stopped parsing
+  value_type          m_rootType; //! Type of the root of the current document
+  value               m_scalar;  //! Scalar decoded for the handler, and the target of all values
+  path_filter*        m_filter;  //! Only the values of these paths are parsed (parse_paths)
+  path_node*          m_node;    //! Step of m_filter for m_target (nullptr for all of it)
+  bool                m_skip;    //! The value at doc_state::value is skipped (m_filter)
+  bool                m_found;   //! All the paths of m_filter are found
+  const schema::property* m_rule; //! Constraints of m_schema for m_target (nullptr for none)
+  bool                m_throw;   //! Errors are thrown. Otherwise they are kept in m_error (try_parse).
+  parse_error         m_error;   //! The first error when they are not thrown
+  uint64_t            m_chunks;  //! Chunks taken by the arena of m_out before the document
 
   //! constructor
   parser(const parser_input& _in, parser_output& _out)
-    : m_in(_in), m_out(_out), m_schema(nullptr), m_containerStack() {}
+    : m_in(_in), m_out(_out), m_schema(nullptr), m_frames(), m_ignored(),
+      m_state(doc_state::value), m_target(nullptr), m_openEnded(false),
+      m_handler(nullptr), m_stopped(false), m_rootType(value_type::null), m_scalar(),
+      m_filter(nullptr), m_node(nullptr), m_skip(false), m_found(false), m_rule(nullptr),
+      m_throw(true), m_error(), m_chunks(0) {}
+
+  //! check the start of the root object or array and prepare parse_document() for it
+  void begin_document();
+  //! parse the root object or array and everything in it without recursion. Returns false if
+  //! it stopped because the derived class is not ready() with the input for the next step.
+  bool parse_document();
+  //! ensure there is nothing but spaces and comments after the root
+  void end_document();
+  //! skip the spaces, comments and record separators before the next document of multi-document
+  //! input. Returns false at the end of the input.
+  bool skip_document_separators();
 
 private:
   Derived& derived() { return static_cast<Derived&>(*this); }
@@ -89,43 +218,97 @@ private:
   size_t processed() const { return derived().s_processed(); }
   // This function should not change the current position
   pos_type add(pos_type _pos,  int _value) const { return derived().s_add(_pos, _value); }
+  // Fast path support. Derived classes return the bytes available from the current position
+  // [_cur, _end) without reading more input, or false if they cannot. Anything that reaches
+  // _end may continue beyond it and must be handled with the per character callbacks above.
+  bool window(const char*& _cur, const char*& _end) { return derived().s_window(_cur, _end); }
+  // Consume _n bytes of the window
+  void consume(size_t _n) { derived().s_consume(_n); }
+  // Get the first token (see structural_index) at or after _pos within the window.
+  // Returns false if it is not known.
+  bool next_token(const char* _pos, const char*& _token) { return derived().s_next_token(_pos, _token); }
+  // The window up to _pos was consumed without looking at its tokens. _pos is not in a string.
+  void skipped(const char* _pos) { derived().s_skipped(_pos); }
+  // Get the line and column (both starting at 1) of _pos
+  void location(pos_type _pos, uint64_t& _line, uint64_t& _column) const {
+    derived().s_location(_pos, _line, _column);
+  }
+  // Check that the input for the next step of parse_document() is available. A step parses at
+  // most an opening or closing character, a separator, a key, a : and a value without nested
+  // values, and looks at the first character after it.
+  bool ready() { return derived().s_ready(); }
+  // Keep the input from _pos available for location() until unpin() is called
+  void pin(pos_type _pos) { derived().s_pin(_pos); }
+  void unpin() { derived().s_unpin(); }
   ///////////////////////////////////////////////////////
 
-  struct line_info
-  {
-    pos_type begin; //! Beginning of word position
-    uint64_t count; //! Current line number
-  };
   //! Key value for object. It is reused in recursion.
   std::string m_key;
-  line_info   m_line;
+  //! Characters of a number that could not be decoded in place. It is reused across numbers.
+  std::string m_numStr;
+  //! Decoded string value. It is copied into the value, which keeps a short one in place.
+  std::string m_str;
+  //! Reason of a schema violation
+  std::string m_reason;
 
-  inline void handle_newline() {
-    ++m_line.count;
-    m_line.begin = add(tellg(), 1);
+  //! get the location of a position in the input. Lines are not tracked while parsing, they are
+  //! counted only when a location is needed for an error message.
+  inline std::string loc_str(pos_type p) const {
+    uint64_t line = 1, column = 1;
+    location(p, line, column);
+    return std::string("@line:") + std::to_string(line) + ", @pos:" + std::to_string(column);
   }
+  inline std::string loc_str() const { return loc_str(tellg()); }
 
-  //! get the current location of paring in the string
-  inline std::string loc_str(const line_info& line, pos_type p) const {
-    return std::string("@line:") + std::to_string(line.count) + ", @pos:" + std::to_string(p-line.begin+1);
-  }
-  inline std::string loc_str(const line_info& line) const { return loc_str(line, tellg()); }
-  inline std::string loc_str(pos_type p) const { return loc_str(m_line, p); }
-  inline std::string loc_str() const { return loc_str(m_line, tellg()); }
+  //! end character of the current container
+  inline char container_end() const { return ( m_frames.top().type == value_type::object )? '}' : ']'; }
 
-  //! parse object
-  void parse_object(value& _jobj);
-  //! parse array
-  void parse_array(value& _jarr);
+  //! parse the key and : of an object member. Returns the value to parse the member into.
+  value* parse_member(frame& _frame);
+  //! append an element to the array. Returns the value to parse the element into.
+  value* append_element(frame& _frame);
+  //! select the member of a filtered container for m_target. Returns false if it is skipped.
+  bool select(path_node* _node);
+  //! select the constraints of m_schema for the member of a validated object as m_rule. A new
+  //! member is checked against the maximum number of members.
+  void select_rule(const frame& _frame, const std::string_view _key, const bool _isNew);
+  //! check the type of an object or array against m_schema before it is opened
+  void check_type(const value_type _type);
+  //! check the members of a validated object or array against m_schema when it is closed
+  void check_container(const frame& _frame);
+  //! skip the value at the current position without decoding it. Returns false, without
+  //! skipping anything, for objects and arrays in flexible parsing modes.
+  bool skip_value();
   //! parse key
   void parse_key(std::string& _str);
   //! parse string
   void parse_string(std::string& _str, bool _isKey);
   void parse_string(value& _jstr, bool _isKey);
+  //! parse a quoted string a run of bytes at a time. Returns false if it cannot be used.
+  bool parse_quoted_string(std::string& _str);
+  //! ensure the decoded string is valid UTF-8 (parser_control::checkUtf8)
+  void check_utf8(const std::string_view _str);
   //! parser number
   void parse_number(value& _jnum);
-  //! parse json value
-  void parse_value(value& _jval);
+  //! parse json value other than object and array
+  void parse_scalar(value& _jval);
+  //! get a quoted string without escape sequences as a view of the input. Returns false, without
+  //! consuming anything, if it cannot.
+  bool quoted_view(std::string_view& _view);
+  //! parse a key and call the handler. Returns false if the handler stopped parsing.
+  bool emit_key();
+  //! parse json value other than object and array and call the handler
+  void emit_scalar();
+  //! the handler stopped parsing
+  void stop() { m_stopped = true; }
+  //! report an error. The message is formatted and thrown, unless errors are kept (try_parse).
+  //! Then only the first error is kept, and parsing stops. The caller must return at once.
+  template <typename Message> void fail(const parse_error::code _code, Message&& _message);
+  //! an error is kept (try_parse)
+  bool failed() const { return static_cast<bool>(m_error); }
+  //! skip the object or array at the current position, without decoding it. Returns the position
+  //! after its end.
+  pos_type skip_nested();
 
   //! check for space character
   bool is_space();
@@ -138,6 +321,7 @@ struct char_parser : public parser<char_parser, char_parser_input, const char*>
   using pos_type = const char*;
   std::unique_ptr<memory_map> m_mmap;
   pos_type m_pos, m_first, m_last;
+  structural_index m_index;
 
   //! constructor
   char_parser(const char_parser_input& _in, parser_output& _out)
@@ -155,6 +339,26 @@ struct char_parser : public parser<char_parser, char_parser_input, const char*>
   inline bool s_eof() const { return m_pos > m_last; }
   inline pos_type s_add(pos_type _pos,  int _value) const { return _pos + _value; }
   inline size_t s_processed() const { return static_cast<size_t>(m_pos-m_first); }
+  inline bool s_window(const char*& _cur, const char*& _end) const {
+    _cur = m_pos; _end = m_last + 1; return true;
+  }
+  inline void s_consume(size_t _n) { m_pos += _n; }
+  inline bool s_next_token(const char* _pos, const char*& _token) {
+    return m_index.next(_pos, _token);
+  }
+  inline void s_skipped(const char* _pos) { m_index.skip_to(_pos); }
+  inline bool s_ready() const { return true; }
+  void s_location(pos_type _pos, uint64_t& _line, uint64_t& _column) const
+  {
+    // Count the newlines from the beginning of the input
+    const pos_type first = m_in.origin? m_in.origin : m_first;
+    const pos_type to = std::min(_pos, m_last + 1);
+    const pos_type begin = ( to > first )? static_cast<pos_type>(::memrchr(first, '\n', to - first)) : nullptr;
+    _line = ( begin != nullptr )? simd::count_newlines(first, begin) + 2 : 1;
+    _column = static_cast<uint64_t>(_pos - (begin? begin + 1 : first)) + 1;
+  }
+  inline void s_pin(pos_type) {}
+  inline void s_unpin() {}
 
   void s_init()
   {
@@ -162,48 +366,250 @@ struct char_parser : public parser<char_parser, char_parser_input, const char*>
     {
     case input_type::data:
       // Set the first and last positions
-      m_first = m_in.input.c_str();
+      m_first = m_in.input.data();
       m_last = m_first + m_in.input.length() - 1;
       break;
     case input_type::file_path:
-      m_mmap = std::make_unique<memory_map>(m_in.input);
+      m_mmap = std::make_unique<memory_map>(std::string(m_in.input));
       // Set the first and last positions
       m_first = m_mmap->begin();
       m_last = m_mmap->end();
       break;
     }
-    s_seekg(m_first);
+    // Empty input has m_last before m_first. So, don't use s_seekg here.
+    m_pos = m_first;
+    // The structural index understands only the strict json syntax
+    if ( m_in.ctrl.mode.flags == 0 )
+      m_index.reset(m_first, m_last + 1);
+    else
+      m_index.disable();
   }
 };
 
 struct buffer_parser : public parser<buffer_parser, buffer_parser_input, std::streampos>
 {
   using pos_type = std::streampos;
-  pos_type m_pos, m_first;
+  //! Size of the blocks read from the stream buffer
+  static constexpr size_t block_size = 64 * 1024;
+  //! Bytes kept from the previous block so that the parser can go back a few characters
+  static constexpr size_t keep_size = 64;
+
+  std::vector<char> m_buf;  //! Window of the stream data
+  const char* m_cur;        //! Current position in the window
+  const char* m_end;        //! End of the data in the window
+  pos_type m_base, m_first; //! Stream position of the window and of the input
+  uint64_t m_lines;         //! Newlines before the window
+  pos_type m_lineBegin;     //! Position after the last newline before the window
+  pos_type m_pin;           //! Data from this position is kept in the window (-1 if none)
   //! constructor
   buffer_parser(const buffer_parser_input& _in, parser_output& _out)
-    : parser(_in, _out) {}
+    : parser(_in, _out), m_cur(nullptr), m_end(nullptr) {}
 
-  inline pos_type s_tellg() const { return m_pos; }
-  inline pos_type s_seekg(pos_type _pos) {
-    return (m_pos = m_in.sbuf.pubseekpos(_pos, std::ios_base::in));
+  inline pos_type s_tellg() const { return m_base + static_cast<std::streamoff>(m_cur - m_buf.data()); }
+  inline pos_type s_seekg(pos_type _pos)
+  {
+    if ( _pos >= m_base && _pos <= s_add(m_base, static_cast<int>(m_end - m_buf.data())) )
+    {
+      m_cur = m_buf.data() + static_cast<std::streamoff>(_pos - m_base);
+      if ( m_cur == m_end ) fill();
+    }
+    else if ( m_in.sbuf.pubseekpos(_pos, std::ios_base::in) == _pos )
+    {
+      // Outside of the window. Start over from the given position. The parser goes back only
+      // within the window, so the line counts are left as they are.
+      m_base = _pos;
+      m_cur = m_end = m_buf.data();
+      fill();
+    }
+    return s_tellg();
   }
-  inline char s_peek() const { return (char) m_in.sbuf.sgetc(); }
+  inline char s_peek() const { return ( m_cur < m_end )? *m_cur : (char) EOF; }
   inline char s_next() {
-    int v = m_in.sbuf.snextc();
-    if ( v != EOF ) m_pos = s_add(m_pos, 1);
-    return (char) v;
+    if ( m_cur < m_end && ++m_cur == m_end ) fill();
+    return s_peek();
   }
-  inline bool s_eof() const { return m_in.sbuf.sgetc() == EOF; }
+  inline bool s_eof() const { return m_cur == m_end; }
   inline pos_type s_add(pos_type _pos,  int _value) const {
     return _pos + static_cast<pos_type>(_value);
   }
-  inline size_t s_processed() const { return static_cast<size_t>(m_pos-m_first+1); }
+  inline size_t s_processed() const { return static_cast<size_t>(s_tellg()-m_first); }
+  inline bool s_window(const char*& _cur, const char*& _end) const {
+    _cur = m_cur; _end = m_end; return true;
+  }
+  inline void s_consume(size_t _n) { if ( (m_cur += _n) == m_end ) fill(); }
+  inline bool s_next_token(const char*, const char*&) { return false; }
+  inline void s_skipped(const char*) {}
+  inline bool s_ready() const { return true; }
+  void s_location(pos_type _pos, uint64_t& _line, uint64_t& _column) const
+  {
+    // The lines before the window are counted as it moves. Count the rest within the window.
+    uint64_t lines = m_lines;
+    pos_type begin = m_lineBegin;
+    if ( _pos > m_base )
+    {
+      const char* first = m_buf.data();
+      const char* to = first + std::min<std::streamoff>(_pos - m_base, m_end - first);
+      if ( const size_t n = simd::count_newlines(first, to) )
+      {
+        lines += n;
+        begin = s_add(m_base, static_cast<int>(static_cast<const char*>(::memrchr(first, '\n', to - first)) + 1 - first));
+      }
+    }
+    _line = lines + 1;
+    _column = ( _pos >= begin )? static_cast<uint64_t>(_pos - begin) + 1 : 1;
+  }
+  inline void s_pin(pos_type _pos) { m_pin = _pos; }
+  inline void s_unpin() { m_pin = pos_type(-1); }
+
+  //! Read the next block once the window is consumed. Returns false at the end of the stream.
+  bool fill()
+  {
+    // Keep a few bytes for going back, and everything from the pinned position
+    size_t keep = std::min<size_t>(m_end - m_buf.data(), keep_size);
+    if ( m_pin != pos_type(-1) && m_pin >= m_base )
+      keep = std::max<size_t>(keep, static_cast<size_t>(s_add(m_base, static_cast<int>(m_end - m_buf.data())) - m_pin));
+    // Count the lines of the data leaving the window
+    const char* first = m_buf.data();
+    const char* last = m_end - keep;
+    if ( const size_t n = simd::count_newlines(first, last) )
+    {
+      m_lines += n;
+      m_lineBegin = s_add(m_base, static_cast<int>(static_cast<const char*>(::memrchr(first, '\n', last - first)) + 1 - first));
+    }
+    if ( keep )
+      ::memmove(m_buf.data(), last, keep);
+    m_base += static_cast<std::streamoff>(last - first);
+    if ( m_buf.size() < keep + block_size )
+      m_buf.resize(keep + block_size);
+    const std::streamsize n = m_in.sbuf.sgetn(m_buf.data() + keep, block_size);
+    m_cur = m_buf.data() + keep;
+    m_end = m_cur + std::max<std::streamsize>(n, 0);
+    return m_cur < m_end;
+  }
 
   void s_init()
   {
-    m_first = m_pos = m_in.sbuf.pubseekoff(0, std::ios_base::beg, std::ios_base::in);
+    m_first = m_in.sbuf.pubseekoff(0, std::ios_base::beg, std::ios_base::in);
+    // Input that cannot be positioned (like a pipe) is read from where it is
+    if ( m_first == pos_type(-1) )
+      m_first = 0;
+    m_buf.resize(keep_size + block_size);
+    m_base = m_lineBegin = m_first;
+    m_lines = 0;
+    m_pin = pos_type(-1);
+    m_cur = m_end = m_buf.data();
+    fill();
+  }
+};
+
+struct chunk_parser : public parser<chunk_parser, chunk_parser_input, uint64_t>
+{
+  using pos_type = uint64_t;
+  //! Complete tokens needed ahead of a step of parse_document() (see ready())
+  static constexpr size_t lookahead = 4;
+
+  //! State of the token scanner where the last chunk ended
+  enum class scan_state : uint8_t {
+    space,              //! Between tokens
+    quoted,             //! Within a quoted string
+    quoted_escape,      //! After a \ within a quoted string
+    bare,               //! Within a number, a literal or an unquoted string
+    bare_escape,        //! After a \ within an unquoted string
+    slash,              //! After a / that may start a comment
+    line_comment,       //! Within a # or // comment
+    block_comment,      //! Within a /* comment
+    block_comment_star  //! After a * within a /* comment
+  };
+
+  std::vector<char> m_buf;        //! Input kept from the previous chunks
+  const char* m_data;             //! Input being parsed. It is m_buf, or the chunk being fed.
+  size_t m_size;                  //! Size of m_data
+  size_t m_cur;                   //! Current position in m_data
+  pos_type m_base;                //! Input position of the start of m_data
+  uint64_t m_lines;               //! Newlines before m_data
+  pos_type m_lineBegin;           //! Position after the last newline before m_data
+  std::vector<pos_type> m_tokens; //! End positions of the complete tokens
+  size_t m_token;                 //! First token in m_tokens that is not consumed
+  scan_state m_scan;              //! Scanner state at the end of m_data
+  pos_type m_tokenFirst;          //! Start of the token being scanned
+  bool m_bareEnd[256];            //! Characters that end a number, a literal or an unquoted string
+  bool m_begun;                   //! begin_document() is done
+  bool m_finished;                //! All the input is fed
+  bool m_failed;                  //! Parsing failed. The parser cannot continue.
+  uint64_t m_micros;              //! Time spent parsing
+
+  //! constructor
+  chunk_parser(const chunk_parser_input& _in, parser_output& _out);
+
+  //! Add a chunk of input and parse as far as the complete tokens go
+  void feed(const char* _data, size_t _len);
+  //! Parse the rest of the input once all of it is fed
+  void finish();
+  //! The root object or array is closed
+  bool done() const { return m_state == doc_state::done; }
+
+  inline pos_type s_tellg() const { return m_base + m_cur; }
+  inline pos_type s_seekg(pos_type _pos)
+  {
+    if ( _pos >= m_base && _pos <= m_base + m_size )
+      m_cur = static_cast<size_t>(_pos - m_base);
+    return s_tellg();
+  }
+  inline char s_peek() const { return ( m_cur < m_size )? m_data[m_cur] : (char) EOF; }
+  inline char s_next() {
+    if ( m_cur < m_size ) ++m_cur;
+    return s_peek();
+  }
+  inline bool s_eof() const { return m_cur == m_size; }
+  inline pos_type s_add(pos_type _pos,  int _value) const { return _pos + _value; }
+  inline size_t s_processed() const { return static_cast<size_t>(s_tellg()); }
+  inline bool s_window(const char*& _cur, const char*& _end) const {
+    _cur = m_data + m_cur; _end = m_data + m_size; return true;
+  }
+  inline void s_consume(size_t _n) { m_cur += _n; }
+  inline bool s_next_token(const char*, const char*&) { return false; }
+  inline void s_skipped(const char*) {}
+  inline bool s_ready()
+  {
+    // Skip the tokens the parser has gone past
+    const pos_type pos = s_tellg();
+    while ( m_token < m_tokens.size() && m_tokens[m_token] <= pos )
+      ++m_token;
+    return m_finished || m_tokens.size() - m_token >= lookahead;
+  }
+  void s_location(pos_type _pos, uint64_t& _line, uint64_t& _column) const
+  {
+    // The lines of the dropped input are counted as it is dropped. Count the rest in m_data.
+    uint64_t lines = m_lines;
+    pos_type begin = m_lineBegin;
+    if ( _pos > m_base )
+    {
+      const char* first = m_data;
+      const char* to = first + std::min<uint64_t>(_pos - m_base, m_size);
+      if ( const size_t n = simd::count_newlines(first, to) )
+      {
+        lines += n;
+        begin = m_base + (static_cast<const char*>(::memrchr(first, '\n', to - first)) + 1 - first);
+      }
+    }
+    _line = lines + 1;
+    _column = ( _pos >= begin )? static_cast<uint64_t>(_pos - begin) + 1 : 1;
   }
+  // The input is dropped only between the steps of parse_document()
+  inline void s_pin(pos_type) {}
+  inline void s_unpin() {}
+  void s_init();
+
+private:
+  //! Find the tokens completed by m_data[_from...]
+  void scan(size_t _from);
+  //! Parse as far as the complete tokens go
+  void advance();
+  //! Forget the input before the current position. What is left is kept in m_buf.
+  void drop();
+  //! Check that the parser can continue, and set the statistics after parsing
+  void check_usable() const;
+  void set_stats(time_calc& _tc);
 };
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -249,36 +655,21 @@ void parser<Derived, parser_input, pos_type>::parse()
 
   try
   {
-    if ( m_schema && m_schema->empty() )
-      throw std::runtime_error("Invalid schema given for validation");
-
     m_out.clear();
     tc.start();
-    // Call the specialization class's init method
-    init();
-    // Initialize local objects for parsing
-    m_line.begin = tellg();
-    m_line.count = 1;
-    if ( !skip_leading_spaces() )
-      throw std::runtime_error(std::string("End of data reached ") + loc_str() + ". Expecting { or [");
-
-    switch ( peek() )
+    if ( m_schema && m_schema->empty() )
+      fail(parse_error::code::invalid_schema, [&]{ return std::string("Invalid schema given for validation"); });
+    else
     {
-    case '{':
-      parse_object(m_out.jroot);
-      break;
-    case '[':
-      parse_array(m_out.jroot);
-      break;
-    default:
-      throw std::runtime_error(std::string("Invalid character [") + peek() + "] " + loc_str()
-                          + ". Expecting { or [");
+      // Call the specialization class's init method
+      init();
+      begin_document();
+      parse_document();
+      if ( !m_stopped )
+        end_document();
     }
-    // Ensure there are no invalid trailing characters
-    if ( skip_leading_spaces() )
-      throw std::runtime_error(std::string("Invalid character [") + peek() + "] " + loc_str()
-                        + " after the root " + to_str(m_out.jroot.type()) + " is closed");
 
+    m_out.stats.documents = 1;
     m_out.stats.data_size = processed();
     tc.stop();
     m_out.stats.time_ms = tc.diff_millisecs();
@@ -294,125 +685,843 @@ void parser<Derived, parser_input, pos_type>::parse()
 }
 
 template <typename Derived, typename parser_input, typename pos_type>
-void parser<Derived, parser_input, pos_type>::parse_object(value& _jobj)
+parse_error parser<Derived, parser_input, pos_type>::try_parse()
 {
-  char ch = 0;
-  if ( ! _jobj.is_object() )
-    _jobj.init(value_type::object);
+  // Errors are thrown again afterwards, also when something else is thrown from parse()
+  struct throw_guard
+  {
+    bool& flag;
+    ~throw_guard() { flag = true; }
+  } guard{m_throw};
+  m_throw = false;
+  m_error.clear();
+  m_stopped = false;
+  parse();
+  return m_error;
+}
 
-  m_containerStack.push(value_type::object);
-  m_out.stats.objects++;
-  for ( bool firstTime = true; true; firstTime = false )
+template <typename Derived, typename parser_input, typename pos_type>
+template <typename Message>
+void parser<Derived, parser_input, pos_type>::fail(const parse_error::code _code, Message&& _message)
+{
+  if ( m_throw )
+    throw std::runtime_error(_message());
+  if ( !m_error )
   {
-    next();
-    // "string" : value
-    if ( !skip_leading_spaces() )
-      throw std::runtime_error("End of data reached " + loc_str() + " while expecting an object key or }");
-    // This is the case where there are no elements in the object (An empty object)
-    if ( peek() == '}' )
+    m_error.id = _code;
+    m_error.offset = processed();
+  }
+  stop();
+}
+
+template <typename Derived, typename parser_input, typename pos_type>
+parser_stats parser<Derived, parser_input, pos_type>::parse_events(sax_handler& _handler)
+{
+  m_handler = &_handler;
+  m_stopped = false;
+  try
+  {
+    parse();
+  }
+  catch (...)
+  {
+    m_handler = nullptr;
+    throw;
+  }
+  m_handler = nullptr;
+  return m_out.stats;
+}
+
+template <typename Derived, typename parser_input, typename pos_type>
+void parser<Derived, parser_input, pos_type>::parse_paths(path_filter& _filter)
+{
+  m_filter = &_filter;
+  m_stopped = m_found = false;
+  try
+  {
+    parse();
+  }
+  catch (...)
+  {
+    m_filter = nullptr;
+    throw;
+  }
+  m_filter = nullptr;
+}
+
+template <typename Derived, typename parser_input, typename pos_type>
+void parser<Derived, parser_input, pos_type>::begin_events(sax_handler& _handler)
+{
+  m_handler = &_handler;
+  m_stopped = false;
+  m_out.clear();
+  init();
+  begin_document();
+}
+
+template <typename Derived, typename parser_input, typename pos_type>
+bool parser<Derived, parser_input, pos_type>::next_event()
+{
+  if ( m_state == doc_state::done )
+  {
+    // Check the rest of the input only once
+    if ( m_handler )
     {
-      if ( !firstTime )
-        throw std::runtime_error("End of object character } found at" + loc_str() + " while expecting a key");
+      m_handler = nullptr;
+      end_document();
+    }
+    return false;
+  }
+  m_stopped = false;
+  parse_document();
+  return true;
+}
+
+template <typename Derived, typename parser_input, typename pos_type>
+bool parser<Derived, parser_input, pos_type>::skip_container()
+{
+  // Unquoted strings may have any of the characters counted below
+  if ( m_in.ctrl.mode.allowFlexibleKeys || m_in.ctrl.mode.allowFlexibleStrings )
+    return false;
+  if ( m_state == doc_state::closing )
+    return true;
+
+  // Count the nesting outside strings 64 bytes at a time until the container is closed. The
+  // comments are left to skip_leading_spaces().
+  uint64_t depth = 1, escaped = 0, inString = 0;
+  const char *cur = nullptr, *end = nullptr;
+  while ( window(cur, end) && cur < end )
+  {
+    const char* comment = nullptr;
+    for ( const char* p = cur; p < end && comment == nullptr; p += simd::block_size )
+    {
+      const size_t len = std::min(simd::block_size, size_t(end - p));
+      const char* block = p;
+      char padded[simd::block_size];
+      if ( len < simd::block_size )
+      {
+        // Pad the last partial block with spaces. We must not read beyond the window.
+        ::memset(padded, ' ', sizeof(padded));
+        ::memcpy(padded, p, len);
+        block = padded;
+      }
+      simd::block_masks masks;
+      simd::classify(block, masks);
+      const uint64_t escapes = simd::find_escaped(masks.backslash, escaped);
+      if ( len < simd::block_size && (escapes >> len) & 1 )
+        escaped = 1; // The first character of the next window is escaped
+      const uint64_t str = simd::prefix_xor(masks.quote & ~escapes) ^ inString;
+      inString = uint64_t(int64_t(str) >> 63);
+
+      // Only the characters before a comment count
+      uint64_t valid = ( len < simd::block_size )? ((uint64_t(1) << len) - 1) : ~uint64_t(0);
+      if ( const uint64_t bits = masks.comment & ~str & valid; bits != 0 )
+      {
+        comment = p + __builtin_ctzll(bits);
+        valid = (bits & (~bits + 1)) - 1;
+      }
+      const uint64_t open = masks.open & ~str & valid;
+      const uint64_t close = masks.close & ~str & valid;
+      if ( uint64_t(__builtin_popcountll(close)) < depth )
+      {
+        depth += __builtin_popcountll(open);
+        depth -= __builtin_popcountll(close);
+        continue;
+      }
+      // The container may be closed in this block. Find where.
+      for ( uint64_t bits = open | close; bits != 0; bits &= bits - 1 )
+      {
+        if ( open & bits & (~bits + 1) )
+          depth++;
+        else if ( --depth == 0 )
+        {
+          const char* pos = p + __builtin_ctzll(bits);
+          consume(pos - cur);
+          skipped(pos);
+          if ( peek() != container_end() )
+          {
+            fail(parse_error::code::expected_separator, [&]{ return "Expected " + std::string(1, container_end()) + " "
+                                                 + loc_str() + " for the end of the skipped container"; });
+            return true;
+          }
+          m_state = doc_state::closing;
+          return true;
+        }
+      }
+    }
+    if ( comment == nullptr )
+      consume(end - cur);
+    else
+    {
+      // Continue after the comment
+      consume(comment - cur);
+      skipped(comment);
+      if ( !skip_leading_spaces() )
+        break;
+      escaped = inString = 0;
+    }
+  }
+  fail(parse_error::code::end_of_data, [&]{ return "End of data reached " + loc_str() + " while skipping a container"; });
+  return true;
+}
+
+template <typename Derived, typename parser_input, typename pos_type>
+pos_type parser<Derived, parser_input, pos_type>::skip_nested()
+{
+  const bool isObject = ( peek() == '{' );
+  m_frames.push(frame{&m_scalar, isObject? value_type::object : value_type::array, false, nullptr, 0});
+  next();
+  if ( !skip_leading_spaces() )
+  {
+    fail(parse_error::code::end_of_data, [&]{ return "End of data reached " + loc_str()
+                           + (isObject? " while expecting an object key or }" : " while expecting a value or ]"); });
+    return tellg();
+  }
+  m_state = ( peek() == container_end() )? doc_state::closing : doc_state::member;
+  if ( !skip_container() )
+  {
+    fail(parse_error::code::unsupported_mode, [&]{ return std::string("Flexible parsing modes cannot be used for lazy decoding"); });
+    return tellg();
+  }
+  next();
+  m_frames.pop();
+  return tellg();
+}
+
+template <typename Derived, typename parser_input, typename pos_type>
+void parser<Derived, parser_input, pos_type>::skip_document(pos_type& _first, pos_type& _end)
+{
+  m_out.clear();
+  init();
+  begin_document();
+  _first = tellg();
+  _end = skip_nested();
+  m_state = doc_state::done;
+  end_document();
+}
+
+template <typename Derived, typename parser_input, typename pos_type>
+template <typename Member>
+void parser<Derived, parser_input, pos_type>::index_container(Member&& _member)
+{
+  m_out.clear();
+  init();
+  const bool isObject = ( peek() == '{' );
+  m_frames.clear();
+  m_frames.push(frame{&m_scalar, isObject? value_type::object : value_type::array, false, nullptr, 0});
+  next();
+  if ( !skip_leading_spaces() )
+    return fail(parse_error::code::end_of_data, [&]{ return "End of data reached " + loc_str()
+                          + (isObject? " while expecting an object key or }" : " while expecting a value or ]"); });
+  m_key.clear();
+  std::unordered_set<std::string> keys; //! Keys seen so far with dup_key::reject
+  const bool reject = ( isObject && m_in.ctrl.dupKey == parser_control::dup_key::reject );
+  while ( peek() != container_end() )
+  {
+    if ( isObject )
+    {
+      parse_key(m_key);
+      if ( reject && !keys.insert(m_key).second )
+        return fail(parse_error::code::duplicate_key, [&]{ return "Duplicate key \"" + m_key + "\" encountered " + loc_str(); });
+      if ( !skip_leading_spaces() )
+        return fail(parse_error::code::end_of_data, [&]{ return "End of data reached " + loc_str() + " while expecting : for object key" + m_key; });
+      if ( peek() != ':' )
+        return fail(parse_error::code::expected_colon, [&]{ return "Expected : " + loc_str() + " for object key" + m_key; });
       next();
-      break;
+      if ( !skip_leading_spaces() )
+        return fail(parse_error::code::end_of_data, [&]{ return "End of data reached " + loc_str() + " while expecting a value for object key" + m_key; });
+    }
+    const pos_type first = tellg();
+    if ( peek() == '{' || peek() == '[' )
+    {
+      const pos_type end = skip_nested();
+      _member(m_key, first, end, static_cast<value*>(nullptr));
+      skip_leading_spaces();
+    }
+    else
+    {
+      parse_scalar(m_scalar);
+      _member(m_key, first, tellg(), &m_scalar);
     }
 
-    parse_key(m_key);
-    // Check whether this key already exists in the object map
-    bool isDuplicateKey = _jobj.has_key(m_key);
-    if ( isDuplicateKey )
+    // Can have a ,
+    // Must end with } or ]
+    if ( eof() )
+      return fail(parse_error::code::end_of_data, [&]{ return "End of data reached " + loc_str()
+                            + (isObject? " while expecting , or }" : " while expecting , or ]"); });
+    const char sep = peek();
+    if ( sep == ',' )
     {
-      // Handle duplicate key scenario
-      if ( m_in.ctrl.dupKey == parser_control::dup_key::reject )
-        throw std::runtime_error("Duplicate key \"" + m_key + "\" encountered");
+      next();
+      if ( !skip_leading_spaces() )
+        return fail(parse_error::code::end_of_data, [&]{ return "End of data reached " + loc_str()
+                              + (isObject? " while expecting an object key or }" : " while expecting a value or ]"); });
+      if ( isObject && peek() == '}' )
+        return fail(parse_error::code::expected_key, [&]{ return "End of object character } found at" + loc_str() + " while expecting a key"; });
+      if ( !isObject && peek() == ']' )
+        return fail(parse_error::code::expected_element, [&]{ return "End of array character ] found at" + loc_str() + " while expecting a value"; });
+      continue;
     }
+    if ( isObject && sep != '}' )
+      return fail(parse_error::code::expected_separator, [&]{ return "Encountered " + std::string(1, sep) + ". Expected , or } " + loc_str(); });
+    if ( !isObject && sep != ']' )
+      return fail(parse_error::code::expected_separator, [&]{ return "Expected , or ] " + loc_str(); });
+  }
+  next();
+  m_frames.pop();
+}
 
-    m_out.stats.keys++;
-    if ( !skip_leading_spaces() )
-      throw std::runtime_error("End of data reached " + loc_str() + " while expecting : for object key" + m_key);
-    if ( peek() != ':' )
-      throw std::runtime_error("Expected : " + loc_str() + " for object key" + m_key);
-    next();
-    if ( !skip_leading_spaces() )
-      throw std::runtime_error("End of data reached " + loc_str() + " while expecting a value for object key" + m_key);
-    // Handle new key
-    if ( ! isDuplicateKey )
+template <typename Derived, typename parser_input, typename pos_type>
+parser_stats parser<Derived, parser_input, pos_type>::parse_documents(const value::document_handler& _handler)
+{
+  parser_stats total;
+  time_calc tcTotal, tc;
+  size_t first = 0;
+
+  auto set_stats = [&]()
+    {
+      tc.stop();
+      m_out.stats.documents = 1;
+      m_out.stats.data_size = processed() - first;
+      m_out.stats.time_ms = tc.diff_millisecs();
+    };
+  try
+  {
+    if ( m_schema && m_schema->empty() )
     {
-      parse_value(_jobj[m_key]);
+      fail(parse_error::code::invalid_schema, [&]{ return "Invalid schema given for validation"; });
+      return total;
     }
-    // Handle duplicate key based on the input mode
-    else if ( m_in.ctrl.dupKey == parser_control::dup_key::overwrite )
+
+    tcTotal.start();
+    init();
+    // The parser state, the input and the output are reused for every document
+    while ( skip_document_separators() )
     {
-      // Accept the value and overwrite it
-      parse_value(_jobj[m_key]);
+      m_out.clear();
+      tc.start();
+      first = processed();
+      begin_document();
+      parse_document();
+      set_stats();
+      total += m_out.stats;
+      if ( !_handler(m_out) )
+        break;
     }
-    else if ( m_in.ctrl.dupKey == parser_control::dup_key::ignore )
+  }
+  catch (...)
+  {
+    set_stats();
+    throw;
+  }
+  tcTotal.stop();
+  total.data_size = processed();
+  total.time_ms = tcTotal.diff_millisecs();
+  return total;
+}
+
+template <typename Derived, typename parser_input, typename pos_type>
+void parser<Derived, parser_input, pos_type>::parse_elements(const bool _last)
+{
+  time_calc tc;
+
+  try
+  {
+    m_out.clear();
+    tc.start();
+    init();
+    if ( !skip_leading_spaces() )
+      return fail(parse_error::code::end_of_data, [&]{ return "End of data reached " + loc_str() + " while expecting a value"; });
+    // Continue as if the root array were just opened
+    m_frames.clear();
+    m_ignored.clear();
+    m_out.jroot.init(value_type::array);
+    m_rootType = value_type::array;
+    m_frames.push(frame{&m_out.jroot, value_type::array, false, nullptr, 0});
+    m_target = append_element(m_frames.top());
+    m_state = doc_state::value;
+    m_openEnded = !_last;
+    parse_document();
+    m_openEnded = false;
+    end_document();
+
+    m_out.stats.data_size = processed();
+    tc.stop();
+    m_out.stats.time_ms = tc.diff_millisecs();
+  }
+  catch (...)
+  {
+    m_openEnded = false;
+    m_out.stats.data_size = processed();
+    tc.stop();
+    m_out.stats.time_ms = tc.diff_millisecs();
+    throw;
+  }
+}
+
+template <typename Derived, typename parser_input, typename pos_type>
+void parser<Derived, parser_input, pos_type>::begin_document()
+{
+  if ( !skip_leading_spaces() )
+    return fail(parse_error::code::end_of_data, [&]{ return std::string("End of data reached ") + loc_str() + ". Expecting { or ["; });
+
+  if ( peek() != '{' && peek() != '[' )
+    return fail(parse_error::code::expected_root, [&]{ return std::string("Invalid character [") + peek() + "] " + loc_str()
+                        + ". Expecting { or ["; });
+  m_frames.clear();
+  m_ignored.clear();
+  m_rootType = ( peek() == '{' )? value_type::object : value_type::array;
+  m_target = m_handler? &m_scalar : &m_out.jroot;
+  m_node = ( m_filter && !m_filter->root.terminal )? &m_filter->root : nullptr;
+  m_skip = false;
+  m_state = doc_state::value;
+  m_chunks = m_out.memory? m_out.memory->chunk_allocations() : 0;
+}
+
+template <typename Derived, typename parser_input, typename pos_type>
+bool parser<Derived, parser_input, pos_type>::parse_document()
+{
+  const uint32_t maxDepth = m_in.ctrl.maxDepth;
+
+  // Each step parses one value into m_target. Objects and arrays push a frame and continue
+  // with their first member. Once a value is complete, the enclosing containers continue with
+  // their next member or are closed.
+  while ( m_state != doc_state::done && !m_stopped && ready() )
+  {
+    if ( m_state == doc_state::value )
     {
-      // Parse the value, but ignore it
-      value jignore;
-      parse_value(jignore);
+      if ( m_skip )
+      {
+        m_skip = false;
+        if ( skip_value() )
+        {
+          m_state = doc_state::next;
+          continue;
+        }
+        // Parse it into a value that is not used
+        m_target = &m_scalar;
+        m_node = nullptr;
+      }
+      const char ch = peek();
+      if ( ch == '{' || ch == '[' )
+      {
+        const bool isObject = ( ch == '{' );
+        const value_type type = isObject? value_type::object : value_type::array;
+        if ( maxDepth != 0 && m_frames.size() >= maxDepth )
+        {
+          fail(parse_error::code::max_depth, [&]{ return "Maximum nesting depth of " + std::to_string(maxDepth) + " exceeded "
+                                + loc_str(); });
+          break;
+        }
+        // Containers come from the output's arena, or from its pool if the previous document left any
+        if ( m_handler == nullptr && m_target->type() != type )
+        {
+          if ( m_out.memory )
+          {
+            m_target->clear();
+            m_target->init(type, m_in.ctrl.objectLayout, *m_out.memory);
+          }
+          else if ( m_out.pool.take(*m_target, type, m_in.ctrl.objectLayout) )
+            m_out.stats.allocations++;
+        }
+        if ( m_schema && ( m_rule || m_frames.empty() ) )
+        {
+          check_type(type);
+          m_frames.push(frame{m_target, type, false, m_node, 0, true, m_rule});
+        }
+        else
+          m_frames.push(frame{m_target, type, false, m_node, 0});
+        if ( isObject )
+          m_out.stats.objects++;
+        else
+          m_out.stats.arrays++;
+        next();
+        if ( !skip_leading_spaces() )
+        {
+          fail(parse_error::code::end_of_data, [&]{ return "End of data reached " + loc_str()
+                                + (isObject? " while expecting an object key or }" : " while expecting a value or ]"); });
+          break;
+        }
+        // This is the case where there are no elements in the container (An empty object or array)
+        const bool isEmpty = ( peek() == container_end() );
+        if ( m_handler && !(isObject? m_handler->start_object() : m_handler->start_array()) )
+        {
+          stop();
+          m_state = isEmpty? doc_state::closing : doc_state::member;
+          continue;
+        }
+        if ( isEmpty )
+          m_state = doc_state::closing;
+        else
+          m_target = isObject? parse_member(m_frames.top()) : append_element(m_frames.top());
+      }
+      else
+      {
+        m_state = doc_state::next;
+        if ( m_handler )
+          emit_scalar();
+        else if ( m_node )
+        {
+          // The paths continue within it. So, it is not on the way to them.
+          // A scalar root stays null. A member is found by its value, as m_key was moved into the map.
+          skip_value();
+          if ( ! m_frames.empty() )
+          {
+            frame& top = m_frames.top();
+            if ( top.type == value_type::array )
+              top.container->m_data._arr->pop_back();
+            else
+            {
+              value::object_t& jmap = top.container->m_data._map;
+              for ( auto it = jmap.begin(); it != jmap.end(); ++it )
+                if ( &it->second == m_target )
+                {
+                  jmap.erase(it);
+                  break;
+                }
+            }
+          }
+        }
+        else
+        {
+          parse_scalar(*m_target);
+          if ( m_rule && ! m_rule->check(*m_target, m_reason) )
+          {
+            fail(parse_error::code::schema_violation, [&]{ return "Schema violation: " + m_reason + " " + loc_str(); });
+            break;
+          }
+        }
+      }
+      continue;
     }
-    else if ( m_in.ctrl.dupKey == parser_control::dup_key::append )
+
+    // The value is complete. Move to the next member of the enclosing container or close it.
+    frame& top = m_frames.top();
+    const bool isObject = ( top.type == value_type::object );
+    if ( m_state == doc_state::member )
     {
-      // make it as an array and append the duplicate keys
-      if ( ! _jobj[m_key].is_array() )
+      // The handler stopped at the start of the container
+      m_state = doc_state::value;
+      m_target = isObject? parse_member(top) : append_element(top);
+      continue;
+    }
+    if ( m_state == doc_state::next )
+    {
+      if ( m_found && top.filter )
+      {
+        // The values of all the paths are parsed
+        stop();
+        continue;
+      }
+      if ( top.ignored )
+      {
+        m_ignored.pop_back();
+        top.ignored = false;
+      }
+      const char sep = peek();
+      // Can have a ,
+      // Must end with } or ]
+      if ( sep == ',' )
+      {
+        next();
+        if ( !skip_leading_spaces() )
+        {
+          // A part of the root array ends after the , that follows its last element
+          if ( m_openEnded && m_frames.size() == 1 )
+          {
+            m_frames.pop();
+            m_state = doc_state::done;
+            continue;
+          }
+          fail(parse_error::code::end_of_data, [&]{ return "End of data reached " + loc_str()
+                                + (isObject? " while expecting an object key or }" : " while expecting a value or ]"); });
+          break;
+        }
+        if ( isObject && peek() == '}' )
+        {
+          fail(parse_error::code::expected_key, [&]{ return "End of object character } found at" + loc_str() + " while expecting a key"; });
+          break;
+        }
+        if ( !isObject && peek() == ']' )
+        {
+          fail(parse_error::code::expected_element, [&]{ return "End of array character ] found at" + loc_str() + " while expecting a value"; });
+          break;
+        }
+        m_state = doc_state::value;
+        m_target = isObject? parse_member(top) : append_element(top);
+        continue;
+      }
+      if ( eof() )
+      {
+        fail(parse_error::code::end_of_data, [&]{ return "End of data reached " + loc_str()
+                              + (isObject? " while expecting , or }" : " while expecting , or ]"); });
+        break;
+      }
+      if ( isObject && sep != '}' )
       {
-        // make a copy of the existing key's value
-        value jcopy = _jobj[m_key];
-        // make they key as an array
-        _jobj[m_key].clear();
-        _jobj[m_key].init(value_type::array);
-        // append the copied value to the array
-        _jobj[m_key].append(jcopy);
+        fail(parse_error::code::expected_separator, [&]{ return "Encountered " + std::string(1, sep) + ". Expected , or } " + loc_str(); });
+        break;
+      }
+      if ( !isObject && sep != ']' )
+      {
+        fail(parse_error::code::expected_separator, [&]{ return "Expected , or ] " + loc_str(); });
+        break;
       }
-      // Append the new value to the array
-      value& jval = _jobj[m_key].append();
-      parse_value(jval);
     }
-    ch = peek();
-    // Can have a ,
-    // Must end with }
-    if ( ch == '}' ) { next(); break; }
-    if ( ch != ',' )
-      throw std::runtime_error("Encountered " + std::string(1, peek()) + ". Expected , or } " + loc_str());
+    // Close the container
+    if ( top.checked )
+      check_container(top);
+    next();
+    m_frames.pop();
+    if ( m_frames.empty() )
+      m_state = doc_state::done;
+    else
+    {
+      skip_leading_spaces();
+      m_state = doc_state::next;
+    }
+    if ( m_handler && !(isObject? m_handler->end_object() : m_handler->end_array()) )
+      stop();
   }
-  m_containerStack.pop();
+  return ( m_state == doc_state::done );
 }
 
 template <typename Derived, typename parser_input, typename pos_type>
-void parser<Derived, parser_input, pos_type>::parse_array(value& _jarr)
+void parser<Derived, parser_input, pos_type>::end_document()
 {
-  char ch = 0;
-  if ( ! _jarr.is_array() )
-    _jarr.init(value_type::array);
+  // The memory of an arena is allocated a chunk at a time
+  if ( m_out.memory )
+    m_out.stats.allocations += m_out.memory->chunk_allocations() - m_chunks;
+  if ( skip_leading_spaces() )
+    fail(parse_error::code::trailing_data, [&]{ return std::string("Invalid character [") + peek() + "] " + loc_str()
+                        + " after the root " + to_str(m_rootType) + " is closed"; });
+}
 
-  m_containerStack.push(value_type::array);
-  m_out.stats.arrays++;
-  for ( bool firstTime = true; true; firstTime = false)
+template <typename Derived, typename parser_input, typename pos_type>
+bool parser<Derived, parser_input, pos_type>::skip_document_separators()
+{
+  // RFC 7464 starts every record with the record separator
+  constexpr char record_separator = 0x1E;
+  while ( skip_leading_spaces() )
   {
+    if ( peek() != record_separator )
+      return true;
     next();
-    // value
-    if ( !skip_leading_spaces() )
-      throw std::runtime_error("End of data reached " + loc_str() + " while expecting a value or ]");
-    // This is the case where there are no elements in the array (An empty array)
-    if ( peek() == ']' )
+  }
+  return false;
+}
+
+template <typename Derived, typename parser_input, typename pos_type>
+value* parser<Derived, parser_input, pos_type>::parse_member(frame& _frame)
+{
+  if ( m_handler == nullptr )
+    parse_key(m_key);
+  else if ( !emit_key() )
+    return &m_scalar;
+  if ( failed() )
+    return &m_scalar;
+  m_out.stats.keys++;
+  if ( !skip_leading_spaces() )
+  {
+    fail(parse_error::code::end_of_data, [&]{ return "End of data reached " + loc_str() + " while expecting : for object key" + m_key; });
+    return &m_scalar;
+  }
+  if ( peek() != ':' )
+  {
+    fail(parse_error::code::expected_colon, [&]{ return "Expected : " + loc_str() + " for object key" + m_key; });
+    return &m_scalar;
+  }
+  next();
+  if ( !skip_leading_spaces() )
+  {
+    fail(parse_error::code::end_of_data, [&]{ return "End of data reached " + loc_str() + " while expecting a value for object key" + m_key; });
+    return &m_scalar;
+  }
+  if ( m_handler )
+    return &m_scalar;
+  if ( _frame.filter && !select(_frame.filter->child(m_key)) )
+    return &m_scalar;
+
+  // A new key is added without searching for it again. A long key is shared with the same key
+  // of the other members if it is interned.
+  value::object_t& jmap = _frame.container->m_data._map;
+  value::object_t::iterator it = jmap.find(m_key);
+  const bool isNew = ( it == jmap.end() );
+  if ( isNew )
+  {
+    key jkey;
+    bool allocated = false;
+    if ( m_out.memory )
+      jkey = key(m_key, *m_out.memory);
+    else if ( m_out.keys )
+      allocated = m_out.keys->intern(jkey, m_key);
+    else if ( m_out.reuse )
+      allocated = m_out.pool.take_key(jkey, m_key);
+    else
+      allocated = ( jkey = key(m_key) ).is_shared();
+    if ( allocated )
+      m_out.stats.allocations++;
+    const size_t capacity = jmap.capacity();
+    it = jmap.add(std::move(jkey));
+    if ( jmap.capacity() != capacity && ! m_out.memory )
+      m_out.stats.allocations++;
+  }
+  if ( m_schema )
+    select_rule(_frame, it->first, isNew);
+  if ( isNew )
+    return &it->second;
+
+  // Handle duplicate key scenario
+  value& jexisting = it->second;
+  switch ( m_in.ctrl.dupKey )
+  {
+  case parser_control::dup_key::reject:
+    fail(parse_error::code::duplicate_key, [&]{ return "Duplicate key \"" + m_key + "\" encountered"; });
+    return &m_scalar;
+  case parser_control::dup_key::overwrite:
+    // Accept the value and overwrite it
+    jexisting.clear();
+    return &jexisting;
+  case parser_control::dup_key::ignore:
+    // Parse the value, but ignore it
+    _frame.ignored = true;
+    return &m_ignored.emplace_back();
+  case parser_control::dup_key::append:
+    break;
+  }
+  // Make it as an array and append the duplicate keys. The existing value is moved, not copied.
+  if ( ! jexisting.is_array() )
+  {
+    value jprevious(std::move(jexisting));
+    if ( m_out.memory )
+      jexisting.init(value_type::array, m_in.ctrl.objectLayout, *m_out.memory);
+    else
+      jexisting.init(value_type::array);
+    jexisting.m_data._arr->push_back(std::move(jprevious));
+  }
+  // Append the new value to the array
+  return &jexisting.m_data._arr->emplace_back();
+}
+
+template <typename Derived, typename parser_input, typename pos_type>
+value* parser<Derived, parser_input, pos_type>::append_element(frame& _frame)
+{
+  if ( m_handler )
+    return &m_scalar;
+  value::array_t& jarr = *_frame.container->m_data._arr;
+  if ( _frame.filter )
+  {
+    if ( !select(_frame.filter->child(_frame.index++)) )
+      return &m_scalar;
+    // The skipped elements before it are null, so that it keeps its index
+    if ( jarr.size() + 1 < _frame.index )
+      jarr.resize(_frame.index - 1);
+  }
+  if ( _frame.checked )
+  {
+    // The schema has no constraints for the elements
+    m_rule = nullptr;
+    if ( _frame.rule && _frame.rule->maxItems && jarr.size() >= *_frame.rule->maxItems )
     {
-      if ( !firstTime )
-        throw std::runtime_error("End of array character ] found at" + loc_str() + " while expecting a value");
-      next();
+      fail(parse_error::code::schema_violation, [&]{ return "Schema violation: " + _frame.rule->key + " has more than "
+                            + std::to_string(*_frame.rule->maxItems) + " elements " + loc_str(); });
+      return &m_scalar;
+    }
+  }
+  if ( jarr.size() == jarr.capacity() && ! m_out.memory )
+    m_out.stats.allocations++;
+  return &jarr.emplace_back();
+}
+
+template <typename Derived, typename parser_input, typename pos_type>
+bool parser<Derived, parser_input, pos_type>::select(path_node* _node)
+{
+  if ( _node == nullptr )
+  {
+    m_skip = true;
+    return false;
+  }
+  if ( _node->terminal )
+  {
+    m_node = nullptr;
+    // A later duplicate key can still change the value, so stopping early is asked for explicitly
+    if ( m_filter->found(*_node) && m_in.ctrl.stopWhenFound )
+      m_found = true;
+  }
+  else
+    m_node = _node;
+  return true;
+}
+
+template <typename Derived, typename parser_input, typename pos_type>
+void parser<Derived, parser_input, pos_type>::select_rule(const frame& _frame, const std::string_view _key, const bool _isNew)
+{
+  m_rule = nullptr;
+  if ( ! _frame.checked )
+    return;
+  const schema::property_vec& properties = _frame.rule? _frame.rule->properties : m_schema->properties;
+  for ( const schema::property& property : properties )
+  {
+    if ( property.key == _key )
+    {
+      m_rule = &property;
       break;
     }
+  }
+  if ( _isNew && _frame.rule && _frame.rule->maxProperties
+       && _frame.container->m_data._map.size() > *_frame.rule->maxProperties )
+    fail(parse_error::code::schema_violation, [&]{ return "Schema violation: " + _frame.rule->key + " has more than "
+                          + std::to_string(*_frame.rule->maxProperties) + " members " + loc_str(); });
+}
 
-    value& jval = _jarr.append();
-    parse_value(jval);
-    ch = peek();
-    // Can have a ,
-    // Must end with ]
-    if ( ch == ']' ) { next(); break; }
-    if ( ch != ',' )
-      throw std::runtime_error("Expected , or ] " + loc_str());
+template <typename Derived, typename parser_input, typename pos_type>
+void parser<Derived, parser_input, pos_type>::check_type(const value_type _type)
+{
+  const schema_types& types = m_frames.empty()? m_schema->type : m_rule->type;
+  if ( ! types.allows(_type) )
+    fail(parse_error::code::schema_violation, [&]{ return "Schema violation: Type " + to_str(_type) + " of "
+                          + (m_frames.empty()? std::string("the root") : m_rule->key) + " is not "
+                          + types.to_string() + " " + loc_str(); });
+}
+
+template <typename Derived, typename parser_input, typename pos_type>
+void parser<Derived, parser_input, pos_type>::check_container(const frame& _frame)
+{
+  const std::string name = _frame.rule? _frame.rule->key : std::string("the root");
+  if ( _frame.type == value_type::array )
+  {
+    const size_t size = _frame.container->m_data._arr->size();
+    if ( _frame.rule && _frame.rule->minItems && size < *_frame.rule->minItems )
+      return fail(parse_error::code::schema_violation, [&]{ return "Schema violation: " + name + " has less than "
+                            + std::to_string(*_frame.rule->minItems) + " elements " + loc_str(); });
+    return;
   }
-  m_containerStack.pop();
+  const value::object_t& jmap = _frame.container->m_data._map;
+  if ( _frame.rule && _frame.rule->minProperties && jmap.size() < *_frame.rule->minProperties )
+    return fail(parse_error::code::schema_violation, [&]{ return "Schema violation: " + name + " has less than "
+                          + std::to_string(*_frame.rule->minProperties) + " members " + loc_str(); });
+  for ( const std::string& key : _frame.rule? _frame.rule->required : m_schema->required )
+    if ( jmap.find(key) == jmap.end() )
+      return fail(parse_error::code::schema_violation, [&]{ return "Schema violation: Required member " + key + " of " + name
+                            + " is missing " + loc_str(); });
+}
+
+template <typename Derived, typename parser_input, typename pos_type>
+bool parser<Derived, parser_input, pos_type>::skip_value()
+{
+  const char ch = peek();
+  if ( ch == '{' || ch == '[' )
+  {
+    if ( m_in.ctrl.mode.allowFlexibleKeys || m_in.ctrl.mode.allowFlexibleStrings )
+      return false;
+    skip_nested();
+    skip_leading_spaces();
+  }
+  else if ( std::string_view view; quoted_view(view) )
+    skip_leading_spaces();
+  else
+    parse_scalar(m_scalar);
+  return true;
 }
 
 template <typename Derived, typename parser_input, typename pos_type>
@@ -425,24 +1534,45 @@ template <typename Derived, typename parser_input, typename pos_type>
 void parser<Derived, parser_input, pos_type>::parse_string(std::string& _str, bool _isKey)
 {
   _str.clear();
-  const char chContainer = (m_containerStack.top() == value_type::object)? '}' : ']' ;
+  const char chContainer = container_end();
   bool hasQuotes = true;
   if ( ( _isKey && m_in.ctrl.mode.allowFlexibleKeys ) || ( ! _isKey && m_in.ctrl.mode.allowFlexibleStrings ) )
     hasQuotes = (peek() == '\"');
   else if ( peek() != '\"' )
-    throw std::runtime_error("Expected \" " + loc_str() + ", found \"" + std::string(1, peek()) + "\"");
+    return fail(parse_error::code::invalid_string, [&]{ return "Expected \" " + loc_str() + ", found \"" + std::string(1, peek()) + "\""; });
+
+  // Start over with the character parser if the fast path cannot complete the string
+  if ( hasQuotes && parse_quoted_string(_str) )
+  {
+    if ( m_in.ctrl.checkUtf8 )
+      check_utf8(_str);
+    return;
+  }
+  _str.clear();
 
-  const line_info old_line = m_line;
   pos_type old_pos = tellg();
+  pin(old_pos);
 
-  auto check_hex = [&](char ch)->char
+  auto next_hex4 = [&](uint32_t& _cp)->bool
     {
-      if ( eof() )
-        throw std::runtime_error("Missing hexadecimal sequence characters at the end position "
-                             + loc_str());
-      if ( ! ::isxdigit(ch) )
-        throw std::runtime_error("Missing hexadecimal character at " + loc_str());
-      return ch;
+      char hex[4];
+      for ( int i = 0; i < 4; i++ )
+      {
+        hex[i] = next();
+        if ( eof() )
+        {
+          fail(parse_error::code::end_of_data, [&]{ return "Missing hexadecimal sequence characters at the end position "
+                                 + loc_str(); });
+          return false;
+        }
+        if ( ! ::isxdigit(hex[i]) )
+        {
+          fail(parse_error::code::invalid_unicode, [&]{ return "Missing hexadecimal character at " + loc_str(); });
+          return false;
+        }
+      }
+      _cp = decode_hex4(hex);
+      return true;
     };
 
   bool finalGoNext = true; 
@@ -451,17 +1581,15 @@ void parser<Derived, parser_input, pos_type>::parse_string(std::string& _str, bo
     if ( hasQuotes )
     {
       if ( eof() )
-        throw std::runtime_error("Missing \" for string starting " + loc_str(old_line, old_pos));
+        return fail(parse_error::code::end_of_data, [&]{ return "Missing \" for string starting " + loc_str(old_pos); });
       if ( ch == '\"' ) break;
-      if ( ch == '\n' )
-        handle_newline();
     }
     else
     {
       if ( eof() )
-        throw std::runtime_error("End of string character not found for string starting " + loc_str());
+        return fail(parse_error::code::end_of_data, [&]{ return "End of string character not found for string starting " + loc_str(); });
       // Cannot have double-quotes, it must be escaped
-      if ( ch == '\"' ) throw std::runtime_error("Character \" must be escaped " + loc_str());
+      if ( ch == '\"' ) return fail(parse_error::code::invalid_string, [&]{ return "Character \" must be escaped " + loc_str(); });
       // A space character denotes end of the string
       if ( is_space() )
         break;
@@ -475,7 +1603,7 @@ void parser<Derived, parser_input, pos_type>::parse_string(std::string& _str, bo
     {
       ch = next();
       if ( eof() )
-        throw std::runtime_error("Missing escape sequence characters at the end position " + loc_str());
+        return fail(parse_error::code::end_of_data, [&]{ return "Missing escape sequence characters at the end position " + loc_str(); });
       switch ( ch )
       {
       case '/':  _str += ch;   break;
@@ -488,108 +1616,259 @@ void parser<Derived, parser_input, pos_type>::parse_string(std::string& _str, bo
       case '\"': _str += ch;   break;
       case 'u':
         {
-          // Must be followed by 4 hex digits
-          for ( int i = 0; i < 4; i++ )
-            _str += check_hex(next());
+          // Must be followed by 4 hex digits. A code point above U+FFFF is a surrogate pair.
+          uint32_t cp = 0;
+          if ( !next_hex4(cp) )
+            return;
+          if ( is_low_surrogate(cp) )
+            return fail(parse_error::code::invalid_unicode, [&]{ return "Unpaired low surrogate in \\u escape " + loc_str(); });
+          if ( is_high_surrogate(cp) )
+          {
+            if ( next() != '\\' || eof() || next() != 'u' || eof() )
+              return fail(parse_error::code::invalid_unicode, [&]{ return "Missing low surrogate after \\u escape " + loc_str(); });
+            uint32_t low = 0;
+            if ( !next_hex4(low) )
+              return;
+            if ( !is_low_surrogate(low) )
+              return fail(parse_error::code::invalid_unicode, [&]{ return "Invalid low surrogate in \\u escape " + loc_str(); });
+            cp = join_surrogates(cp, low);
+          }
+          append_utf8(_str, cp);
         }
         break;
       default:
-        throw std::runtime_error("Invalid escape sequence (" + std::string(1, ch) +
-                             ") for string at " + loc_str());
+        return fail(parse_error::code::invalid_escape, [&]{ return "Invalid escape sequence (" + std::string(1, ch) +
+                             ") for string at " + loc_str(); });
       }
     }
   }
+  unpin();
   if ( finalGoNext )
     next();
+  if ( m_in.ctrl.checkUtf8 )
+    check_utf8(_str);
+}
+
+template <typename Derived, typename parser_input, typename pos_type>
+void parser<Derived, parser_input, pos_type>::check_utf8(const std::string_view _str)
+{
+  const char* invalid = simd::find_invalid_utf8(_str.data(), _str.data() + _str.size());
+  if ( invalid != _str.data() + _str.size() )
+  {
+    char byte[8];
+    ::snprintf(byte, sizeof(byte), "0x%02X", static_cast<uint8_t>(*invalid));
+    fail(parse_error::code::invalid_utf8, [&]{ return std::string("Invalid UTF-8 byte ") + byte + " at offset "
+                          + std::to_string(invalid - _str.data()) + " of the string ending " + loc_str(); });
+  }
+}
+
+template <typename Derived, typename parser_input, typename pos_type>
+bool parser<Derived, parser_input, pos_type>::parse_quoted_string(std::string& _str)
+{
+  const char *cur = nullptr, *end = nullptr, *close = nullptr;
+  if ( !window(cur, end) )
+    return false;
+  // With the structural index, the next token after the opening quote is the closing quote
+  if ( next_token(cur+1, close) && close < end && *close == '\"' )
+    end = close + 1;
+  // Append the runs between the special characters at once. Anything unusual is left to the
+  // character parser, which reports the error with the right location.
+  for ( const char* p = cur+1; p < end; )
+  {
+    const char* q = simd::find_string_special(p, end);
+    _str.append(p, q-p);
+    if ( q == end )
+      break;
+    if ( *q == '\"' )
+    {
+      consume(q+1-cur);
+      return true;
+    }
+    if ( *q != '\\' )
+    {
+      // Control characters are accepted as they are
+      _str += *q;
+      p = q + 1;
+      continue;
+    }
+    if ( end-q < 2 )
+      return false;
+    switch ( q[1] )
+    {
+    case '/':  _str += '/';  break;
+    case 'b':  _str += '\b'; break;
+    case 'f':  _str += '\f'; break;
+    case 'n':  _str += '\n'; break;
+    case 'r':  _str += '\r'; break;
+    case 't':  _str += '\t'; break;
+    case '\\': _str += '\\'; break;
+    case '\"': _str += '\"'; break;
+    case 'u':
+      {
+        // A code point above U+FFFF is a surrogate pair of two escapes
+        int32_t cp = ( end-q >= 6 )? decode_hex4(q+2) : -1;
+        if ( cp < 0 || is_low_surrogate(cp) )
+          return false;
+        p = q + 6;
+        if ( is_high_surrogate(cp) )
+        {
+          const int32_t low = ( end-p >= 6 && p[0] == '\\' && p[1] == 'u' )? decode_hex4(p+2) : -1;
+          if ( low < 0 || !is_low_surrogate(low) )
+            return false;
+          cp = join_surrogates(cp, low);
+          p += 6;
+        }
+        append_utf8(_str, cp);
+      }
+      continue;
+    default:
+      return false;
+    }
+    p = q + 2;
+  }
+  return false;
+}
+
+template <typename Derived, typename parser_input, typename pos_type>
+bool parser<Derived, parser_input, pos_type>::quoted_view(std::string_view& _view)
+{
+  const char *cur = nullptr, *end = nullptr;
+  if ( !window(cur, end) || cur == end || *cur != '\"' )
+    return false;
+  // The closing quote must not be the last character of the window. Consuming it could
+  // replace the window, and with it the data the view points to.
+  const char* q = simd::find_string_special(cur+1, end);
+  if ( q >= end-1 || *q != '\"' )
+    return false;
+  _view = std::string_view(cur+1, q-cur-1);
+  consume(q+1-cur);
+  if ( m_in.ctrl.checkUtf8 )
+    check_utf8(_view);
+  return true;
+}
+
+template <typename Derived, typename parser_input, typename pos_type>
+bool parser<Derived, parser_input, pos_type>::emit_key()
+{
+  std::string_view key;
+  if ( quoted_view(key) )
+    m_key.assign(key); // for the error messages that follow
+  else
+  {
+    parse_key(m_key);
+    key = m_key;
+  }
+  if ( m_handler->key(key) )
+    return true;
+  stop();
+  return false;
+}
+
+template <typename Derived, typename parser_input, typename pos_type>
+void parser<Derived, parser_input, pos_type>::emit_scalar()
+{
+  bool resume = true;
+  if ( std::string_view view; quoted_view(view) )
+  {
+    m_out.stats.strings++;
+    resume = m_handler->string(view);
+    skip_leading_spaces();
+  }
+  else
+  {
+    parse_scalar(m_scalar);
+    const value::union_data& data = m_scalar.m_data;
+    switch ( m_scalar.type() )
+    {
+    case value_type::string:    resume = m_handler->string(m_scalar.str_view()); break;
+    case value_type::_signed:   resume = m_handler->number(data._i64);  break;
+    case value_type::_unsigned: resume = m_handler->number(data._u64);  break;
+    case value_type::_double:   resume = m_handler->number(static_cast<long double>(data._dbl)); break;
+    case value_type::boolean:   resume = m_handler->boolean(data._bval); break;
+    case value_type::null:      resume = m_handler->null(); break;
+    default: break;
+    }
+  }
+  if ( !resume )
+    stop();
 }
 
 template <typename Derived, typename parser_input, typename pos_type>
 void parser<Derived, parser_input, pos_type>::parse_string(value& _jstr, bool _isKey)
 {
-  std::string str;
-  parse_string(str, _isKey);
-  _jstr = str;
+  parse_string(m_str, _isKey);
+  if ( m_out.memory )
+  {
+    _jstr.clear();
+    _jstr.init_str(m_str, *m_out.memory);
+  }
+  else if ( m_out.pool.take(_jstr, m_str) )
+    m_out.stats.allocations++;
 }
 
 template <typename Derived, typename parser_input, typename pos_type>
-void parser<Derived, parser_input, pos_type>::parse_value(value& _jval)
+void parser<Derived, parser_input, pos_type>::parse_scalar(value& _jval)
 {
   if ( eof() )
-    throw std::runtime_error("Unexpected end of data while expecting a value");
+    return fail(parse_error::code::end_of_data, [&]{ return "Unexpected end of data while expecting a value"; });
 
   char ch = peek();
-  if ( ch == '{' )
-    parse_object(_jval);
-  else if ( ch == '[' )
-    parse_array(_jval);
-  else if ( ch == '\"' )
+  if ( ch == '\"' )
     parse_string(_jval, false);
   else if ( ch == '-' || ::isdigit(ch) )
     parse_number(_jval);
   else
   {
-    const char chContainer = (m_containerStack.top() == value_type::object)? '}' : ']' ;
-    pos_type old_pos = tellg();
-    const line_info old_line = m_line;
-
-    char data[6] = {0}; // to capture null, true, false
-    int len = 0;
-    for ( char ch; !eof(); next(), len++ )
+    const char chContainer = container_end();
+    const bool nocase = m_in.ctrl.mode.allowNocaseValues;
+    literal lit = literal::none;
+    // Recognize the literal in place if the character that ends it is within the window
+    if ( const char *cur = nullptr, *end = nullptr, *after = nullptr;
+         window(cur, end) && (lit = match_literal(cur, end, nocase, after)) != literal::none )
     {
-      ch = peek();
-      if ( len > 5 || ch == ',' || is_space() || ch == chContainer )
-        break;
-      data[len] = ch;
+      if ( after < end && (*after == ',' || *after == chContainer || ::isspace(static_cast<unsigned char>(*after))) )
+        consume(after - cur);
+      else
+        lit = literal::none;
     }
-    if ( tellg() == old_pos )
-      throw std::runtime_error("Expected value not found " + loc_str());
-
-    bool found = true;
-    if ( len == 4 )
+    if ( lit == literal::none )
     {
-      if ( ::strncmp(data, "null", len) == 0 )
-        ;
-      else if ( ::strncmp(data, "true", len) == 0 )
-        _jval = true;
-      else if ( ! m_in.ctrl.mode.allowNocaseValues )
-        found = false;
-      else
+      pos_type old_pos = tellg();
+
+      char data[6] = {0}; // to capture null, true, false
+      int len = 0;
+      for ( char ch; !eof(); next(), len++ )
       {
-        if ( ::strncmp(data, "Null", len) == 0 || ::strncmp(data, "NULL", len) == 0 )
-          ;
-        else if ( ::strncmp(data, "True", len) == 0 || ::strncmp(data, "TRUE", len) == 0 )
-          _jval = true;
-        else
-          found = false;
+        ch = peek();
+        if ( len > 5 || ch == ',' || is_space() || ch == chContainer )
+          break;
+        data[len] = ch;
       }
-    }
-    else if ( len == 5 )
-    {
-      if ( ::strncmp(data, "false", len) == 0 )
-        _jval = false;
-      else if ( ! m_in.ctrl.mode.allowNocaseValues )
-        found = false;
-      else
+      if ( tellg() == old_pos )
+        return fail(parse_error::code::expected_value, [&]{ return "Expected value not found " + loc_str(); });
+
+      const char* after = nullptr;
+      lit = match_literal(data, data + len, nocase, after);
+      if ( lit != literal::none && after != data + len )
+        lit = literal::none;
+      if ( lit == literal::none )
       {
-        if ( ::strncmp(data, "False", len) == 0 || ::strncmp(data, "FALSE", len) == 0 )
-          _jval = false;
+        if ( m_in.ctrl.mode.allowFlexibleStrings )
+        {
+          seekg(old_pos);
+          parse_string(_jval, false);
+        }
         else
-          found = false;
+          return fail(parse_error::code::invalid_value, [&]{ return "Invalid value [" + std::string(data, len) + "] " + loc_str()
+                               + ". Did you miss enclosing in \"\"?"; });
       }
     }
-    else
-      found = false;
-    if ( ! found )
+    switch ( lit )
     {
-      if ( m_in.ctrl.mode.allowFlexibleStrings )
-      {
-        seekg(old_pos);
-        m_line = old_line;
-        parse_string(_jval, false);
-      }
-      else
-        throw std::runtime_error("Invalid value [" + std::string(old_pos, len) + "] " + loc_str()
-                             + ". Did you miss enclosing in \"\"?");
+    case literal::null_value:  _jval.clear(); break;
+    case literal::true_value:  _jval = true;  break;
+    case literal::false_value: _jval = false; break;
+    case literal::none: break;
     }
   }
   // Set the statistics of non-container objects here
@@ -609,117 +1888,112 @@ template <typename Derived, typename parser_input, typename pos_type>
 void parser<Derived, parser_input, pos_type>::parse_number(value& _jnum)
 {
   skip_leading_spaces();
-  pos_type start_pos = tellg();
-  const char chContainer = (m_containerStack.top() == value_type::object)? '}' : ']' ;
-  std::string numStr;
-  number_info num;
-
-  char ch = peek();
-  if ( (num.integer.negative = (ch == '-')) )
-  {
-    numStr += ch;
-    ch = next();
-  }
-  if ( ch < '0' || ch > '9' )
-    throw std::runtime_error("Missing integer digit" + loc_str());
-  numStr += ch;
+  const char chContainer = container_end();
+  decoded_number num;
+  number_error error = number_error::none;
+  bool decoded = false;
 
-  if ( ch == '0' )
+  // Decode straight from the input. If the number runs up to the end of the window it may
+  // continue beyond it, so let the character loop below handle it.
+  if ( const char *cur = nullptr, *end = nullptr; window(cur, end) && cur < end )
   {
-    ch = next();
-    if ( ch >= '0' && ch <= '9' )
-      throw std::runtime_error("Invalid digit (" + std::string(1, ch) + ") after first 0 " + loc_str());
-    num.integer.digits = 0;
-    if ( !is_space() && ch != ',' && ch != chContainer && ch != '.' && ch != 'e' && ch != 'E' )
-      numStr += ch;
-  }
-  else
-  {
-    while ( (ch = next()) >= '0' && ch <= '9'  )
-      numStr += ch;
-  }
-
-  // Check whether it has fraction and populate accordingly
-  if ( ch == '.' )
-  {
-    numStr += ch;
-    bool hasDigits = false;
-    while ( (ch = next()) >= '0' && ch <= '9'  )
+    const char* p = json::decode_number(cur, end, num, error);
+    if ( p < end )
     {
-      numStr += ch;
-      hasDigits = true;
+      if ( error == number_error::out_of_range )
+        return fail(parse_error::code::number_out_of_range, [&]{ return "Unable to convert (" + std::string(cur, p) + ") to double " + loc_str()
+                              + ": out of range"; });
+      consume(p - cur);
+      decoded = true;
     }
-    if ( !hasDigits )
-      throw std::runtime_error("Invalid digit (" + std::string(1, ch)
-                            + ") Expected a digit for fraction " + loc_str());
-    num.hasFraction = true;
   }
-  // Check whether it has an exponent and populate accordingly
-  if ( ch == 'e' || ch == 'E' )
+
+  if ( !decoded )
   {
-    numStr += ch;
-    ch = next();
-    if ( ch == '-' || ch == '+' )
+    // Collect the characters of the number in the reused buffer
+    m_numStr.clear();
+    error = number_error::none;
+    char ch = peek();
+    if ( ch == '-' )
     {
-      numStr += ch;
+      m_numStr += ch;
       ch = next();
     }
-    bool hasDigits = false;
-    for ( ; ch >= '0' && ch <= '9'; ch = next()  )
+    if ( ch < '0' || ch > '9' )
+      error = number_error::missing_digit;
+    else if ( ch == '0' )
     {
-      numStr += ch;
-      hasDigits = true;
+      m_numStr += ch;
+      if ( (ch = next()) >= '0' && ch <= '9' )
+        error = number_error::leading_zero;
     }
-    if ( !hasDigits )
-      throw std::runtime_error("Invalid digit (" + std::string(1, ch)
-                            + ") Expected a digit for exponent " + loc_str());
-    num.hasExponent = true;
-  }
-
-  const bool isNegative = num.integer.negative;
-  bool isDouble = ( num.hasFraction || num.hasExponent );
-
-  pos_type end_pos = tellg();
-  skip_leading_spaces();
-  ch = peek();
-  if ( !eof() && ch != ',' && ch != chContainer )
-    throw std::runtime_error("Invalid character " + std::string(1, ch) + " Expected , or "
-                         + std::string(1, chContainer) + " " + loc_str());
-
-  if ( !isDouble )
-  {
-    try
+    else
     {
-      if ( isNegative )
-      {
-        int64_t v = 0;
-        json::to_num(numStr, /*out*/ v);
-        _jnum = v;
-      }
-      else
+      for ( ; ch >= '0' && ch <= '9'; ch = next() )
+        m_numStr += ch;
+    }
+    // Check whether it has fraction and populate accordingly
+    if ( error == number_error::none && ch == '.' )
+    {
+      m_numStr += ch;
+      while ( (ch = next()) >= '0' && ch <= '9' )
+        m_numStr += ch;
+      if ( m_numStr.back() == '.' )
+        error = number_error::missing_fraction_digit;
+    }
+    // Check whether it has an exponent and populate accordingly
+    if ( error == number_error::none && (ch == 'e' || ch == 'E') )
+    {
+      m_numStr += ch;
+      ch = next();
+      if ( ch == '-' || ch == '+' )
       {
-        uint64_t v = 0;
-        json::to_num(numStr, /*out*/ v);
-        _jnum = v;
+        m_numStr += ch;
+        ch = next();
       }
+      for ( ; ch >= '0' && ch <= '9'; ch = next() )
+        m_numStr += ch;
+      if ( m_numStr.back() < '0' || m_numStr.back() > '9' )
+        error = number_error::missing_exponent_digit;
     }
-    catch ( const std::exception& _e)
+    if ( error == number_error::none )
     {
-      if ( typeid(_e) != typeid(std::out_of_range) )
-        throw std::runtime_error("Unable to convert (" + numStr + ") to numeric " + loc_str()
-                            + ": " + _e.what());
-      // If out of range exception is received, convert it to double
-      isDouble = true;
+      const char* first = m_numStr.data();
+      json::decode_number(first, first + m_numStr.length(), num, error);
+      if ( error == number_error::out_of_range )
+        return fail(parse_error::code::number_out_of_range, [&]{ return "Unable to convert (" + m_numStr + ") to double " + loc_str()
+                              + ": out of range"; });
     }
   }
-  if ( isDouble )
+
+  switch ( error )
+  {
+  case number_error::none:
+  case number_error::out_of_range:
+    break;
+  case number_error::missing_digit:
+    return fail(parse_error::code::invalid_number, [&]{ return "Missing integer digit" + loc_str(); });
+  case number_error::leading_zero:
+    return fail(parse_error::code::invalid_number, [&]{ return "Invalid digit (" + std::string(1, peek()) + ") after first 0 " + loc_str(); });
+  case number_error::missing_fraction_digit:
+    return fail(parse_error::code::invalid_number, [&]{ return "Invalid digit (" + std::string(1, peek())
+                          + ") Expected a digit for fraction " + loc_str(); });
+  case number_error::missing_exponent_digit:
+    return fail(parse_error::code::invalid_number, [&]{ return "Invalid digit (" + std::string(1, peek())
+                          + ") Expected a digit for exponent " + loc_str(); });
+  }
+
+  skip_leading_spaces();
+  const char ch = peek();
+  if ( !eof() && ch != ',' && ch != chContainer )
+    return fail(parse_error::code::expected_separator, [&]{ return "Invalid character " + std::string(1, ch) + " Expected , or "
+                         + std::string(1, chContainer) + " " + loc_str(); });
+
+  switch ( num.type )
   {
-    std::string errStr;
-    long double v = 0.0;
-    if ( !json::to_num(numStr, /*out*/ v, &errStr) )
-      throw std::runtime_error("Unable to convert (" + numStr + ") to double " + loc_str()
-                            + ": " + errStr);
-    _jnum = v;
+  case decoded_number::kind::signed_int:   _jnum = num.i64; break;
+  case decoded_number::kind::unsigned_int: _jnum = num.u64; break;
+  case decoded_number::kind::real:         _jnum = num.dbl; break;
   }
 }
 
@@ -727,11 +2001,6 @@ void parser<Derived, parser_input, pos_type>::parse_number(value& _jnum)
 template <typename Derived, typename parser_input, typename pos_type>
 bool parser<Derived, parser_input, pos_type>::is_space()
 {
-  if ( peek() == '\n' )
-  {
-    handle_newline();
-    return true;
-  }
   return ::isspace(peek());
 }
 
@@ -740,6 +2009,10 @@ bool parser<Derived, parser_input, pos_type>::skip_leading_spaces()
 {
   do
   {
+    // Jump over the whitespace to the next token using the structural index
+    if ( const char *cur = nullptr, *end = nullptr, *token = nullptr;
+         window(cur, end) && cur < end && ::isspace(static_cast<unsigned char>(*cur)) && next_token(cur, token) && token <= end )
+      consume(token-cur);
     for (; !eof() && is_space(); next() );
     if ( eof() ) return false;
     switch ( peek() )
@@ -751,7 +2024,10 @@ bool parser<Derived, parser_input, pos_type>::skip_leading_spaces()
     case '/':
       next();
       if ( eof() )
-        throw std::runtime_error("Invalid character at the end");
+      {
+        fail(parse_error::code::invalid_comment, [&]{ return "Invalid character at the end"; });
+        return false;
+      }
       switch ( peek() )
       {
       case '/':
@@ -760,28 +2036,29 @@ bool parser<Derived, parser_input, pos_type>::skip_leading_spaces()
         break;
       case '*':
         {
-          const line_info old_line = m_line;
           const pos_type old_pos = tellg();
+          pin(old_pos);
           // C style comment encountered. Parse until */
           do
           {
-            for ( next(); peek() != '*' && !eof(); next() )
+            for ( next(); peek() != '*' && !eof(); next() );
+            if ( eof() )
             {
-              if ( peek() == '\n' )
-                handle_newline();
+              fail(parse_error::code::invalid_comment, [&]{ return std::string("Comments starting " + loc_str(old_pos))
+                                    + " is not closed"; });
+              return false;
             }
-            if ( eof() )
-              throw std::runtime_error(std::string("Comments starting " + loc_str(old_line, old_pos))
-                                    + " is not closed");
             next();
           }
           while ( peek() != '/' );
+          unpin();
           next();
         }
         break;
       default:
-        throw std::runtime_error(std::string("Invalid character [") + peek() + "] " + loc_str()
-                              + " after the /");
+        fail(parse_error::code::invalid_comment, [&]{ return std::string("Invalid character [") + peek() + "] " + loc_str()
+                              + " after the /"; });
+        return false;
       }
       break;
     default: // Any other character
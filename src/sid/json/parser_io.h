@@ -40,6 +40,7 @@ LICENSE: END
 
 #include <json/value.h>
 #include <sstream>
+#include <string_view>
 
 namespace sid::json {
 
@@ -55,15 +56,23 @@ protected:
 
 struct char_parser_input : public base_parser_input
 {
-  const std::string& input;
-  input_type         inputType;
+  std::string_view input;     //! Input data, or the path of the file for input_type::file_path
+  input_type       inputType;
+  const char*      origin;    //! Start of the whole input if input is a part of it
 
   //! Constructor
   char_parser_input(
     const std::string&    _input,
     const input_type      _inputType,
     const parser_control& _ctrl = parser_control())
-    : base_parser_input(_ctrl), input(_input), inputType(_inputType) {}
+    : base_parser_input(_ctrl), input(_input), inputType(_inputType), origin(nullptr) {}
+
+  //! Constructor for a part of a larger input. Locations are given from the start of it.
+  char_parser_input(
+    const std::string_view _input,
+    const char*            _origin,
+    const parser_control&  _ctrl = parser_control())
+    : base_parser_input(_ctrl), input(_input), inputType(input_type::data), origin(_origin) {}
 };
 
 struct buffer_parser_input : public base_parser_input
@@ -76,4 +85,11 @@ struct buffer_parser_input : public base_parser_input
     : base_parser_input(_ctrl), sbuf(_in) {}
 };
 
+struct chunk_parser_input : public base_parser_input
+{
+  //! Constructor. The input is fed to the parser in chunks.
+  chunk_parser_input(const parser_control& _ctrl = parser_control())
+    : base_parser_input(_ctrl) {}
+};
+
 } // namespace sid::json
@@ -60,6 +60,7 @@ parser_stats::parser_stats()
 void parser_stats::clear()
 {
   data_size = 0;
+  documents = 0;
   objects = 0;
   arrays = 0;
   strings = 0;
@@ -67,14 +68,33 @@ void parser_stats::clear()
   booleans = 0;
   nulls = 0;
   keys = 0;
+  allocations = 0;
   time_ms = 0;
 }
 
+parser_stats& parser_stats::operator+=(const parser_stats& _stats)
+{
+  data_size += _stats.data_size;
+  documents += _stats.documents;
+  objects += _stats.objects;
+  arrays += _stats.arrays;
+  strings += _stats.strings;
+  numbers += _stats.numbers;
+  booleans += _stats.booleans;
+  nulls += _stats.nulls;
+  keys += _stats.keys;
+  allocations += _stats.allocations;
+  time_ms += _stats.time_ms;
+  return *this;
+}
+
 std::string parser_stats::to_string() const
 {
   std::ostringstream out;
-  out << "processed.....: " << json::get_sep(data_size) << " byte(s)" << endl
-      << "objects.......: " << json::get_sep(objects) << endl
+  out << "processed.....: " << json::get_sep(data_size) << " byte(s)" << endl;
+  if ( documents > 1 )
+    out << "documents.....: " << json::get_sep(documents) << endl;
+  out << "objects.......: " << json::get_sep(objects) << endl
 //      << " (" << json::get_sep(json_gobjects_alloc) << ")" << endl
       << "arrays........: " << json::get_sep(arrays) << endl
       << "strings.......: " << json::get_sep(strings) << endl
@@ -82,6 +102,7 @@ std::string parser_stats::to_string() const
       << "booleans......: " << json::get_sep(booleans) << endl
       << "nulls.........: " << json::get_sep(nulls) << endl
       << "(keys)........: " << json::get_sep(keys) << endl
+      << "(allocations).: " << json::get_sep(allocations) << endl
       << "(time taken)..: " << json::get_sep(time_ms/1000)
       << "." << std::setfill('0') << std::setw(3) << (time_ms % 1000) << " seconds" << endl
     ;
@@ -0,0 +1,143 @@
+/*
+LICENSE: BEGIN
+===============================================================================
+@author Shan Anand
+@email anand.gs@gmail.com
+@source https://github.com/shan-anand
+@file path_filter.cpp
+@brief Paths of the values to parse
+===============================================================================
+MIT License
+
+Copyright (c) 2017 Shanmuga (Anand) Gunasekaran
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+===============================================================================
+LICENSE: END
+*/
+
+/**
+ * @file  path_filter.cpp
+ * @brief Implementation of the paths of the values to parse
+ */
+#include "path_filter.h"
+#include <stdexcept>
+#include <charconv>
+
+using namespace std;
+using namespace sid;
+using namespace sid::json;
+
+namespace local
+{
+//! get the step, adding it if it does not exist
+path_node& add(std::unique_ptr<path_node>& _node)
+{
+  if ( !_node )
+    _node = std::make_unique<path_node>();
+  return *_node;
+}
+
+//! Add the steps of _from to _to
+void merge(path_node& _to, const path_node& _from)
+{
+  _to.terminal = _to.terminal || _from.terminal;
+  for ( const auto& entry : _from.children )
+    merge(add(_to.children[entry.first]), *entry.second);
+  if ( _from.wildcard )
+    merge(add(_to.wildcard), *_from.wildcard);
+}
+
+//! Prepare the steps for matching. Returns the number of terminal steps.
+size_t normalize(path_node& _node)
+{
+  if ( _node.terminal )
+  {
+    // The whole value is parsed. The steps within it are not used.
+    _node.children.clear();
+    _node.wildcard.reset();
+    return 1;
+  }
+  size_t count = 0;
+  if ( _node.wildcard )
+  {
+    // A member that matches both a key and * follows both of them
+    for ( auto& entry : _node.children )
+      merge(*entry.second, *_node.wildcard);
+    count += normalize(*_node.wildcard);
+  }
+  for ( auto& entry : _node.children )
+    count += normalize(*entry.second);
+  return count;
+}
+} // namespace local
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Implementation of path_node
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+path_node* path_node::child(const uint64_t _index)
+{
+  if ( children.empty() )
+    return wildcard.get();
+  char buf[24];
+  const auto result = std::to_chars(buf, buf + sizeof(buf), _index);
+  return child(std::string_view(buf, result.ptr - buf));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Implementation of path_filter
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+path_filter::path_filter(const std::vector<std::string>& _paths)
+  : root(), pending(0), canStop(true)
+{
+  for ( const std::string& path : _paths )
+  {
+    if ( !path.empty() && path[0] != '/' )
+      throw std::runtime_error("Invalid path (" + path + "). It must start with /");
+    path_node* node = &root;
+    for ( size_t pos = 0; pos < path.length(); )
+    {
+      const size_t end = std::min(path.find('/', pos + 1), path.length());
+      std::string step;
+      for ( size_t i = pos + 1; i < end; i++ )
+      {
+        if ( path[i] != '~' )
+          step += path[i];
+        else if ( i + 1 < end && ( path[i+1] == '0' || path[i+1] == '1' ) )
+          step += ( path[++i] == '0' )? '~' : '/';
+        else
+          throw std::runtime_error("Invalid escape sequence in path (" + path + ")");
+      }
+      if ( step == "*" )
+      {
+        node = &local::add(node->wildcard);
+        canStop = false;
+      }
+      else
+        node = &local::add(node->children[step]);
+      pos = end;
+    }
+    node->terminal = true;
+  }
+  pending = local::normalize(root);
+}
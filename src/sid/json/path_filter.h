@@ -0,0 +1,97 @@
+/*
+LICENSE: BEGIN
+===============================================================================
+@author Shan Anand
+@email anand.gs@gmail.com
+@source https://github.com/shan-anand
+@file path_filter.h
+@brief Paths of the values to parse
+===============================================================================
+MIT License
+
+Copyright (c) 2017 Shanmuga (Anand) Gunasekaran
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+===============================================================================
+LICENSE: END
+*/
+
+/**
+ * @file  path_filter.h
+ * @brief Paths of the values to parse
+ */
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <memory>
+#include <cstdint>
+
+namespace sid::json {
+
+/**
+ * @struct path_node
+ * @brief A step of the paths in a path_filter. The members of an object or array that match none
+ *        of its children are skipped.
+ */
+struct path_node
+{
+  std::map<std::string, std::unique_ptr<path_node>, std::less<>> children; //! Members with the key or index
+  std::unique_ptr<path_node> wildcard; //! All the members (* in the path)
+  bool terminal = false; //! The whole value is parsed
+  bool found = false;    //! The value is parsed (for the paths without wildcards)
+
+  //! get the step for the member with the key, or nullptr if the member is skipped
+  path_node* child(const std::string_view _key)
+  {
+    if ( auto it = children.find(_key); it != children.end() )
+      return it->second.get();
+    return wildcard.get();
+  }
+  //! get the step for the element with the index, or nullptr if the element is skipped
+  path_node* child(const uint64_t _index);
+};
+
+/**
+ * @struct path_filter
+ * @brief Paths of the values to parse. A path is a JSON Pointer (RFC 6901), like /items/0/price,
+ *        where * matches every member of an object or array.
+ */
+struct path_filter
+{
+  path_node root;
+  size_t    pending; //! Paths without wildcards not found yet
+  bool      canStop; //! None of the paths has wildcards. Parsing can stop once all of them are found.
+
+  //! Constructor. Throws std::exception if a path is invalid.
+  path_filter(const std::vector<std::string>& _paths);
+
+  //! The value of a step is found. Returns true if it was the last one of the paths to be found.
+  bool found(path_node& _node)
+  {
+    if ( !canStop || _node.found )
+      return false;
+    _node.found = true;
+    return ( --pending == 0 );
+  }
+};
+
+} // namespace sid::json
@@ -0,0 +1,336 @@
+/*
+LICENSE: BEGIN
+===============================================================================
+@author Shan Anand
+@email anand.gs@gmail.com
+@source https://github.com/shan-anand
+@file push_parser.cpp
+@brief Implementation of the json push parser
+===============================================================================
+MIT License
+
+Copyright (c) 2017 Shanmuga (Anand) Gunasekaran
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+===============================================================================
+LICENSE: END
+*/
+
+/**
+ * @file  push_parser.cpp
+ * @brief Implementation of the json parser for chunked input
+ */
+#include "json/push_parser.h"
+#include "parser_io.h"
+#include "parser.h"
+
+using namespace std;
+using namespace sid;
+using namespace sid::json;
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Implementation of push_parser
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+struct push_parser::impl
+{
+  chunk_parser_input in;
+  chunk_parser       parser;
+
+  impl(parser_output& _out, const parser_control& _ctrl) : in(_ctrl), parser(in, _out) {}
+};
+
+push_parser::push_parser(parser_output& _out, const parser_control& _ctrl/* = parser_control()*/)
+  : m_impl(std::make_unique<impl>(_out, _ctrl))
+{
+}
+
+push_parser::~push_parser()
+{
+}
+
+void push_parser::feed(const char* _data, size_t _len)
+{
+  m_impl->parser.feed(_data, _len);
+}
+
+void push_parser::finish()
+{
+  m_impl->parser.finish();
+}
+
+bool push_parser::done() const
+{
+  return m_impl->parser.done();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Implementation of chunk_parser
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+chunk_parser::chunk_parser(const chunk_parser_input& _in, parser_output& _out)
+  : parser(_in, _out)
+{
+  m_out.clear();
+  s_init();
+}
+
+void chunk_parser::s_init()
+{
+  m_buf.clear();
+  m_data = m_buf.data();
+  m_size = m_cur = 0;
+  m_base = m_lineBegin = 0;
+  m_lines = 0;
+  m_tokens.clear();
+  m_token = 0;
+  m_scan = scan_state::space;
+  m_tokenFirst = 0;
+  // Unquoted strings can have structural characters. Numbers and literals end at them.
+  const bool flexible = ( m_in.ctrl.mode.allowFlexibleKeys || m_in.ctrl.mode.allowFlexibleStrings );
+  for ( int ch = 0; ch < 256; ch++ )
+    m_bareEnd[ch] = ::isspace(ch) || ch == '\"' || ( !flexible && ch != 0 && ::strchr(",:[]{}", ch) );
+  m_begun = m_finished = m_failed = false;
+  m_micros = 0;
+}
+
+void chunk_parser::feed(const char* _data, size_t _len)
+{
+  check_usable();
+  if ( m_finished )
+    throw std::runtime_error("Input fed after the end of the input");
+
+  time_calc tc;
+  tc.start();
+  try
+  {
+    size_t from = 0;
+    if ( m_cur == m_size )
+    {
+      // Everything so far is parsed. Parse the chunk where it is.
+      drop();
+      m_data = _data;
+      m_size = _len;
+    }
+    else
+    {
+      // Continue the unparsed input with the chunk
+      drop();
+      from = m_size;
+      m_buf.insert(m_buf.end(), _data, _data + _len);
+      m_data = m_buf.data();
+      m_size = m_buf.size();
+    }
+    scan(from);
+    advance();
+    // The chunk belongs to the caller. Keep what is not parsed yet.
+    if ( m_data != m_buf.data() )
+      drop();
+  }
+  catch (...)
+  {
+    m_failed = true;
+    set_stats(tc);
+    throw;
+  }
+  set_stats(tc);
+}
+
+void chunk_parser::finish()
+{
+  check_usable();
+  if ( m_finished )
+    return;
+
+  time_calc tc;
+  tc.start();
+  try
+  {
+    // The token being scanned ends with the input. ready() does not need tokens anymore.
+    m_finished = true;
+    advance();
+  }
+  catch (...)
+  {
+    m_failed = true;
+    set_stats(tc);
+    throw;
+  }
+  set_stats(tc);
+}
+
+void chunk_parser::check_usable() const
+{
+  if ( m_failed )
+    throw std::runtime_error("Parser cannot continue after an error");
+}
+
+void chunk_parser::set_stats(time_calc& _tc)
+{
+  _tc.stop();
+  m_micros += _tc.diff_microsecs();
+  m_out.stats.data_size = s_processed();
+  m_out.stats.time_ms = m_micros / 1000;
+}
+
+void chunk_parser::advance()
+{
+  if ( !m_begun )
+  {
+    if ( !s_ready() )
+      return;
+    begin_document();
+    m_begun = true;
+  }
+  if ( parse_document() && ( s_ready(), m_finished || !m_tokens.empty() ) )
+    end_document();
+}
+
+void chunk_parser::drop()
+{
+  // Count the lines of the data being dropped
+  if ( const size_t n = simd::count_newlines(m_data, m_data + m_cur) )
+  {
+    m_lines += n;
+    m_lineBegin = m_base + (static_cast<const char*>(::memrchr(m_data, '\n', m_cur)) + 1 - m_data);
+  }
+  m_base += m_cur;
+  m_tokens.erase(m_tokens.begin(), m_tokens.begin() + m_token);
+  m_token = 0;
+  if ( m_data == m_buf.data() )
+    m_buf.erase(m_buf.begin(), m_buf.begin() + m_cur);
+  else
+    m_buf.assign(m_data + m_cur, m_data + m_size);
+  m_data = m_buf.data();
+  m_size = m_buf.size();
+  m_cur = 0;
+}
+
+void chunk_parser::scan(size_t _from)
+{
+  // The scanner only finds where the tokens end. It may see fewer tokens than the parser does
+  // (like a comment or a string that ends within a longer token), but never more. So, the parser
+  // does not go beyond the input of the tokens it has been given.
+  const char* const end = m_data + m_size;
+  auto position = [&](const char* p)->pos_type { return m_base + static_cast<pos_type>(p - m_data); };
+  const char* p = m_data + _from;
+  while ( p < end )
+  {
+    switch ( m_scan )
+    {
+    case scan_state::space:
+      for ( ; p < end && ::isspace(static_cast<unsigned char>(*p)); ++p );
+      if ( p == end )
+        break;
+      m_tokenFirst = position(p);
+      switch ( *p++ )
+      {
+      case '{': case '}': case '[': case ']': case ',': case ':':
+        m_tokens.push_back(position(p));
+        break;
+      case '\"': m_scan = scan_state::quoted;       break;
+      case '#':  m_scan = scan_state::line_comment; break;
+      case '/':  m_scan = scan_state::slash;        break;
+      case '\\': m_scan = scan_state::bare_escape;  break;
+      default:   m_scan = scan_state::bare;         break;
+      }
+      break;
+    case scan_state::quoted:
+      if ( (p = simd::find_string_special(p, end)) == end )
+        break;
+      if ( *p == '\"' )
+      {
+        m_tokens.push_back(position(++p));
+        m_scan = scan_state::space;
+      }
+      else if ( *p++ == '\\' )
+        m_scan = scan_state::quoted_escape;
+      break;
+    case scan_state::quoted_escape:
+      ++p;
+      m_scan = scan_state::quoted;
+      break;
+    case scan_state::bare:
+      for ( ; p < end; ++p )
+      {
+        if ( *p == '\\' || *p == '/' || *p == '#' || m_bareEnd[static_cast<uint8_t>(*p)] )
+          break;
+      }
+      if ( p == end )
+        break;
+      switch ( *p )
+      {
+      case '\\': m_scan = scan_state::bare_escape; ++p; break;
+      case '/':  m_scan = scan_state::slash;       ++p; break;
+      case '#':
+        m_tokens.push_back(position(p++));
+        m_scan = scan_state::line_comment;
+        break;
+      default:
+        m_tokens.push_back(position(p));
+        m_scan = scan_state::space;
+        break;
+      }
+      break;
+    case scan_state::bare_escape:
+      ++p;
+      m_scan = scan_state::bare;
+      break;
+    case scan_state::slash:
+      if ( *p == '/' || *p == '*' )
+      {
+        // A comment. It ends the token before it, if any.
+        const pos_type slash = position(p) - 1;
+        if ( m_tokenFirst < slash )
+          m_tokens.push_back(slash);
+        m_scan = ( *p++ == '/' )? scan_state::line_comment : scan_state::block_comment;
+      }
+      else
+        m_scan = scan_state::bare;
+      break;
+    case scan_state::line_comment:
+      if ( const char* eol = static_cast<const char*>(::memchr(p, '\n', end - p)) )
+      {
+        p = eol + 1;
+        m_scan = scan_state::space;
+      }
+      else
+        p = end;
+      break;
+    case scan_state::block_comment:
+      if ( const char* star = static_cast<const char*>(::memchr(p, '*', end - p)) )
+      {
+        p = star + 1;
+        m_scan = scan_state::block_comment_star;
+      }
+      else
+        p = end;
+      break;
+    case scan_state::block_comment_star:
+      if ( *p == '/' )
+        m_scan = scan_state::space;
+      else if ( *p != '*' )
+        m_scan = scan_state::block_comment;
+      ++p;
+      break;
+    }
+  }
+}
@@ -0,0 +1,208 @@
+/*
+LICENSE: BEGIN
+===============================================================================
+@author Shan Anand
+@email anand.gs@gmail.com
+@source https://github.com/shan-anand
+@file reader.cpp
+@brief Json handling using c++
+===============================================================================
+MIT License
+
+Copyright (c) 2017 Shanmuga (Anand) Gunasekaran
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+===============================================================================
+LICENSE: END
+*/
+
+/**
+ * @file  reader.cpp
+ * @brief Implementation of the pull parser
+ */
+#include "json/reader.h"
+#include "json/sax_handler.h"
+#include "parser_io.h"
+#include "parser.h"
+
+using namespace std;
+using namespace sid;
+using namespace sid::json;
+
+std::string json::to_str(const token_type& _type)
+{
+  switch ( _type )
+  {
+  case token_type::end:          return "end";
+  case token_type::start_object: return "start_object";
+  case token_type::end_object:   return "end_object";
+  case token_type::start_array:  return "start_array";
+  case token_type::end_array:    return "end_array";
+  case token_type::string:       return "string";
+  case token_type::_signed:      return "signed";
+  case token_type::_unsigned:    return "unsigned";
+  case token_type::_double:      return "double";
+  case token_type::boolean:      return "boolean";
+  case token_type::null:         return "null";
+  }
+  return std::string();
+}
+
+namespace local
+{
+//! Parser of the input that gives the events to the reader one at a time
+struct event_source
+{
+  virtual ~event_source() = default;
+  //! continue until the next event. Returns false once the root is closed.
+  virtual bool next_event() = 0;
+  //! skip the rest of the container. Returns false if the parser cannot do it.
+  virtual bool skip_container() = 0;
+};
+
+template <typename Parser, typename ParserInput>
+struct parser_source : public event_source
+{
+  parser_output out;
+  ParserInput   in;
+  Parser        parser;
+
+  template <typename... Args>
+  parser_source(sax_handler& _handler, Args&&... _args)
+    : out(), in(std::forward<Args>(_args)...), parser(in, out)
+  {
+    parser.begin_events(_handler);
+  }
+  bool next_event() override { return parser.next_event(); }
+  bool skip_container() override { return parser.skip_container(); }
+};
+} // namespace local
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Implementation of reader
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+//! The parser stops at every event, which becomes the next token. The key of a member is kept
+//! for the token of its value.
+struct reader::impl : public sax_handler
+{
+  token       m_token;     //! Token of the last event
+  uint32_t    m_depth;     //! Number of containers open
+  bool        m_hasKey;    //! A key was given for the next token
+  bool        m_stable;    //! The views of the parser stay valid until the next event
+  std::string m_keyBuf;    //! Copy of the key if the views are not stable
+  std::string m_strBuf;    //! Copy of the string if the views are not stable
+  std::unique_ptr<local::event_source> m_source;
+
+  impl(const bool _stable) : m_token(), m_depth(0), m_hasKey(false), m_stable(_stable), m_source() {}
+
+  bool next(token& _token)
+  {
+    if ( !m_source->next_event() )
+      m_token = token();
+    _token = m_token;
+    return ( m_token.type != token_type::end );
+  }
+
+  void skip()
+  {
+    if ( m_token.type != token_type::start_object && m_token.type != token_type::start_array )
+      return;
+    const uint32_t depth = m_token.depth;
+    if ( m_source->skip_container() )
+      m_source->next_event(); // The end of the container
+    else
+    {
+      // Go through the tokens
+      do
+      {
+        if ( !m_source->next_event() )
+          break;
+      }
+      while ( m_token.depth != depth || ( m_token.type != token_type::end_object
+                                       && m_token.type != token_type::end_array ) );
+    }
+  }
+
+  //! Start a token. Returns false to stop the parser at it.
+  bool set(const token_type _type)
+  {
+    m_token.type = _type;
+    m_token.depth = m_depth;
+    m_token.key = m_hasKey? m_token.key : std::string_view();
+    if ( _type != token_type::string )
+      m_token.str = std::string_view();
+    m_hasKey = false;
+    return false;
+  }
+
+  bool start_object() override { set(token_type::start_object); m_depth++; return false; }
+  bool start_array() override { set(token_type::start_array); m_depth++; return false; }
+  bool end_object() override { m_depth--; m_hasKey = false; return set(token_type::end_object); }
+  bool end_array() override { m_depth--; m_hasKey = false; return set(token_type::end_array); }
+  bool key(std::string_view _key) override
+  {
+    if ( !m_stable )
+      _key = m_keyBuf.assign(_key);
+    m_token.key = _key;
+    m_hasKey = true;
+    return true;
+  }
+  bool string(std::string_view _val) override
+  {
+    if ( !m_stable )
+      _val = m_strBuf.assign(_val);
+    m_token.str = _val;
+    return set(token_type::string);
+  }
+  bool number(int64_t _val) override { m_token.i64 = _val; return set(token_type::_signed); }
+  bool number(uint64_t _val) override { m_token.u64 = _val; return set(token_type::_unsigned); }
+  bool number(long double _val) override { m_token.dbl = _val; return set(token_type::_double); }
+  bool boolean(bool _val) override { m_token.bval = _val; return set(token_type::boolean); }
+  bool null() override { return set(token_type::null); }
+};
+
+reader::reader(const std::string& _in, const input_type _type/* = input_type::data*/,
+               const parser_control& _ctrl/* = parser_control()*/)
+  : m_impl(std::make_unique<impl>(true))
+{
+  m_impl->m_source = std::make_unique<local::parser_source<char_parser, char_parser_input>>(*m_impl, _in, _type, _ctrl);
+}
+
+reader::reader(std::streambuf& _in, const parser_control& _ctrl/* = parser_control()*/)
+  : m_impl(std::make_unique<impl>(false))
+{
+  m_impl->m_source = std::make_unique<local::parser_source<buffer_parser, buffer_parser_input>>(*m_impl, _in, _ctrl);
+}
+
+reader::~reader()
+{
+}
+
+bool reader::next(token& _token)
+{
+  return m_impl->next(_token);
+}
+
+void reader::skip()
+{
+  m_impl->skip();
+}
@@ -54,6 +54,10 @@ void fill_required(
   const value&                _jarray,
   const schema::property_vec& _properties
   );
+//! compare a number value with a limit. Returns <0, 0 or >0 if it is less, equal or greater.
+int compare(const value& _jval, int64_t _limit);
+//! number of characters of a UTF-8 string
+size_t utf8_length(const std::string_view _str);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -237,25 +241,25 @@ void schema::property::set(const value& _jproperties, const std::string& _key)
     {
       if ( ! jval.is_decimal() )
         throw std::runtime_error("exclusiveMinimum must be a decimal value");
-      this->minimum = jval.get_int64();
+      this->exclusiveMinimum = jval.get_int64();
     }
     if ( jproperty.has_key("maximum", jval) )
     {
       if ( ! jval.is_decimal() )
         throw std::runtime_error("maximum must be a decimal value");
-      this->minimum = jval.get_int64();
+      this->maximum = jval.get_int64();
     }
     if ( jproperty.has_key("exclusiveMaximum", jval) )
     {
       if ( ! jval.is_decimal() )
         throw std::runtime_error("exclusiveMaximum must be a decimal value");
-      this->minimum = jval.get_int64();
+      this->exclusiveMaximum = jval.get_int64();
     }
     if ( jproperty.has_key("multipleOf", jval) )
     {
       if ( ! jval.is_decimal() )
         throw std::runtime_error("multipleOf must be a decimal value");
-      this->minimum = jval.get_int64();
+      this->multipleOf = jval.get_int64();
     }
   }
   if ( this->type.exists(schema_type::string) )
@@ -382,6 +386,45 @@ value schema::property_vec::to_json() const
   return jroot;
 }
 
+bool schema::property::check(const value& _jval, std::string& _error) const
+{
+  if ( ! this->type.allows(_jval.type()) )
+  {
+    _error = "Type " + to_str(_jval.type()) + " of " + this->key + " is not " + this->type.to_string();
+    return false;
+  }
+  if ( _jval.is_num() )
+  {
+    if ( this->minimum && local::compare(_jval, *this->minimum) < 0 )
+      _error = "Value of " + this->key + " is less than the minimum " + std::to_string(*this->minimum);
+    else if ( this->exclusiveMinimum && local::compare(_jval, *this->exclusiveMinimum) <= 0 )
+      _error = "Value of " + this->key + " is not greater than " + std::to_string(*this->exclusiveMinimum);
+    else if ( this->maximum && local::compare(_jval, *this->maximum) > 0 )
+      _error = "Value of " + this->key + " is greater than the maximum " + std::to_string(*this->maximum);
+    else if ( this->exclusiveMaximum && local::compare(_jval, *this->exclusiveMaximum) >= 0 )
+      _error = "Value of " + this->key + " is not less than " + std::to_string(*this->exclusiveMaximum);
+    else if ( this->multipleOf && *this->multipleOf > 0 && _jval.is_decimal()
+              && ( _jval.is_signed()? _jval.get_int64() % *this->multipleOf
+                                    : _jval.get_uint64() % static_cast<uint64_t>(*this->multipleOf) ) != 0 )
+      _error = "Value of " + this->key + " is not a multiple of " + std::to_string(*this->multipleOf);
+    else
+      return true;
+    return false;
+  }
+  if ( _jval.is_string() && ( this->minLength || this->maxLength ) )
+  {
+    const size_t length = local::utf8_length(_jval.get_str_view());
+    if ( this->minLength && length < *this->minLength )
+      _error = "Length of " + this->key + " is less than " + std::to_string(*this->minLength);
+    else if ( this->maxLength && length > *this->maxLength )
+      _error = "Length of " + this->key + " is greater than " + std::to_string(*this->maxLength);
+    else
+      return true;
+    return false;
+  }
+  return true;
+}
+
 std::string schema::property::to_string() const
 {
   return to_json().to_string(format_type::pretty);
@@ -408,7 +451,7 @@ value schema::property::to_json() const
     if ( this->exclusiveMaximum )
       jroot["exclusiveMaximum"] = this->exclusiveMaximum.value();
     if ( this->multipleOf )
-      jroot["multipleOf"] = this->maximum.value();
+      jroot["multipleOf"] = this->multipleOf.value();
   }
   if ( this->type.exists(schema_type::string) )
   {
@@ -446,6 +489,12 @@ value schema::property::to_json() const
   return jroot;
 }
 
+std::string schema_types::to_string() const
+{
+  const value jtypes = to_json();
+  return jtypes.is_array()? jtypes.to_string() : jtypes.get_str();
+}
+
 value schema_types::to_json() const
 {
   value jroot;
@@ -517,6 +566,24 @@ std::string schema_type::name() const
   return name;
 }
 
+bool schema_types::allows(const json::value_type _type) const
+{
+  if ( this->empty() )
+    return true;
+  switch ( _type )
+  {
+  case json::value_type::null:      return exists(schema_type::null);
+  case json::value_type::object:    return exists(schema_type::object);
+  case json::value_type::array:     return exists(schema_type::array);
+  case json::value_type::string:    return exists(schema_type::string);
+  case json::value_type::boolean:   return exists(schema_type::boolean);
+  case json::value_type::_double:   return exists(schema_type::number);
+  case json::value_type::_signed:
+  case json::value_type::_unsigned: return exists(schema_type::integer) || exists(schema_type::number);
+  }
+  return false;
+}
+
 void schema_types::add(const value& _value)
 {
   if ( _value.is_string() )
@@ -577,3 +644,31 @@ void local::fill_required(
     }
   }
 }
+
+int local::compare(const value& _jval, int64_t _limit)
+{
+  if ( _jval.is_signed() )
+  {
+    const int64_t num = _jval.get_int64();
+    return ( num < _limit )? -1 : ( num > _limit )? 1 : 0;
+  }
+  if ( _jval.is_unsigned() )
+  {
+    const uint64_t num = _jval.get_uint64();
+    if ( _limit < 0 )
+      return 1;
+    return ( num < static_cast<uint64_t>(_limit) )? -1 : ( num > static_cast<uint64_t>(_limit) )? 1 : 0;
+  }
+  const long double num = _jval.get_double();
+  return ( num < _limit )? -1 : ( num > _limit )? 1 : 0;
+}
+
+size_t local::utf8_length(const std::string_view _str)
+{
+  // Count every byte but the continuation bytes
+  size_t length = 0;
+  for ( const char ch : _str )
+    if ( ( static_cast<unsigned char>(ch) & 0xC0 ) != 0x80 )
+      length++;
+  return length;
+}
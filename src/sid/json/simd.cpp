@@ -0,0 +1,418 @@
+/*
+LICENSE: BEGIN
+===============================================================================
+@author Shan Anand
+@email anand.gs@gmail.com
+@source https://github.com/shan-anand
+@file simd.cpp
+@brief Vectorized character classification kernels with runtime dispatch
+===============================================================================
+MIT License
+
+Copyright (c) 2017 Shanmuga (Anand) Gunasekaran
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+===============================================================================
+LICENSE: END
+*/
+
+/**
+ * @file  simd.cpp
+ * @brief Implementation of the vectorized kernels and the runtime dispatch
+ */
+#include "simd.h"
+#include "utils.h"
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SID_JSON_X86 1
+#include <immintrin.h>
+#endif
+
+using namespace sid::json;
+
+namespace local
+{
+//! Character class bits of the scalar lookup table
+enum : uint8_t {
+  c_quote = 0x01, c_backslash = 0x02, c_op = 0x04, c_space = 0x08, c_comment = 0x10,
+  c_open = 0x20, c_close = 0x40
+};
+
+struct class_table
+{
+  uint8_t bits[256];
+  class_table()
+  {
+    ::memset(bits, 0, sizeof(bits));
+    bits[(uint8_t) '\"'] = c_quote;
+    bits[(uint8_t) '\\'] = c_backslash;
+    for ( uint8_t ch : { ':', ',' } )
+      bits[ch] = c_op;
+    for ( uint8_t ch : { '{', '[' } )
+      bits[ch] = c_op | c_open;
+    for ( uint8_t ch : { '}', ']' } )
+      bits[ch] = c_op | c_close;
+    for ( uint8_t ch : { ' ', '\t', '\n', '\v', '\f', '\r' } )
+      bits[ch] = c_space;
+    bits[(uint8_t) '#'] = c_comment;
+    bits[(uint8_t) '/'] = c_comment;
+  }
+};
+static const class_table gClassTable;
+
+void classify_scalar(const char* _p, simd::block_masks& _masks)
+{
+  uint64_t quote = 0, backslash = 0, op = 0, open = 0, close = 0, space = 0, comment = 0;
+  for ( size_t i = 0; i < simd::block_size; i++ )
+  {
+    const uint8_t bits = gClassTable.bits[(uint8_t) _p[i]];
+    if ( bits == 0 ) continue;
+    const uint64_t bit = uint64_t(1) << i;
+    if ( bits & c_quote )     quote |= bit;
+    if ( bits & c_backslash ) backslash |= bit;
+    if ( bits & c_op )        op |= bit;
+    if ( bits & c_open )      open |= bit;
+    if ( bits & c_close )     close |= bit;
+    if ( bits & c_space )     space |= bit;
+    if ( bits & c_comment )   comment |= bit;
+  }
+  _masks = { quote, backslash, op, open, close, space, comment };
+}
+
+inline bool is_string_special(char _ch)
+{
+  return _ch == '\"' || _ch == '\\' || static_cast<uint8_t>(_ch) < 0x20;
+}
+
+const char* find_string_special_scalar(const char* _p, const char* _end)
+{
+  for ( ; _p < _end && !is_string_special(*_p); ++_p );
+  return _p;
+}
+
+const char* find_invalid_utf8_scalar(const char* _p, const char* _end)
+{
+  uint32_t cp;
+  while ( _p < _end )
+  {
+    if ( static_cast<uint8_t>(*_p) < 0x80 )
+    {
+      ++_p;
+      continue;
+    }
+    const char* next = decode_utf8(_p, _end, cp);
+    if ( next == nullptr )
+      return _p;
+    _p = next;
+  }
+  return _end;
+}
+
+size_t count_newlines_scalar(const char* _p, const char* _end)
+{
+  size_t count = 0;
+  for ( ; _p < _end && (_p = static_cast<const char*>(::memchr(_p, '\n', _end - _p))); ++_p )
+    ++count;
+  return count;
+}
+
+#ifdef SID_JSON_X86
+
+//! 16 byte lane helpers
+__attribute__((target("sse4.2")))
+inline uint64_t eq_sse42(const __m128i& _v, char _ch)
+{
+  return (uint16_t) _mm_movemask_epi8(_mm_cmpeq_epi8(_v, _mm_set1_epi8(_ch)));
+}
+
+__attribute__((target("sse4.2")))
+inline uint64_t in_range_sse42(const __m128i& _v, uint8_t _lo, uint8_t _hi)
+{
+  const __m128i lo = _mm_cmpeq_epi8(_mm_max_epu8(_v, _mm_set1_epi8((char) _lo)), _v);
+  const __m128i hi = _mm_cmpeq_epi8(_mm_min_epu8(_v, _mm_set1_epi8((char) _hi)), _v);
+  return (uint16_t) _mm_movemask_epi8(_mm_and_si128(lo, hi));
+}
+
+__attribute__((target("sse4.2")))
+void classify_sse42(const char* _p, simd::block_masks& _masks)
+{
+  _masks = { 0, 0, 0, 0, 0, 0, 0 };
+  for ( size_t i = 0; i < simd::block_size; i += 16 )
+  {
+    const __m128i v = _mm_loadu_si128((const __m128i*) (_p + i));
+    _masks.quote     |= eq_sse42(v, '\"') << i;
+    _masks.backslash |= eq_sse42(v, '\\') << i;
+    const uint64_t open = eq_sse42(v, '{') | eq_sse42(v, '[');
+    const uint64_t close = eq_sse42(v, '}') | eq_sse42(v, ']');
+    _masks.open      |= open << i;
+    _masks.close     |= close << i;
+    _masks.op        |= ( open | close | eq_sse42(v, ':') | eq_sse42(v, ',') ) << i;
+    _masks.space     |= ( eq_sse42(v, ' ') | in_range_sse42(v, '\t', '\r') ) << i;
+    _masks.comment   |= ( eq_sse42(v, '#') | eq_sse42(v, '/') ) << i;
+  }
+}
+
+//! 32 byte lane helpers
+__attribute__((target("avx2")))
+inline uint64_t eq_avx2(const __m256i& _v, char _ch)
+{
+  return (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(_v, _mm256_set1_epi8(_ch)));
+}
+
+__attribute__((target("avx2")))
+inline uint64_t in_range_avx2(const __m256i& _v, uint8_t _lo, uint8_t _hi)
+{
+  const __m256i lo = _mm256_cmpeq_epi8(_mm256_max_epu8(_v, _mm256_set1_epi8((char) _lo)), _v);
+  const __m256i hi = _mm256_cmpeq_epi8(_mm256_min_epu8(_v, _mm256_set1_epi8((char) _hi)), _v);
+  return (uint32_t) _mm256_movemask_epi8(_mm256_and_si256(lo, hi));
+}
+
+__attribute__((target("avx2")))
+void classify_avx2(const char* _p, simd::block_masks& _masks)
+{
+  _masks = { 0, 0, 0, 0, 0, 0, 0 };
+  for ( size_t i = 0; i < simd::block_size; i += 32 )
+  {
+    const __m256i v = _mm256_loadu_si256((const __m256i*) (_p + i));
+    _masks.quote     |= eq_avx2(v, '\"') << i;
+    _masks.backslash |= eq_avx2(v, '\\') << i;
+    const uint64_t open = eq_avx2(v, '{') | eq_avx2(v, '[');
+    const uint64_t close = eq_avx2(v, '}') | eq_avx2(v, ']');
+    _masks.open      |= open << i;
+    _masks.close     |= close << i;
+    _masks.op        |= ( open | close | eq_avx2(v, ':') | eq_avx2(v, ',') ) << i;
+    _masks.space     |= ( eq_avx2(v, ' ') | in_range_avx2(v, '\t', '\r') ) << i;
+    _masks.comment   |= ( eq_avx2(v, '#') | eq_avx2(v, '/') ) << i;
+  }
+}
+
+__attribute__((target("sse4.2")))
+const char* find_string_special_sse42(const char* _p, const char* _end)
+{
+  for ( ; _end - _p >= 16; _p += 16 )
+  {
+    const __m128i v = _mm_loadu_si128((const __m128i*) _p);
+    const __m128i ctrl = _mm_cmpeq_epi8(_mm_min_epu8(v, _mm_set1_epi8(0x1F)), v);
+    const uint32_t mask = eq_sse42(v, '\"') | eq_sse42(v, '\\')
+                          | (uint16_t) _mm_movemask_epi8(ctrl);
+    if ( mask )
+      return _p + __builtin_ctz(mask);
+  }
+  return find_string_special_scalar(_p, _end);
+}
+
+__attribute__((target("avx2")))
+const char* find_string_special_avx2(const char* _p, const char* _end)
+{
+  for ( ; _end - _p >= 32; _p += 32 )
+  {
+    const __m256i v = _mm256_loadu_si256((const __m256i*) _p);
+    const __m256i ctrl = _mm256_cmpeq_epi8(_mm256_min_epu8(v, _mm256_set1_epi8(0x1F)), v);
+    const uint64_t mask = eq_avx2(v, '\"') | eq_avx2(v, '\\')
+                          | (uint32_t) _mm256_movemask_epi8(ctrl);
+    if ( mask )
+      return _p + __builtin_ctzll(mask);
+  }
+  return find_string_special_sse42(_p, _end);
+}
+
+// Blocks of ASCII characters are skipped at once. The multibyte sequences are decoded one by one.
+__attribute__((target("sse4.2")))
+const char* find_invalid_utf8_sse42(const char* _p, const char* _end)
+{
+  uint32_t cp;
+  while ( _end - _p >= 16 )
+  {
+    const uint32_t mask = (uint16_t) _mm_movemask_epi8(_mm_loadu_si128((const __m128i*) _p));
+    if ( mask == 0 )
+    {
+      _p += 16;
+      continue;
+    }
+    _p += __builtin_ctz(mask);
+    const char* next = decode_utf8(_p, _end, cp);
+    if ( next == nullptr )
+      return _p;
+    _p = next;
+  }
+  return find_invalid_utf8_scalar(_p, _end);
+}
+
+__attribute__((target("avx2")))
+const char* find_invalid_utf8_avx2(const char* _p, const char* _end)
+{
+  uint32_t cp;
+  while ( _end - _p >= 32 )
+  {
+    const uint32_t mask = (uint32_t) _mm256_movemask_epi8(_mm256_loadu_si256((const __m256i*) _p));
+    if ( mask == 0 )
+    {
+      _p += 32;
+      continue;
+    }
+    _p += __builtin_ctz(mask);
+    const char* next = decode_utf8(_p, _end, cp);
+    if ( next == nullptr )
+      return _p;
+    _p = next;
+  }
+  return find_invalid_utf8_sse42(_p, _end);
+}
+
+__attribute__((target("sse4.2")))
+size_t count_newlines_sse42(const char* _p, const char* _end)
+{
+  size_t count = 0;
+  for ( ; _end - _p >= 16; _p += 16 )
+    count += __builtin_popcount(eq_sse42(_mm_loadu_si128((const __m128i*) _p), '\n'));
+  return count + count_newlines_scalar(_p, _end);
+}
+
+__attribute__((target("avx2")))
+size_t count_newlines_avx2(const char* _p, const char* _end)
+{
+  size_t count = 0;
+  for ( ; _end - _p >= 32; _p += 32 )
+    count += __builtin_popcountll(eq_avx2(_mm256_loadu_si256((const __m256i*) _p), '\n'));
+  return count + count_newlines_scalar(_p, _end);
+}
+
+#endif // SID_JSON_X86
+
+simd::level detect_level()
+{
+  simd::level best = simd::level::scalar;
+#ifdef SID_JSON_X86
+  __builtin_cpu_init();
+  if ( __builtin_cpu_supports("avx2") )
+    best = simd::level::avx2;
+  else if ( __builtin_cpu_supports("sse4.2") )
+    best = simd::level::sse42;
+#endif
+  // The environment can only lower the level, never raise it above the cpu support
+  if ( const char* env = ::getenv("SID_JSON_SIMD"); env != nullptr )
+  {
+    for ( simd::level l : { simd::level::scalar, simd::level::sse42, simd::level::avx2 } )
+      if ( simd::to_str(l) == env && l < best )
+        best = l;
+  }
+  return best;
+}
+
+using classify_fn = void (*)(const char*, simd::block_masks&);
+
+classify_fn resolve_classify()
+{
+  switch ( simd::active_level() )
+  {
+#ifdef SID_JSON_X86
+  case simd::level::avx2:  return classify_avx2;
+  case simd::level::sse42: return classify_sse42;
+#endif
+  default: break;
+  }
+  return classify_scalar;
+}
+
+using find_fn = const char* (*)(const char*, const char*);
+
+find_fn resolve_find_string_special()
+{
+  switch ( simd::active_level() )
+  {
+#ifdef SID_JSON_X86
+  case simd::level::avx2:  return find_string_special_avx2;
+  case simd::level::sse42: return find_string_special_sse42;
+#endif
+  default: break;
+  }
+  return find_string_special_scalar;
+}
+
+find_fn resolve_find_invalid_utf8()
+{
+  switch ( simd::active_level() )
+  {
+#ifdef SID_JSON_X86
+  case simd::level::avx2:  return find_invalid_utf8_avx2;
+  case simd::level::sse42: return find_invalid_utf8_sse42;
+#endif
+  default: break;
+  }
+  return find_invalid_utf8_scalar;
+}
+
+using count_fn = size_t (*)(const char*, const char*);
+
+count_fn resolve_count_newlines()
+{
+  switch ( simd::active_level() )
+  {
+#ifdef SID_JSON_X86
+  case simd::level::avx2:  return count_newlines_avx2;
+  case simd::level::sse42: return count_newlines_sse42;
+#endif
+  default: break;
+  }
+  return count_newlines_scalar;
+}
+} // namespace local
+
+std::string simd::to_str(const level& _level)
+{
+  switch ( _level )
+  {
+  case level::scalar: return "scalar";
+  case level::sse42:  return "sse42";
+  case level::avx2:   return "avx2";
+  }
+  return std::string();
+}
+
+simd::level simd::active_level()
+{
+  static const level gLevel = local::detect_level();
+  return gLevel;
+}
+
+void simd::classify(const char* _p, block_masks& _masks)
+{
+  static const local::classify_fn gClassify = local::resolve_classify();
+  gClassify(_p, _masks);
+}
+
+const char* simd::find_string_special(const char* _p, const char* _end)
+{
+  static const local::find_fn gFind = local::resolve_find_string_special();
+  return gFind(_p, _end);
+}
+
+const char* simd::find_invalid_utf8(const char* _p, const char* _end)
+{
+  static const local::find_fn gFind = local::resolve_find_invalid_utf8();
+  return gFind(_p, _end);
+}
+
+size_t simd::count_newlines(const char* _p, const char* _end)
+{
+  static const local::count_fn gCount = local::resolve_count_newlines();
+  return gCount(_p, _end);
+}
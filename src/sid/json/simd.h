@@ -0,0 +1,140 @@
+/*
+LICENSE: BEGIN
+===============================================================================
+@author Shan Anand
+@email anand.gs@gmail.com
+@source https://github.com/shan-anand
+@file simd.h
+@brief Vectorized character classification kernels with runtime dispatch
+===============================================================================
+MIT License
+
+Copyright (c) 2017 Shanmuga (Anand) Gunasekaran
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+===============================================================================
+LICENSE: END
+*/
+
+/**
+ * @file  simd.h
+ * @brief Vectorized character classification kernels with runtime dispatch
+ */
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+namespace sid::json::simd {
+
+//! Instruction set used by the vectorized kernels
+enum class level : uint8_t { scalar, sse42, avx2 };
+std::string to_str(const level& _level);
+
+//! Size of the block processed by classify()
+constexpr size_t block_size = 64;
+
+/**
+ * @struct block_masks
+ * @brief Character classes of a block of 64 bytes. Bit i of each mask represents byte i.
+ */
+struct block_masks
+{
+  uint64_t quote;     //! "
+  uint64_t backslash; //! \ (backslash)
+  uint64_t op;        //! Structural characters { } [ ] : ,
+  uint64_t open;      //! { [
+  uint64_t close;     //! } ]
+  uint64_t space;     //! Space characters (same set as ::isspace)
+  uint64_t comment;   //! Comment starting characters # /
+};
+
+/**
+ * @fn active_level
+ * @brief Get the instruction set used for the kernels.
+ *        It is the best one supported by the cpu, unless it is lowered using the environment
+ *        variable SID_JSON_SIMD=scalar|sse42|avx2. It is evaluated only once.
+ */
+level active_level();
+
+/**
+ * @fn classify
+ * @brief Classify the 64 bytes starting at _p using the active kernel
+ * @param _p Start of the block. All the 64 bytes must be readable.
+ * @param _masks [out] Character class masks of the block
+ */
+void classify(const char* _p, block_masks& _masks);
+
+/**
+ * @fn find_string_special
+ * @brief Find the first double-quote, backslash or control character in [_p, _end)
+ * @return Position of the character, or _end if there are none
+ */
+const char* find_string_special(const char* _p, const char* _end);
+
+/**
+ * @fn find_invalid_utf8
+ * @brief Find the first byte of [_p, _end) that does not start a valid UTF-8 sequence, or starts
+ *        one that is cut off by _end
+ * @return Position of the byte, or _end if all of it is valid
+ */
+const char* find_invalid_utf8(const char* _p, const char* _end);
+
+/**
+ * @fn count_newlines
+ * @brief Count the newline characters in [_p, _end)
+ */
+size_t count_newlines(const char* _p, const char* _end);
+
+//! Get the bits of the characters escaped by a backslash.
+//! _prevEscaped carries the escape of the first byte of the next block.
+inline uint64_t find_escaped(uint64_t _backslash, uint64_t& _prevEscaped)
+{
+  // A backslash that is escaped itself doesn't escape the next character
+  uint64_t escaped = _prevEscaped;
+  uint64_t backslash = _backslash & ~_prevEscaped;
+  _prevEscaped = 0;
+  while ( backslash )
+  {
+    const int i = __builtin_ctzll(backslash);
+    if ( i == 63 )
+    {
+      _prevEscaped = 1;
+      break;
+    }
+    escaped |= uint64_t(1) << (i+1);
+    backslash &= ~(uint64_t(3) << i);
+  }
+  return escaped;
+}
+
+//! Running xor of the bits. Every bit between an opening and a closing quote becomes 1.
+inline uint64_t prefix_xor(uint64_t _bits)
+{
+  _bits ^= _bits << 1;
+  _bits ^= _bits << 2;
+  _bits ^= _bits << 4;
+  _bits ^= _bits << 8;
+  _bits ^= _bits << 16;
+  _bits ^= _bits << 32;
+  return _bits;
+}
+
+} // namespace sid::json::simd
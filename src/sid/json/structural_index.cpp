@@ -0,0 +1,176 @@
+/*
+LICENSE: BEGIN
+===============================================================================
+@author Shan Anand
+@email anand.gs@gmail.com
+@source https://github.com/shan-anand
+@file structural_index.cpp
+@brief Stage 1 structural index for contiguous json input
+===============================================================================
+MIT License
+
+Copyright (c) 2017 Shanmuga (Anand) Gunasekaran
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+===============================================================================
+LICENSE: END
+*/
+
+/**
+ * @file  structural_index.cpp
+ * @brief Implementation of the stage 1 structural index
+ */
+#include "structural_index.h"
+#include <algorithm>
+#include <cstring>
+
+using namespace sid::json;
+
+namespace local
+{
+//! Number of bytes indexed in one window. The token offsets within the window are 16-bit.
+constexpr size_t index_window_size = 64 * 1024;
+} // namespace local
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Implementation of structural_index
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+structural_index::structural_index()
+  : m_positions(local::index_window_size)
+{
+  reset(nullptr, nullptr);
+}
+
+void structural_index::reset(const char* _first, const char* _end)
+{
+  m_first = m_scanned = m_window = _first;
+  m_end = m_limit = _end;
+  m_count = m_cursor = 0;
+  m_inString = m_escaped = m_scalar = 0;
+}
+
+void structural_index::disable()
+{
+  m_limit = m_scanned = m_window = m_first;
+  m_count = m_cursor = 0;
+}
+
+bool structural_index::next(const char* _pos, const char*& _token)
+{
+  // The parser moves forward only. Step back if it ever seeks backwards.
+  if ( m_cursor > 0 && m_window + m_positions[m_cursor-1] >= _pos )
+  {
+    m_cursor = 0;
+    if ( _pos < m_window )
+      return false;
+  }
+  while ( true )
+  {
+    for ( ; m_cursor < m_count; m_cursor++ )
+    {
+      if ( m_window + m_positions[m_cursor] >= _pos )
+      {
+        _token = m_window + m_positions[m_cursor];
+        return true;
+      }
+    }
+    if ( m_scanned >= m_limit )
+    {
+      // The remaining input has no tokens if the whole input is indexed
+      if ( m_limit != m_end || _pos > m_end )
+        return false;
+      _token = m_end;
+      return true;
+    }
+    index_window();
+  }
+}
+
+void structural_index::skip_to(const char* _pos)
+{
+  // Nothing beyond a comment is indexed
+  if ( _pos <= m_scanned || m_limit != m_end )
+    return;
+  m_scanned = m_window = _pos;
+  m_count = m_cursor = 0;
+  m_inString = m_escaped = m_scalar = 0;
+}
+
+void structural_index::index_window()
+{
+  m_window = m_scanned;
+  m_count = m_cursor = 0;
+  const char* stop = m_scanned + std::min(local::index_window_size, size_t(m_limit - m_scanned));
+  while ( m_scanned < stop )
+  {
+    const size_t len = std::min(simd::block_size, size_t(m_end - m_scanned));
+    if ( len == simd::block_size )
+      index_block(m_scanned, m_scanned, len);
+    else
+    {
+      // Pad the last partial block with spaces. We must not read beyond the input.
+      char block[simd::block_size];
+      ::memset(block, ' ', sizeof(block));
+      ::memcpy(block, m_scanned, len);
+      index_block(m_scanned, block, len);
+    }
+    m_scanned += len;
+    if ( m_limit != m_end )
+    {
+      // A comment was found. Nothing beyond it can be indexed.
+      m_scanned = m_limit;
+      break;
+    }
+  }
+}
+
+void structural_index::index_block(const char* _block, const char* _p, size_t _len)
+{
+  simd::block_masks masks;
+  simd::classify(_p, masks);
+
+  const uint64_t quote = masks.quote & ~simd::find_escaped(masks.backslash, m_escaped);
+  // Bits of the opening quote and the string contents are set. The closing quote is not.
+  const uint64_t inString = simd::prefix_xor(quote) ^ m_inString;
+  m_inString = uint64_t(int64_t(inString) >> 63);
+
+  const uint64_t outside = ~inString;
+  const uint64_t op = masks.op & outside;
+  const uint64_t scalar = outside & ~(op | (masks.space & outside) | quote);
+  const uint64_t scalarStart = scalar & ~((scalar << 1) | m_scalar);
+  m_scalar = scalar >> 63;
+
+  // Ignore the padding of the last block
+  const uint64_t valid = ( _len < simd::block_size )? ((uint64_t(1) << _len) - 1) : ~uint64_t(0);
+  uint64_t tokens = (op | quote | scalarStart) & valid;
+  if ( const uint64_t comment = masks.comment & outside & valid; comment != 0 )
+  {
+    // Everything from the comment onwards must be scanned by the parser
+    const int i = __builtin_ctzll(comment);
+    tokens &= (uint64_t(1) << i) - 1;
+    m_limit = _block + i;
+  }
+  const uint16_t offset = static_cast<uint16_t>(_block - m_window);
+  uint16_t* out = m_positions.data() + m_count;
+  m_count += __builtin_popcountll(tokens);
+  for ( ; tokens != 0; tokens &= tokens - 1 )
+    *out++ = offset + __builtin_ctzll(tokens);
+}
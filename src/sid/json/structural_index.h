@@ -0,0 +1,103 @@
+/*
+LICENSE: BEGIN
+===============================================================================
+@author Shan Anand
+@email anand.gs@gmail.com
+@source https://github.com/shan-anand
+@file structural_index.h
+@brief Stage 1 structural index for contiguous json input
+===============================================================================
+MIT License
+
+Copyright (c) 2017 Shanmuga (Anand) Gunasekaran
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+===============================================================================
+LICENSE: END
+*/
+
+/**
+ * @file  structural_index.h
+ * @brief Stage 1 structural index for contiguous json input
+ */
+#pragma once
+
+#include "simd.h"
+#include <vector>
+#include <cstdint>
+
+namespace sid::json {
+
+/**
+ * @struct structural_index
+ * @brief Records the position of every token that lies outside of strings using the vectorized
+ *        kernels of simd.h. A token is a structural character ({ } [ ] : ,), a double-quote
+ *        that opens or closes a string, or the first character of a scalar (number, literal).
+ *        The parser uses it to jump over whitespace and to find the end of strings without
+ *        looking at the bytes in between.
+ *        The input is indexed lazily in windows so that the index stays in the cache, even for
+ *        multi-GB inputs. Indexing stops at the first comment character found outside a string,
+ *        since the comment body cannot be classified. Positions beyond limit() are not indexed.
+ */
+struct structural_index
+{
+  //! Constructor
+  structural_index();
+
+  //! Start indexing the input [_first, _end)
+  void reset(const char* _first, const char* _end);
+  //! Disable the index. next() always fails after this call
+  void disable();
+
+  /**
+   * @fn next
+   * @brief Get the first token at or after _pos
+   * @param _pos Position to look from
+   * @param _token [out] Position of the token, or the end of input if there are none
+   * @return false if the index cannot answer, in which case the caller must scan the input
+   */
+  bool next(const char* _pos, const char*& _token);
+  //! Continue indexing from _pos, which is outside strings, if the parser moved beyond the
+  //! indexed input without using it
+  void skip_to(const char* _pos);
+
+  //! Positions at or beyond the limit are not indexed
+  const char* limit() const { return m_limit; }
+
+private:
+  //! Index the next window of input
+  void index_window();
+  //! Index a 64-byte block starting at _block (_p is the readable copy of the block)
+  void index_block(const char* _block, const char* _p, size_t _len);
+
+private:
+  const char*           m_first;     //! Beginning of input
+  const char*           m_end;       //! End of input
+  const char*           m_scanned;   //! Input before this position has been indexed
+  const char*           m_limit;     //! Input at or beyond this position is not indexed
+  const char*           m_window;    //! Beginning of the current window
+  std::vector<uint16_t> m_positions; //! Token offsets within the current window
+  size_t                m_count;     //! Number of tokens in the current window
+  size_t                m_cursor;    //! Current index within m_positions
+  uint64_t              m_inString;  //! All ones if the previous block ended inside a string
+  uint64_t              m_escaped;   //! 1 if the first byte of the next block is escaped
+  uint64_t              m_scalar;    //! 1 if the previous block ended with a scalar byte
+};
+
+} // namespace sid::json
@@ -32,8 +32,14 @@ LICENSE: END
 */
 
 #include "utils.h"
+#include "powers_of_five.h"
 #include <stdexcept>
 #include <limits>
+#include <charconv>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <cctype>
 
 using namespace sid;
 
@@ -42,128 +48,92 @@ std::string json::to_string(bool _value)
   return _value ? "true" : "false";
 }
 
+namespace sid::json::local {
+
+//! report a failed conversion. It is thrown only if the caller does not take the error.
+template <typename Error>
+bool conversion_error(const std::string& _what, std::string* _pstrError)
+{
+  if ( !_pstrError )
+    throw Error(_what);
+  *_pstrError = _what;
+  return false;
+}
+
+//! convert an integer without exceptions. Leading spaces and a + are skipped, like std::stoll.
+template <typename T>
+bool to_int(const std::string& _str, T& _out, std::string* _pstrError)
+{
+  const char* first = _str.data();
+  const char* last = first + _str.length();
+  while ( first < last && ::isspace(static_cast<unsigned char>(*first)) )
+    first++;
+  if ( last - first > 1 && first[0] == '+' && ::isdigit(static_cast<unsigned char>(first[1])) )
+    first++;
+  T val = 0;
+  const auto [ptr, ec] = std::from_chars(first, last, val);
+  if ( ec == std::errc::invalid_argument )
+    return conversion_error<std::invalid_argument>("Invalid argument: Not a number: " + _str, _pstrError);
+  if ( ec == std::errc::result_out_of_range )
+    return conversion_error<std::out_of_range>("Out of range: " + _str, _pstrError);
+  if ( ptr != last )
+    return conversion_error<std::invalid_argument>("Invalid argument: Extra characters found after number: "
+                                                   + std::string(ptr, last), _pstrError);
+  _out = val;
+  return true;
+}
+
+} // namespace sid::json::local
+
 bool json::to_bool(const std::string& _str)
 {
-  if (_str == "true")
-    return true;
-  else if (_str == "false")
-    return false;
-  throw std::invalid_argument("Invalid boolean string: " + _str);
+  bool out = false;
+  to_bool(_str, out);
+  return out;
 }
 
 bool json::to_bool(const std::string& _str, bool& _out, std::string* _pstrError/* = nullptr*/)
 {
-  try { _out = to_bool(_str); }
-  catch(const std::exception& _e)
-  {
-    if (_pstrError)
-      *_pstrError = _e.what();
-    return false;
-  }
+  if ( _str == "true" )
+    _out = true;
+  else if ( _str == "false" )
+    _out = false;
+  else
+    return local::conversion_error<std::invalid_argument>("Invalid boolean string: " + _str, _pstrError);
   return true;
 }
 
 bool json::to_num(const std::string& _str, uint32_t& _out, std::string* _pstrError/* = nullptr*/)
 {
-  try
-  {
-    size_t idx = 0;
-    unsigned long long val = std::stoul(_str, &idx);
-    if (idx != _str.length())
-      throw std::invalid_argument("Extra characters found after number: " + _str.substr(idx));
-    if (val > static_cast<unsigned long long>(std::numeric_limits<uint32_t>::max()))
-      throw std::out_of_range("Value out of range for uint32_t: " + _str);
-    _out = static_cast<uint32_t>(val);
-    return true;
-  }
-  catch (const std::invalid_argument& _e)
-  {
-    auto e = std::invalid_argument("Invalid argument: " + std::string(_e.what()));
-    if (!_pstrError) throw e;
-    *_pstrError = e.what();
-  }
-  catch (const std::out_of_range& _e)
-  {
-    auto e = std::out_of_range("Out of range: " + std::string(_e.what()));
-    if (!_pstrError) throw e;
-    *_pstrError = e.what();
-  }
-  return false;
+  return local::to_int(_str, _out, _pstrError);
 }
 
 bool json::to_num(const std::string& _str, long double& _out, std::string* _pstrError/* = nullptr*/)
 {
-  try
-  {
-    size_t idx = 0;
-    _out = std::stold(_str, &idx);
-    if (idx != _str.length())
-      throw std::invalid_argument("Extra characters found after number: " + _str.substr(idx));
-    return true;
-  }
-  catch (const std::invalid_argument& _e)
-  {
-    auto e = std::invalid_argument("Invalid argument: " + std::string(_e.what()));
-    if (!_pstrError) throw e;
-    *_pstrError = e.what();
-  }
-  catch (const std::out_of_range& _e)
-  {
-    auto e = std::out_of_range("Out of range: " + std::string(_e.what()));
-    if (!_pstrError) throw e;
-    *_pstrError = e.what();
-  }
-  return false;
+  // std::from_chars has no long double overload in every standard library
+  const char* first = _str.c_str();
+  char* end = nullptr;
+  errno = 0;
+  const long double val = ::strtold(first, &end);
+  if ( end == first )
+    return local::conversion_error<std::invalid_argument>("Invalid argument: Not a number: " + _str, _pstrError);
+  if ( errno == ERANGE )
+    return local::conversion_error<std::out_of_range>("Out of range: " + _str, _pstrError);
+  if ( end != first + _str.length() )
+    return local::conversion_error<std::invalid_argument>("Invalid argument: Extra characters found after number: "
+                                                          + std::string(end), _pstrError);
+  _out = val;
+  return true;
 }
 
 bool json::to_num(const std::string& _str, int64_t& _out, std::string* _pstrError/* = nullptr*/)
 {
-  try
-  {
-    size_t idx = 0;
-    _out = std::stoll(_str, &idx);
-    if (idx != _str.length())
-      throw std::invalid_argument("Extra characters found after number: " + _str.substr(idx));
-    return true;
-  }
-  catch (const std::invalid_argument& _e)
-  {
-    auto e = std::invalid_argument("Invalid argument: " + std::string(_e.what()));
-    if (!_pstrError) throw e;
-    *_pstrError = e.what();
-  }
-  catch (const std::out_of_range& _e)
-  {
-    auto e = std::out_of_range("Out of range: " + std::string(_e.what()));
-    if (!_pstrError) throw e;
-    *_pstrError = e.what();
-  }
-  return false;
+  return local::to_int(_str, _out, _pstrError);
 }
 
 bool json::to_num(const std::string& _str, uint64_t& _out, std::string* _pstrError/* = nullptr*/)
 {
-  try
-  {
-    size_t idx = 0;
-    _out = std::stoull(_str, &idx);
-    if (idx != _str.length())
-      throw std::invalid_argument("Extra characters found after number: " + _str.substr(idx));
-    return true;
-  }
-  catch (const std::invalid_argument& _e)
-  {
-    auto e = std::invalid_argument("Invalid argument: " + std::string(_e.what()));
-    if (!_pstrError) throw e;
-    *_pstrError = e.what();
-  }
-  catch (const std::out_of_range& _e)
-  {
-    auto e = std::out_of_range("Out of range: " + std::string(_e.what()));
-    if (!_pstrError) throw e;
-    *_pstrError = e.what();
-  }
-  return false;
+  return local::to_int(_str, _out, _pstrError);
 }
 
 std::string json::get_sep(size_t _number)
@@ -207,3 +177,290 @@ size_t json::split(
   }
   return _out.size();
 }
+
+namespace sid::json::local {
+
+inline bool is_digit(char _ch) { return static_cast<unsigned char>(_ch - '0') <= 9; }
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+//! Load 8 characters as a little endian word
+inline uint64_t load_eight(const char* _p)
+{
+  uint64_t v;
+  ::memcpy(&v, _p, sizeof(v));
+  return v;
+}
+
+//! Check whether all the 8 characters of the word are digits
+inline bool is_eight_digits(uint64_t _v)
+{
+  return ((_v & 0xF0F0F0F0F0F0F0F0) | (((_v + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) >> 4))
+         == 0x3333333333333333;
+}
+
+//! Convert 8 digits to their value with 3 multiplications
+inline uint32_t eight_digits(uint64_t _v)
+{
+  const uint64_t mask = 0x000000FF000000FF;
+  const uint64_t mul1 = 0x000F424000000064; // 100 + (1000000 << 32)
+  const uint64_t mul2 = 0x0000271000000001; // 1 + (10000 << 32)
+  _v -= 0x3030303030303030;
+  _v = (_v * 10) + (_v >> 8);
+  _v = (((_v & mask) * mul1) + (((_v >> 16) & mask) * mul2)) >> 32;
+  return static_cast<uint32_t>(_v);
+}
+#endif
+
+//! Accumulate the digits at _p into _mantissa. Wraps around on overflow, the caller counts digits.
+inline const char* accumulate_digits(const char* _p, const char* _last, uint64_t& _mantissa)
+{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  for ( uint64_t v; _last - _p >= 8 && is_eight_digits(v = load_eight(_p)); _p += 8 )
+    _mantissa = _mantissa * 100000000 + eight_digits(v);
+#endif
+  for ( ; _p < _last && is_digit(*_p); ++_p )
+    _mantissa = _mantissa * 10 + static_cast<uint64_t>(*_p - '0');
+  return _p;
+}
+
+//! Exact value of a 20 digit integer. Returns false if it does not fit in 64 bits.
+inline bool twenty_digits(const char* _p, uint64_t& _out)
+{
+  _out = 0;
+  for ( const char* last = _p + 20; _p < last; ++_p )
+    if ( __builtin_mul_overflow(_out, 10, &_out) ||
+         __builtin_add_overflow(_out, static_cast<uint64_t>(*_p - '0'), &_out) )
+      return false;
+  return true;
+}
+
+//! Powers of ten that are exactly representable as a double
+constexpr double exact_powers_of_ten[] = {
+  1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/**
+ * @brief Eisel-Lemire: correctly rounded _w * 10^_q as double bits (without the sign).
+ *        Returns false in the rare cases where the 128-bit approximation cannot decide.
+ */
+bool eisel_lemire(int64_t _q, uint64_t _w, uint64_t& _bits)
+{
+  constexpr int mantissa_bits = 52;
+  constexpr int minimum_exponent = -1023;
+  constexpr int infinite_power = 0x7FF;
+
+  if ( _q < smallest_power_of_five )
+  {
+    _bits = 0;
+    return true;
+  }
+  if ( _q > largest_power_of_five )
+  {
+    _bits = uint64_t(infinite_power) << mantissa_bits;
+    return true;
+  }
+  const int lz = __builtin_clzll(_w);
+  _w <<= lz;
+
+  // Multiply by the 128-bit approximation of 5^q, the second word is needed only when the
+  // bits below the mantissa in the upper product are all ones
+  const uint64_t* pow5 = powers_of_five[_q - smallest_power_of_five];
+  constexpr uint64_t precision_mask = uint64_t(0xFFFFFFFFFFFFFFFF) >> (mantissa_bits + 3);
+  __uint128_t first = static_cast<__uint128_t>(_w) * pow5[0];
+  uint64_t high = static_cast<uint64_t>(first >> 64), low = static_cast<uint64_t>(first);
+  if ( (high & precision_mask) == precision_mask )
+  {
+    const uint64_t second = static_cast<uint64_t>((static_cast<__uint128_t>(_w) * pow5[1]) >> 64);
+    low += second;
+    if ( second > low )
+      ++high;
+  }
+  // The product may still be off by one in the last bit outside of the exactly representable range
+  if ( low == 0xFFFFFFFFFFFFFFFF && (_q < -27 || _q > 55) )
+    return false;
+
+  const int upperbit = static_cast<int>(high >> 63);
+  const int shift = upperbit + 64 - mantissa_bits - 3;
+  uint64_t mantissa = high >> shift;
+  int power2 = static_cast<int>((((152170 + 65536) * _q) >> 16) + 63) + upperbit - lz - minimum_exponent;
+
+  if ( power2 <= 0 )
+  {
+    // Subnormal or zero
+    if ( -power2 + 1 >= 64 )
+    {
+      _bits = 0;
+      return true;
+    }
+    mantissa >>= -power2 + 1;
+    mantissa += (mantissa & 1);
+    mantissa >>= 1;
+    power2 = ( mantissa < (uint64_t(1) << mantissa_bits) ) ? 0 : 1;
+    _bits = (mantissa & ~(uint64_t(1) << mantissa_bits)) | (uint64_t(power2) << mantissa_bits);
+    return true;
+  }
+  // Exactly halfway between two doubles: round to even instead of up
+  if ( low <= 1 && _q >= -4 && _q <= 23 && (mantissa & 3) == 1 && (mantissa << shift) == high )
+    mantissa &= ~uint64_t(1);
+  mantissa += (mantissa & 1);
+  mantissa >>= 1;
+  if ( mantissa >= (uint64_t(2) << mantissa_bits) )
+  {
+    mantissa = (uint64_t(1) << mantissa_bits);
+    ++power2;
+  }
+  mantissa &= ~(uint64_t(1) << mantissa_bits);
+  if ( power2 >= infinite_power )
+  {
+    power2 = infinite_power;
+    mantissa = 0;
+  }
+  _bits = mantissa | (uint64_t(power2) << mantissa_bits);
+  return true;
+}
+
+} // namespace sid::json::local
+
+const char* json::decode_number(const char* _first, const char* _last, decoded_number& _out, number_error& _error)
+{
+  using namespace json::local;
+  const char* p = _first;
+  _error = number_error::none;
+
+  const bool negative = ( p < _last && *p == '-' );
+  if ( negative )
+    ++p;
+  if ( p == _last || !is_digit(*p) )
+  {
+    _error = number_error::missing_digit;
+    return p;
+  }
+
+  // Integer part
+  const char* const intBegin = p;
+  uint64_t mantissa = 0;
+  if ( *p == '0' )
+  {
+    if ( ++p < _last && is_digit(*p) )
+    {
+      _error = number_error::leading_zero;
+      return p;
+    }
+  }
+  else
+    p = accumulate_digits(p, _last, mantissa);
+  int64_t digits = p - intBegin;
+  int64_t exponent = 0;
+  bool isInteger = true;
+
+  // Fraction
+  if ( p < _last && *p == '.' )
+  {
+    isInteger = false;
+    const char* const fracBegin = ++p;
+    p = accumulate_digits(p, _last, mantissa);
+    if ( p == fracBegin )
+    {
+      _error = number_error::missing_fraction_digit;
+      return p;
+    }
+    exponent = -(p - fracBegin);
+    digits += p - fracBegin;
+  }
+  // Exponent
+  if ( p < _last && (*p == 'e' || *p == 'E') )
+  {
+    isInteger = false;
+    bool negativeExp = false;
+    if ( ++p < _last && (*p == '-' || *p == '+') )
+      negativeExp = (*p++ == '-');
+    const char* const expBegin = p;
+    int64_t expValue = 0;
+    for ( ; p < _last && is_digit(*p); ++p )
+      if ( expValue < 0x10000 )
+        expValue = expValue * 10 + (*p - '0');
+    if ( p == expBegin )
+    {
+      _error = number_error::missing_exponent_digit;
+      return p;
+    }
+    exponent += negativeExp ? -expValue : expValue;
+  }
+
+  if ( isInteger )
+  {
+    bool fits = ( digits <= 19 );
+    if ( digits == 20 )
+      fits = twenty_digits(intBegin, mantissa);
+    if ( fits && !negative )
+    {
+      _out.type = decoded_number::kind::unsigned_int;
+      _out.u64 = mantissa;
+      return p;
+    }
+    if ( fits && mantissa <= uint64_t(1) << 63 )
+    {
+      _out.type = decoded_number::kind::signed_int;
+      _out.i64 = static_cast<int64_t>(uint64_t(0) - mantissa);
+      return p;
+    }
+    // Too large for an integer, decode it as a double
+  }
+
+  _out.type = decoded_number::kind::real;
+  // Leading zeros of the fraction are not significant
+  if ( digits > 19 )
+    for ( const char* s = intBegin; s < p && (*s == '0' || *s == '.'); ++s )
+      digits -= (*s == '0');
+
+#ifndef SID_JSON_LONG_DOUBLE
+  // The fast paths round to a double, so they are not used for long double
+  if ( digits <= 19 )
+  {
+    // The mantissa is exact
+    if ( mantissa == 0 )
+    {
+      _out.dbl = negative ? -0.0 : 0.0;
+      return p;
+    }
+    if ( exponent >= -22 && exponent <= 22 && mantissa <= uint64_t(1) << 53 )
+    {
+      // Both the mantissa and the power of ten are exact, so a single operation rounds correctly
+      double d = static_cast<double>(mantissa);
+      d = ( exponent < 0 )? d / exact_powers_of_ten[-exponent] : d * exact_powers_of_ten[exponent];
+      _out.dbl = negative ? -d : d;
+      return p;
+    }
+    uint64_t bits = 0;
+    if ( eisel_lemire(exponent, mantissa, bits) )
+    {
+      if ( (bits >> 52) == 0x7FF )
+      {
+        _error = number_error::out_of_range;
+        return p;
+      }
+      if ( negative )
+        bits |= uint64_t(1) << 63;
+      ::memcpy(&_out.dbl, &bits, sizeof(bits));
+      return p;
+    }
+  }
+#endif
+
+  // Too many digits, or too close to call: use the exact conversion of the standard library
+  real_t d = 0.0;
+  const std::from_chars_result res = std::from_chars(_first, p, d);
+  if ( res.ec == std::errc::result_out_of_range )
+  {
+    // Underflows to zero, overflows are errors
+    if ( exponent + digits > 0 )
+    {
+      _error = number_error::out_of_range;
+      return p;
+    }
+    d = negative ? -0.0 : 0.0;
+  }
+  _out.dbl = d;
+  return p;
+}
@@ -35,6 +35,7 @@ LICENSE: END
 
 #include <string>
 #include <cstdint>
+#include <cstring>
 #include <vector>
 
 #define SPLIT_TRIM          0x01
@@ -58,17 +59,206 @@ size_t split(
   const uint32_t            _options = 0
 );
 
-//! Number information structure
-struct number_info
+//! Floating point type of the decoded numbers, which is the one the values store (value::number_t)
+#ifdef SID_JSON_LONG_DOUBLE
+using real_t = long double;
+#else
+using real_t = double;
+#endif
+
+//! Number decoded by decode_number
+struct decoded_number
 {
-  struct s_integer
+  enum class kind : uint8_t { signed_int, unsigned_int, real };
+  kind type = kind::unsigned_int;
+  union
   {
-    bool     negative = false;
-    uint64_t digits = 0;
+    int64_t  i64;
+    uint64_t u64;
+    real_t   dbl;
   };
-  s_integer integer;
-  bool hasFraction = false;
-  bool hasExponent = false;
+  decoded_number() : u64(0) {}
+};
+
+//! Errors reported by decode_number
+enum class number_error : uint8_t
+{
+  none,
+  missing_digit,          //! No digit after the optional minus sign
+  leading_zero,           //! A digit follows the leading 0
+  missing_fraction_digit, //! No digit after the decimal point
+  missing_exponent_digit, //! No digit in the exponent
+  out_of_range            //! The magnitude is too large for a real_t
 };
 
+/**
+ * @fn decode_number
+ * @brief decode the json number at the start of [_first, _last) without allocating or throwing.
+ *        Integers that fit are returned as signed (when negative) or unsigned integers, all others
+ *        as the correctly rounded real_t.
+ * @param _first beginning of the number
+ * @param _last end of the input
+ * @param _out decoded number
+ * @param _error set to the failure reason, number_error::none on success
+ * @return pointer past the number, or to the offending character if _error is set
+ */
+const char* decode_number(const char* _first, const char* _last, decoded_number& _out, number_error& _error);
+
+//! Value of 4 hexadecimal digits, or -1 if one of them is not a hexadecimal digit
+inline int32_t decode_hex4(const char* _p)
+{
+  int32_t value = 0;
+  for ( int i = 0; i < 4; i++ )
+  {
+    const char ch = _p[i];
+    int32_t digit;
+    if ( ch >= '0' && ch <= '9' )
+      digit = ch - '0';
+    else if ( ( ch | 0x20 ) >= 'a' && ( ch | 0x20 ) <= 'f' )
+      digit = ( ch | 0x20 ) - 'a' + 10;
+    else
+      return -1;
+    value = ( value << 4 ) | digit;
+  }
+  return value;
+}
+
+//! Surrogate code points that a \u escape can have
+inline bool is_high_surrogate(uint32_t _cp) { return _cp >= 0xD800 && _cp <= 0xDBFF; }
+inline bool is_low_surrogate(uint32_t _cp) { return _cp >= 0xDC00 && _cp <= 0xDFFF; }
+
+//! Code point of a surrogate pair
+inline uint32_t join_surrogates(uint32_t _high, uint32_t _low)
+{
+  return 0x10000 + ( ( _high - 0xD800 ) << 10 ) + ( _low - 0xDC00 );
+}
+
+//! append a code point as UTF-8
+inline void append_utf8(std::string& _str, uint32_t _cp)
+{
+  if ( _cp < 0x80 )
+    _str += static_cast<char>(_cp);
+  else if ( _cp < 0x800 )
+  {
+    const char bytes[2] = { static_cast<char>(0xC0 | (_cp >> 6)), static_cast<char>(0x80 | (_cp & 0x3F)) };
+    _str.append(bytes, 2);
+  }
+  else if ( _cp < 0x10000 )
+  {
+    const char bytes[3] = { static_cast<char>(0xE0 | (_cp >> 12)), static_cast<char>(0x80 | ((_cp >> 6) & 0x3F)),
+                            static_cast<char>(0x80 | (_cp & 0x3F)) };
+    _str.append(bytes, 3);
+  }
+  else
+  {
+    const char bytes[4] = { static_cast<char>(0xF0 | (_cp >> 18)), static_cast<char>(0x80 | ((_cp >> 12) & 0x3F)),
+                            static_cast<char>(0x80 | ((_cp >> 6) & 0x3F)), static_cast<char>(0x80 | (_cp & 0x3F)) };
+    _str.append(bytes, 4);
+  }
+}
+
+/**
+ * @fn decode_utf8
+ * @brief decode the UTF-8 sequence at the start of [_first, _last). Overlong forms, surrogates
+ *        and code points above U+10FFFF are invalid.
+ * @param _first beginning of the sequence
+ * @param _last end of the input
+ * @param _cp set to the code point
+ * @return pointer past the sequence, or nullptr if it is invalid or incomplete
+ */
+inline const char* decode_utf8(const char* _first, const char* _last, uint32_t& _cp)
+{
+  const uint8_t lead = static_cast<uint8_t>(*_first);
+  int count;
+  uint32_t min;
+  if ( lead < 0x80 )      { _cp = lead; return _first + 1; }
+  else if ( lead < 0xC2 ) return nullptr; // A continuation byte, or an overlong 2 byte form
+  else if ( lead < 0xE0 ) { count = 1; min = 0x80; _cp = lead & 0x1F; }
+  else if ( lead < 0xF0 ) { count = 2; min = 0x800; _cp = lead & 0x0F; }
+  else if ( lead < 0xF5 ) { count = 3; min = 0x10000; _cp = lead & 0x07; }
+  else return nullptr;
+  if ( _last - _first <= count )
+    return nullptr;
+  for ( int i = 1; i <= count; i++ )
+  {
+    const uint8_t ch = static_cast<uint8_t>(_first[i]);
+    if ( ( ch & 0xC0 ) != 0x80 )
+      return nullptr;
+    _cp = ( _cp << 6 ) | ( ch & 0x3F );
+  }
+  if ( _cp < min || _cp > 0x10FFFF || ( _cp >= 0xD800 && _cp <= 0xDFFF ) )
+    return nullptr;
+  return _first + count + 1;
+}
+
+//! Literals recognized by match_literal
+enum class literal : uint8_t { none, null_value, true_value, false_value };
+
+//! Load 4 characters as a word in memory order. Compiles to a single load.
+inline uint32_t load_four(const char* _p)
+{
+  uint32_t v;
+  ::memcpy(&v, _p, sizeof(v));
+  return v;
+}
+
+//! Word of 4 characters in memory order, the same as load_four() of the characters
+constexpr uint32_t four_chars(char _a, char _b, char _c, char _d)
+{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  return uint32_t(uint8_t(_a)) << 24 | uint32_t(uint8_t(_b)) << 16 | uint32_t(uint8_t(_c)) << 8 | uint8_t(_d);
+#else
+  return uint32_t(uint8_t(_a)) | uint32_t(uint8_t(_b)) << 8 | uint32_t(uint8_t(_c)) << 16 | uint32_t(uint8_t(_d)) << 24;
+#endif
+}
+
+/**
+ * @fn match_literal
+ * @brief match true, false or null at the start of [_first, _last) with a single 4 character
+ *        compare. With _nocase, the capitalized (True) and upper case (TRUE) forms are accepted too.
+ *        Letters are folded to lower case by setting bit 0x20 of every byte. The bits that were
+ *        already set tell which case each letter had.
+ * @param _first beginning of the input
+ * @param _last end of the input
+ * @param _nocase accept the capitalized and upper case forms
+ * @param _next set to the position after the literal
+ * @return the literal, or literal::none if there is none or not enough input to tell
+ */
+inline literal match_literal(const char* _first, const char* _last, bool _nocase, const char*& _next)
+{
+  constexpr uint32_t fold = four_chars(' ', ' ', ' ', ' ');
+  constexpr uint32_t lower = fold, capitalized = four_chars('\0', ' ', ' ', ' '), upper = 0;
+  constexpr uint32_t wTrue = four_chars('t', 'r', 'u', 'e'), wNull = four_chars('n', 'u', 'l', 'l');
+  constexpr uint32_t wAlse = four_chars('a', 'l', 's', 'e');
+
+  if ( _last - _first < 4 )
+    return literal::none;
+  const char ch = _first[0] | 0x20;
+  if ( ch == 't' || ch == 'n' )
+  {
+    const uint32_t w = load_four(_first);
+    if ( (w | fold) != (ch == 't'? wTrue : wNull) )
+      return literal::none;
+    const uint32_t cases = w & fold;
+    if ( cases != lower && !(_nocase && (cases == capitalized || cases == upper)) )
+      return literal::none;
+    _next = _first + 4;
+    return ( ch == 't' )? literal::true_value : literal::null_value;
+  }
+  if ( ch == 'f' && _last - _first >= 5 )
+  {
+    const uint32_t w = load_four(_first + 1);
+    if ( (w | fold) != wAlse )
+      return literal::none;
+    // f is followed by alse, F by alse or ALSE
+    const uint32_t cases = w & fold;
+    const bool firstLower = ( _first[0] == 'f' );
+    if ( !( (firstLower && cases == lower) || (_nocase && !firstLower && (cases == lower || cases == upper)) ) )
+      return literal::none;
+    _next = _first + 5;
+    return literal::false_value;
+  }
+  return literal::none;
+}
+
 } // namespace sid::json
@@ -38,10 +38,16 @@ LICENSE: END
  */
 #include "json/value.h"
 #include "json/schema.h"
+#include "json/lazy_document.h"
 #include "utils.h"
+#include "simd.h"
 #include "parser_io.h"
 #include "parser.h"
+#include "parallel_parser.h"
 #include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <new>
 #include <stack>
 #include <iomanip>
 #include <ctime>
@@ -79,6 +85,28 @@ void value::parse_file(
   parser.parse();
 }
 
+/**
+ * @fn parse_file
+ * @brief parse json file with several threads. If the root is an array, its elements are split
+ *        among the threads.
+ * @param _out output data
+ * @param _filePath input json file
+ * @param _threads number of threads (0 for one per core)
+ * @param _ctrl parser control flags
+ * @throws std::exception if parsing fails
+ */
+//static
+void value::parse_file(
+  parser_output&        _out,
+  const std::string&    _filePath,
+  const uint32_t        _threads,
+  const parser_control& _ctrl // = parser_control()
+)
+{
+  parallel_array_parser parser(_filePath, _threads, _ctrl);
+  parser.parse(_out);
+}
+
 /**
  * @fn parse
  * @brief parse json string data
@@ -137,67 +165,564 @@ void value::parse(
   parse(_out, *_in.rdbuf(), _ctrl);  
 }
 
+/**
+ * @fn parse_file
+ * @brief parse a json file of multiple documents (like JSON Lines or RFC 7464 json-seq)
+ * @param _out output data. It is reused for every document.
+ * @param _filePath input json file
+ * @param _handler called after each document is parsed
+ * @param _ctrl parser control flags
+ * @return statistics of all the documents
+ * @throws std::exception if parsing fails
+ */
+//static
+parser_stats value::parse_file(
+  parser_output&          _out,
+  const std::string&      _filePath,
+  const document_handler& _handler,
+  const parser_control&   _ctrl // = parser_control()
+)
+{
+  char_parser_input in(_filePath, input_type::file_path, _ctrl);
+  char_parser parser(in, _out);
+  return parser.parse_documents(_handler);
+}
+
+/**
+ * @fn parse_file
+ * @brief parse a file of line-delimited documents (like JSON Lines) with several threads
+ * @param _filePath input json file
+ * @param _threads number of threads (0 for one per core)
+ * @param _handler called after each document is parsed, with the line the document ends on
+ * @param _ordered call the handler in input order, from one thread at a time
+ * @param _ctrl parser control flags
+ * @return statistics of all the documents
+ * @throws std::exception if parsing fails. It is the first error in input order.
+ */
+//static
+parser_stats value::parse_file(
+  const std::string&              _filePath,
+  const uint32_t                  _threads,
+  const indexed_document_handler& _handler,
+  const bool                      _ordered, // = true
+  const parser_control&           _ctrl // = parser_control()
+)
+{
+  parallel_parser parser(_filePath, _threads, _handler, _ordered, _ctrl);
+  return parser.parse();
+}
+
+/**
+ * @fn parse
+ * @brief parse json string data of multiple documents
+ * @param _out output data. It is reused for every document.
+ * @param _in input string data
+ * @param _handler called after each document is parsed
+ * @param _ctrl parser control flags
+ * @return statistics of all the documents
+ * @throws std::exception if parsing fails
+ */
+//static
+parser_stats value::parse(
+  parser_output&          _out,
+  const std::string&      _in,
+  const document_handler& _handler,
+  const parser_control&   _ctrl // = parser_control()
+)
+{
+  char_parser_input in(_in, input_type::data, _ctrl);
+  char_parser parser(in, _out);
+  return parser.parse_documents(_handler);
+}
+
+/**
+ * @fn parse
+ * @brief parse json stream buffer of multiple documents
+ * @param _out output data. It is reused for every document.
+ * @param _in stream buffer input
+ * @param _handler called after each document is parsed
+ * @param _ctrl parser control flags
+ * @return statistics of all the documents
+ * @throws std::exception if parsing fails
+ */
+//static
+parser_stats value::parse(
+  parser_output&          _out,
+  std::streambuf&         _in,
+  const document_handler& _handler,
+  const parser_control&   _ctrl // = parser_control()
+)
+{
+  buffer_parser_input in(_in, _ctrl);
+  buffer_parser parser(in, _out);
+  return parser.parse_documents(_handler);
+}
+
+/**
+ * @fn parse
+ * @brief parse json input stream of multiple documents
+ * @param _out output data. It is reused for every document.
+ * @param _in input stream
+ * @param _handler called after each document is parsed
+ * @param _ctrl parser control flags
+ * @return statistics of all the documents
+ * @throws std::exception if parsing fails
+ */
+//static
+parser_stats value::parse(
+  parser_output&          _out,
+  std::istream&           _in,
+  const document_handler& _handler,
+  const parser_control&   _ctrl // = parser_control()
+)
+{
+  return parse(_out, *_in.rdbuf(), _handler, _ctrl);
+}
+
+/**
+ * @fn parse_file
+ * @brief map a json file without decoding it
+ * @param _doc output document
+ * @param _filePath input json file
+ * @param _ctrl parser control flags
+ * @throws std::exception if parsing fails
+ */
+//static
+void value::parse_file(
+  lazy_document&        _doc,
+  const std::string&    _filePath,
+  const parser_control& _ctrl // = parser_control()
+)
+{
+  _doc.open(_filePath, _ctrl);
+}
+
+/**
+ * @fn parse
+ * @brief parse only the values of some paths of json string data
+ * @param _out output data
+ * @param _in input string data
+ * @param _paths JSON Pointers of the values
+ * @param _ctrl parser control flags
+ * @throws std::exception if parsing fails or if a path is invalid
+ */
+//static
+void value::parse(
+  parser_output&                  _out,
+  const std::string&              _in,
+  const std::vector<std::string>& _paths,
+  const parser_control&           _ctrl // = parser_control()
+)
+{
+  path_filter filter(_paths);
+  char_parser_input in(_in, input_type::data, _ctrl);
+  char_parser parser(in, _out);
+  parser.parse_paths(filter);
+}
+
+/**
+ * @fn parse_file
+ * @brief parse only the values of some paths of a json file
+ * @param _out output data
+ * @param _filePath input json file
+ * @param _paths JSON Pointers of the values
+ * @param _ctrl parser control flags
+ * @throws std::exception if parsing fails or if a path is invalid
+ */
+//static
+void value::parse_file(
+  parser_output&                  _out,
+  const std::string&              _filePath,
+  const std::vector<std::string>& _paths,
+  const parser_control&           _ctrl // = parser_control()
+)
+{
+  path_filter filter(_paths);
+  char_parser_input in(_filePath, input_type::file_path, _ctrl);
+  char_parser parser(in, _out);
+  parser.parse_paths(filter);
+}
+
+/**
+ * @fn parse
+ * @brief parse only the values of some paths of a json stream buffer
+ * @param _out output data
+ * @param _in stream buffer input
+ * @param _paths JSON Pointers of the values
+ * @param _ctrl parser control flags
+ * @throws std::exception if parsing fails or if a path is invalid
+ */
+//static
+void value::parse(
+  parser_output&                  _out,
+  std::streambuf&                 _in,
+  const std::vector<std::string>& _paths,
+  const parser_control&           _ctrl // = parser_control()
+)
+{
+  path_filter filter(_paths);
+  buffer_parser_input in(_in, _ctrl);
+  buffer_parser parser(in, _out);
+  parser.parse_paths(filter);
+}
+
+/**
+ * @fn parse
+ * @brief parse only the values of some paths of a json input stream
+ * @param _out output data
+ * @param _in input stream
+ * @param _paths JSON Pointers of the values
+ * @param _ctrl parser control flags
+ * @throws std::exception if parsing fails or if a path is invalid
+ */
+//static
+void value::parse(
+  parser_output&                  _out,
+  std::istream&                   _in,
+  const std::vector<std::string>& _paths,
+  const parser_control&           _ctrl // = parser_control()
+)
+{
+  parse(_out, *_in.rdbuf(), _paths, _ctrl);
+}
+
+/**
+ * @fn parse
+ * @brief parse json string data and validate it against a schema
+ * @param _out output data
+ * @param _in input string data
+ * @param _schema schema to validate against
+ * @param _ctrl parser control flags
+ * @throws std::exception if parsing fails or if the data does not match the schema
+ */
+//static
+void value::parse(
+  parser_output&        _out,
+  const std::string&    _in,
+  const schema&         _schema,
+  const parser_control& _ctrl // = parser_control()
+)
+{
+  char_parser_input in(_in, input_type::data, _ctrl);
+  char_parser parser(in, _out);
+  parser.m_schema = &_schema;
+  parser.parse();
+}
+
+/**
+ * @fn parse_file
+ * @brief parse a json file and validate it against a schema
+ * @param _out output data
+ * @param _filePath input json file
+ * @param _schema schema to validate against
+ * @param _ctrl parser control flags
+ * @throws std::exception if parsing fails or if the data does not match the schema
+ */
+//static
+void value::parse_file(
+  parser_output&        _out,
+  const std::string&    _filePath,
+  const schema&         _schema,
+  const parser_control& _ctrl // = parser_control()
+)
+{
+  char_parser_input in(_filePath, input_type::file_path, _ctrl);
+  char_parser parser(in, _out);
+  parser.m_schema = &_schema;
+  parser.parse();
+}
+
+/**
+ * @fn parse
+ * @brief parse a json stream buffer and validate it against a schema
+ * @param _out output data
+ * @param _in stream buffer input
+ * @param _schema schema to validate against
+ * @param _ctrl parser control flags
+ * @throws std::exception if parsing fails or if the data does not match the schema
+ */
+//static
+void value::parse(
+  parser_output&        _out,
+  std::streambuf&       _in,
+  const schema&         _schema,
+  const parser_control& _ctrl // = parser_control()
+)
+{
+  buffer_parser_input in(_in, _ctrl);
+  buffer_parser parser(in, _out);
+  parser.m_schema = &_schema;
+  parser.parse();
+}
+
+/**
+ * @fn parse
+ * @brief parse a json input stream and validate it against a schema
+ * @param _out output data
+ * @param _in input stream
+ * @param _schema schema to validate against
+ * @param _ctrl parser control flags
+ * @throws std::exception if parsing fails or if the data does not match the schema
+ */
+//static
+void value::parse(
+  parser_output&        _out,
+  std::istream&         _in,
+  const schema&         _schema,
+  const parser_control& _ctrl // = parser_control()
+)
+{
+  parse(_out, *_in.rdbuf(), _schema, _ctrl);
+}
+
+/**
+ * @fn try_parse
+ * @brief parse json string data without throwing for malformed data
+ * @param _out output data. It is partially filled if parsing fails.
+ * @param _in input string data
+ * @param _ctrl parser control flags
+ * @return the first error, which is false if there is none
+ */
+//static
+parse_error value::try_parse(
+  parser_output&        _out,
+  const std::string&    _in,
+  const parser_control& _ctrl // = parser_control()
+)
+{
+  char_parser_input in(_in, input_type::data, _ctrl);
+  char_parser parser(in, _out);
+  return parser.try_parse();
+}
+
+/**
+ * @fn try_parse
+ * @brief parse json stream buffer without throwing for malformed data
+ * @param _out output data. It is partially filled if parsing fails.
+ * @param _in stream buffer input
+ * @param _ctrl parser control flags
+ * @return the first error, which is false if there is none
+ */
+//static
+parse_error value::try_parse(
+  parser_output&        _out,
+  std::streambuf&       _in,
+  const parser_control& _ctrl // = parser_control()
+)
+{
+  buffer_parser_input in(_in, _ctrl);
+  buffer_parser parser(in, _out);
+  return parser.try_parse();
+}
+
+/**
+ * @fn try_parse
+ * @brief parse json string data and validate it against a schema without throwing
+ * @param _out output data. It is partially filled if parsing fails.
+ * @param _in input string data
+ * @param _schema schema to validate against
+ * @param _ctrl parser control flags
+ * @return the first error, which is false if there is none
+ */
+//static
+parse_error value::try_parse(
+  parser_output&        _out,
+  const std::string&    _in,
+  const schema&         _schema,
+  const parser_control& _ctrl // = parser_control()
+)
+{
+  char_parser_input in(_in, input_type::data, _ctrl);
+  char_parser parser(in, _out);
+  parser.m_schema = &_schema;
+  return parser.try_parse();
+}
+
+/**
+ * @fn parse
+ * @brief parse json string data, calling the handler for every event
+ * @param _handler receives the events
+ * @param _in input string data
+ * @param _ctrl parser control flags
+ * @return statistics of the parsing
+ * @throws std::exception if parsing fails
+ */
+//static
+parser_stats value::parse(
+  sax_handler&          _handler,
+  const std::string&    _in,
+  const parser_control& _ctrl // = parser_control()
+)
+{
+  parser_output out;
+  char_parser_input in(_in, input_type::data, _ctrl);
+  char_parser parser(in, out);
+  return parser.parse_events(_handler);
+}
+
+/**
+ * @fn parse_file
+ * @brief parse json file, calling the handler for every event
+ * @param _handler receives the events
+ * @param _filePath input json file
+ * @param _ctrl parser control flags
+ * @return statistics of the parsing
+ * @throws std::exception if parsing fails
+ */
+//static
+parser_stats value::parse_file(
+  sax_handler&          _handler,
+  const std::string&    _filePath,
+  const parser_control& _ctrl // = parser_control()
+)
+{
+  parser_output out;
+  char_parser_input in(_filePath, input_type::file_path, _ctrl);
+  char_parser parser(in, out);
+  return parser.parse_events(_handler);
+}
+
+/**
+ * @fn parse
+ * @brief parse json stream buffer, calling the handler for every event
+ * @param _handler receives the events
+ * @param _in stream buffer input
+ * @param _ctrl parser control flags
+ * @return statistics of the parsing
+ * @throws std::exception if parsing fails
+ */
+//static
+parser_stats value::parse(
+  sax_handler&          _handler,
+  std::streambuf&       _in,
+  const parser_control& _ctrl // = parser_control()
+)
+{
+  parser_output out;
+  buffer_parser_input in(_in, _ctrl);
+  buffer_parser parser(in, out);
+  return parser.parse_events(_handler);
+}
+
+/**
+ * @fn parse
+ * @brief parse json input stream, calling the handler for every event
+ * @param _handler receives the events
+ * @param _in input stream
+ * @param _ctrl parser control flags
+ * @return statistics of the parsing
+ * @throws std::exception if parsing fails
+ */
+//static
+parser_stats value::parse(
+  sax_handler&          _handler,
+  std::istream&         _in,
+  const parser_control& _ctrl // = parser_control()
+)
+{
+  return parse(_handler, *_in.rdbuf(), _ctrl);
+}
+
 
 void value::init(const value_type _type/* = value_type::null*/)
 {
-  m_type = m_data.init(_type);
+  m_size = 0;
+  switch ( _type )
+  {
+  case value_type::null:      break;
+  case value_type::string:    break;
+  case value_type::_signed:   m_data._i64 = 0; break;
+  case value_type::_unsigned: m_data._u64 = 0; break;
+  case value_type::_double:   m_data._dbl = 0; break;
+  case value_type::boolean:   m_data._bval = false; break;
+  case value_type::array:     m_data._arr = new array_t; break;
+  case value_type::object:    new (&m_data._map) object_t; break;
+  }
+  m_type = _type;
+}
+
+void value::init(const value_type _type, const object_layout _layout, arena& _arena)
+{
+  if ( _type == value_type::array )
+    m_data._arr = new (_arena.allocate(sizeof(array_t), alignof(array_t))) array_t(&_arena);
+  else
+    new (&m_data._map) object_t(_layout, &_arena);
+  m_size = arena_flag;
+  m_type = _type;
 }
 
 value::value(const value_type _type/* = value_type::null*/)
+  : m_size(0), m_type(value_type::null)
 {
-  m_type = m_data.init(_type);
+  static_assert(sizeof(value) == sizeof(union_data) + short_tail + 2, "value must not have padding");
+  init(_type);
 }
 
 value::value(const value& _obj)
+  : m_size(0), m_type(value_type::null)
 {
-  m_type = m_data.init(_obj.m_data, true, _obj.m_type);
+  copy_from(_obj);
 }
 
 // Move constructor
 value::value(value&& _obj) noexcept
+  : m_size(0), m_type(value_type::null)
 {
-  m_type = m_data.init(std::move(_obj.m_data), _obj.m_type);
-  _obj.m_type = value_type::null;
+  move_from(_obj);
 }
 
 value::value(const int64_t _val)
+  : m_size(0), m_type(value_type::_signed)
 {
-  m_type = m_data.init(_val);
+  m_data._i64 = _val;
 }
 
 value::value(const uint64_t _val)
+  : m_size(0), m_type(value_type::_unsigned)
 {
-  m_type = m_data.init(_val);
+  m_data._u64 = _val;
 }
 
 value::value(const double _val)
+  : m_size(0), m_type(value_type::_double)
 {
-  m_type = m_data.init(static_cast<long double>(_val));
+  m_data._dbl = _val;
 }
 
 value::value(const long double _val)
+  : m_size(0), m_type(value_type::_double)
 {
-  m_type = m_data.init(_val);
+  m_data._dbl = static_cast<number_t>(_val);
 }
 
 value::value(const bool _val)
+  : m_size(0), m_type(value_type::boolean)
 {
-  m_type = m_data.init(_val);
+  m_data._bval = _val;
 }
 
 value::value(const std::string& _val)
+  : m_size(0), m_type(value_type::null)
+{
+  init_str(_val);
+}
+
+value::value(std::string&& _val)
+  : m_size(0), m_type(value_type::null)
 {
-  m_type = m_data.init(_val);
+  move_str(std::move(_val));
 }
 
 value::value(const char* _val)
+  : m_size(0), m_type(value_type::null)
 {
-  m_type = m_data.init(_val);
+  if ( _val != nullptr )
+    init_str(_val);
 }
 
 value::value(const int _val)
+  : value(static_cast<int64_t>(_val))
 {
-  m_type = m_data.init(_val);
 }
 
 value::~value()
@@ -207,29 +732,130 @@ value::~value()
 
 void value::clear()
 {
-  m_type = m_data.clear(m_type);
+  switch ( m_type )
+  {
+  case value_type::string:
+    if ( m_size == long_size )
+      delete m_data._str;
+    break;
+  case value_type::array:
+    // A container of an arena is freed with the arena. Its children are visited only if it
+    // was changed.
+    if ( m_size == 0 )
+      delete m_data._arr;
+    else if ( m_size & changed_flag )
+      m_data._arr->~array_t();
+    break;
+  case value_type::object:
+    if ( m_size != arena_flag )
+      m_data._map.~object_t();
+    break;
+  default: break;
+  }
+  m_size = 0;
+  m_type = value_type::null;
+}
+
+void value::init_str(const std::string_view _val)
+{
+  if ( _val.size() <= short_capacity )
+  {
+    ::memcpy(short_str(), _val.data(), _val.size());
+    m_size = static_cast<uint8_t>(_val.size());
+  }
+  else
+  {
+    m_data._str = new std::string(_val);
+    m_size = long_size;
+  }
+  m_type = value_type::string;
+}
+
+void value::move_str(std::string&& _val)
+{
+  if ( _val.size() <= short_capacity )
+    return init_str(_val);
+  m_data._str = new std::string(std::move(_val));
+  m_size = long_size;
+  m_type = value_type::string;
+}
+
+void value::init_str(const std::string_view _val, arena& _arena)
+{
+  if ( _val.size() <= short_capacity || _val.size() > UINT32_MAX )
+    return init_str(_val);
+  char* chars = static_cast<char*>(_arena.allocate(_val.size(), 1));
+  ::memcpy(chars, _val.data(), _val.size());
+  const uint32_t size = static_cast<uint32_t>(_val.size());
+  ::memcpy(m_chars, &size, sizeof(size));
+  m_data._chars = chars;
+  m_size = arena_size;
+  m_type = value_type::string;
+}
+
+void value::copy_from(const value& _obj)
+{
+  // A copy of the storage of an arena is allocated from the heap
+  switch ( _obj.m_type )
+  {
+  case value_type::string: init_str(_obj.str_view()); return;
+  case value_type::array:  m_data._arr = new array_t(*_obj.m_data._arr); m_size = 0; break;
+  case value_type::object: new (&m_data._map) object_t(_obj.m_data._map); m_size = 0; break;
+  default:                 ::memcpy(static_cast<void*>(&m_data), &_obj.m_data, sizeof(m_data)); break;
+  }
+  m_type = _obj.m_type;
+}
+
+void value::move_from(value& _obj) noexcept
+{
+  // The storage out of line changes hands. A short string is copied with the rest of the value,
+  // and an object is only a pointer to its members.
+  ::memcpy(static_cast<void*>(&m_data), &_obj.m_data, sizeof(m_data));
+  ::memcpy(m_chars, _obj.m_chars, sizeof(m_chars));
+  m_size = _obj.m_size;
+  m_type = _obj.m_type;
+  _obj.m_type = value_type::null;
 }
 
 value& value::operator=(const value& _obj)
 {
-  const bool is_new = ( m_type != _obj.m_type || m_type != value_type::object );
-  if ( is_new )
+  if ( m_type == value_type::object && _obj.m_type == value_type::object )
+  {
+    // The copy is on the heap, even if this object was in an arena
+    m_data._map = _obj.m_data._map;
+    m_size = 0;
+    return *this;
+  }
+  this->clear();
+  copy_from(_obj);
+  return *this;
+}
+
+value& value::operator=(value&& _obj) noexcept
+{
+  if ( this != &_obj )
+  {
+    // _obj may be a child of this value. So, take it out before clearing.
+    value tmp(std::move(_obj));
     this->clear();
-  m_type = m_data.init(_obj.m_data, is_new, _obj.m_type);
+    move_from(tmp);
+  }
   return *this;
 }
 
 value& value::operator=(const int64_t _val)
 {
   this->clear();
-  m_type = m_data.init(_val);
+  m_data._i64 = _val;
+  m_type = value_type::_signed;
   return *this;
 }
 
 value& value::operator=(const uint64_t _val)
 {
   this->clear();
-  m_type = m_data.init(_val);
+  m_data._u64 = _val;
+  m_type = value_type::_unsigned;
   return *this;
 }
 
@@ -241,21 +867,30 @@ value& value::operator=(const double _val)
 value& value::operator=(const long double _val)
 {
   this->clear();
-  m_type = m_data.init(_val);
+  m_data._dbl = static_cast<number_t>(_val);
+  m_type = value_type::_double;
   return *this;
 }
 
 value& value::operator=(const bool _val)
 {
   this->clear();
-  m_type = m_data.init(_val);
+  m_data._bval = _val;
+  m_type = value_type::boolean;
   return *this;
 }
 
 value& value::operator=(const std::string& _val)
 {
   this->clear();
-  m_type = m_data.init(_val);
+  init_str(_val);
+  return *this;
+}
+
+value& value::operator=(std::string&& _val)
+{
+  this->clear();
+  move_str(std::move(_val));
   return *this;
 }
 
@@ -263,9 +898,7 @@ value& value::operator=(const char* _val)
 {
   this->clear();
   if ( _val != nullptr )
-    m_type = m_data.init(std::string(_val));
-  else
-    m_type = m_data.init(value_type::null);
+    init_str(_val);
   return *this;
 }
 
@@ -278,7 +911,7 @@ bool value::has_index(const size_t _index) const
 {
   if ( ! is_array() )
     throw std::runtime_error(__func__ + std::string("() can be used only for array type"));
-  return ( _index < m_data._arr.size() );
+  return ( _index < m_data._arr->size() );
 }
 
 bool value::has_key(const std::string& _key) const
@@ -291,7 +924,7 @@ bool value::has_key(const std::string& _key, value& _obj) const
 {
   if ( ! is_object() )
     throw std::runtime_error(__func__ + std::string("() can be used only for object type. ") + _key);
-  if ( auto it = m_data.map().find(_key); it != m_data.map().end() )
+  if ( auto it = m_data._map.find(_key); it != m_data._map.end() )
   {
     _obj = it->second;
     return true;
@@ -304,35 +937,32 @@ std::vector<std::string> value::get_keys() const
   if ( ! is_object() )
     throw std::runtime_error(__func__ + std::string("() can be used only for object type"));
   std::vector<std::string> keys;
-  for ( const auto& entry : m_data.map() )
-    keys.push_back(entry.first);
+  keys.reserve(m_data._map.size());
+  for ( const auto& entry : m_data._map )
+    keys.emplace_back(entry.first.view());
   return keys;
 }
 
 size_t value::size() const
 {
   if ( is_array() )
-    return m_data._arr.size();
+    return m_data._arr->size();
   else if ( is_object() )
-    return m_data.map().size();
+    return m_data._map.size();
   throw std::runtime_error(__func__ + std::string("() can be used only for array and object types"));
 }
 
 const value::object_t& value::get_object() const
 {
   if ( is_object() )
-  {
-    if ( !m_data._map )
-      throw std::runtime_error(__func__ + std::string("() object is null"));
-    return *m_data._map;
-  }
+    return m_data._map;
   throw std::runtime_error(__func__ + std::string("() can be used only for object type"));
 }
 
 const value::array_t& value::get_array() const
 {
   if ( is_array() )
-    return m_data._arr;
+    return *m_data._arr;
   throw std::runtime_error(__func__ + std::string("() can be used only for array type"));
 }
 
@@ -365,16 +995,21 @@ bool value::get_bool() const
 }
 
 std::string value::get_str() const
+{
+  return std::string(get_str_view());
+}
+
+std::string_view value::get_str_view() const
 {
   if ( is_string() )
-    return m_data._str;
-  throw std::runtime_error(__func__ + std::string("() can be used only for string type"));
+    return str_view();
+  throw std::runtime_error(std::string("get_str() can be used only for string type"));
 }
 
 std::string value::as_str() const
 {
   if ( is_string() )
-    return m_data._str;
+    return std::string(str_view());
   else if ( is_bool() )
     return json::to_string(m_data._bval);
   else if ( is_signed() )
@@ -443,56 +1078,73 @@ void value::write(std::ostream& _out, const format& _format) const
 
 void value::p_write(std::ostream& _out, const format& _format, uint32_t _level) const
 {
-  auto escape_string =[&](const std::string& _input)->std::string
+  // Write the runs of characters that need no escape at once
+  auto write_string = [&](const std::string_view _input)
     {
-      std::string output;
-      for ( size_t i = 0; i < _input.length(); i++ )
+      static const char hex[] = "0123456789abcdef";
+      auto write_u = [&](uint32_t _unit)
+        {
+          const char escape[6] = { '\\', 'u', hex[(_unit >> 12) & 0xF], hex[(_unit >> 8) & 0xF],
+                                   hex[(_unit >> 4) & 0xF], hex[_unit & 0xF] };
+          _out.write(escape, sizeof(escape));
+        };
+      const bool plain = ! _format.escape_unicode && ! _format.string_no_quotes;
+      const char* end = _input.data() + _input.size();
+      const char* run = _input.data();
+      for ( const char* p = run; p < end; )
       {
-        char ch = _input[i];
-        switch ( ch )
+        if ( plain )
         {
-          //case '/':
-          //output += '\\';
-          //output += ch;
-          //break;
-        case '\b':
-          output += "\\b";
-          break;
-        case '\f':
-          output += "\\f";
-          break;
-        case '\n':
-          output += "\\n";
-          break;
-        case '\r':
-          output += "\\r";
-          break;
-        case '\t':
-          output += "\\t";
-          break;
-        case '\\':
-          if ( _input[i+1] != 'u' || _format.string_no_quotes )
-            output += '\\';
-          output += ch;
-          break;
-        case '\"': // Quotation mark
-          output += '\\';
-          output += ch;
-          break;
-          /*
-            case '\u':
-            output += "\\u";
+          // Only ", \ and the control characters are escaped
+          p = simd::find_string_special(p, end);
+          if ( p == end )
             break;
-          */
+        }
+        const uint8_t ch = static_cast<uint8_t>(*p);
+        if ( ch >= 0x20 && ch != '\"' && ch != '\\' && ( ch < 0x80 || ! _format.escape_unicode )
+             && ( ch != ',' || ! _format.string_no_quotes ) )
+        {
+          ++p;
+          continue;
+        }
+        _out.write(run, p - run);
+        const char* next = p + 1;
+        switch ( ch )
+        {
+        case '\b': _out << "\\b"; break;
+        case '\f': _out << "\\f"; break;
+        case '\n': _out << "\\n"; break;
+        case '\r': _out << "\\r"; break;
+        case '\t': _out << "\\t"; break;
+        case '\\': _out << "\\\\"; break;
+        case '\"': _out << "\\\""; break;
         default:
-          if ( ch == ',' && _format.string_no_quotes )
-            output += "\\u002c";
+          if ( ch < 0x80 )
+            write_u(ch);
           else
-            output += ch;
+          {
+            // Code points above U+FFFF are written as a surrogate pair. Bytes that are not valid
+            // UTF-8 are written as the replacement character.
+            uint32_t cp = 0xFFFD;
+            next = decode_utf8(p, end, cp);
+            if ( next == nullptr )
+            {
+              next = p + 1;
+              cp = 0xFFFD;
+            }
+            if ( cp >= 0x10000 )
+            {
+              write_u(0xD800 + ((cp - 0x10000) >> 10));
+              write_u(0xDC00 + ((cp - 0x10000) & 0x3FF));
+            }
+            else
+              write_u(cp);
+          }
           break;
         }
+        p = run = next;
       }
-      return output;
+      _out.write(run, end - run);
     };
 
   std::string padding;
@@ -505,10 +1157,22 @@ void value::p_write(std::ostream& _out, const format& _format, uint32_t _level)
 
   if ( is_object() )
   {
+    // The members are written in the order they are stored, unless they have to be sorted
+    const object_t& jmap = m_data._map;
+    std::vector<const object_t::member*> sorted;
+    if ( _format.sort_keys && ! jmap.is_sorted() )
+    {
+      sorted.reserve(jmap.size());
+      for ( const auto& entry : jmap )
+        sorted.push_back(&entry);
+      std::sort(sorted.begin(), sorted.end(),
+                [](const object_t::member* _a, const object_t::member* _b) { return _a->first < _b->first; });
+    }
     _out << "{";
     bool isFirst = true;
-    for ( const auto& entry : m_data.map() )
+    for ( size_t i = 0; i < jmap.size(); i++ )
     {
+      const object_t::member& entry = sorted.empty()? jmap.begin()[i] : *sorted[i];
       if ( ! isFirst )
       {
         _out << ",";
@@ -521,7 +1185,11 @@ void value::p_write(std::ostream& _out, const format& _format, uint32_t _level)
       if ( _format.type == format_type::compact )
       {
         if ( ! _format.key_no_quotes )
-          _out << "\"" << entry.first << "\":";
+        {
+          _out << "\"";
+          write_string(entry.first);
+          _out << "\":";
+        }
         else
           _out << entry.first << ":";
         entry.second.p_write(_out, _format, _level+1);
@@ -529,7 +1197,11 @@ void value::p_write(std::ostream& _out, const format& _format, uint32_t _level)
       else if ( _format.type == format_type::pretty )
       {
         if ( ! _format.key_no_quotes )
-          _out << padding << "\"" << entry.first << "\" : ";
+        {
+          _out << padding << "\"";
+          write_string(entry.first);
+          _out << "\" : ";
+        }
         else
           _out << padding << entry.first << " : ";
         entry.second.p_write(_out, _format, _level+1);
@@ -564,12 +1236,15 @@ void value::p_write(std::ostream& _out, const format& _format, uint32_t _level)
   }
   else if ( is_string() )
   {
-    if ( ! _format.string_no_quotes
-         || ( m_data._str.length() == 4 && (m_data._str == "true" || m_data._str == "null") )
-         || ( m_data._str.length() == 5 && m_data._str == "false") )
-     _out << "\"" << escape_string(m_data._str) << "\"";
+    const std::string_view str = str_view();
+    if ( ! _format.string_no_quotes || str == "true" || str == "null" || str == "false" )
+    {
+      _out << "\"";
+      write_string(str);
+      _out << "\"";
+    }
     else
-     _out << escape_string(m_data._str);
+      write_string(str);
   }
   else if ( is_null() )
     _out << "null";
@@ -581,28 +1256,29 @@ const value& value::operator[](const size_t _index) const
 {
   if ( ! is_array() )
     throw std::runtime_error(__func__ + std::string(": can be used only for array type"));
-  if ( _index >= m_data._arr.size() )
+  if ( _index >= m_data._arr->size() )
     throw std::runtime_error(__func__ + std::string(": index(") + std::to_string(_index)
-                         + ") out of range(" + std::to_string(m_data._arr.size()) + ")");
-  return m_data._arr[_index];
+                         + ") out of range(" + std::to_string(m_data._arr->size()) + ")");
+  return (*m_data._arr)[_index];
 }
 
 value& value::operator[](const size_t _index)
 {
   if ( ! is_array() )
     throw std::runtime_error(__func__ + std::string(": can be used only for array type"));
-  if ( _index >= m_data._arr.size() )
+  if ( _index >= m_data._arr->size() )
     throw std::runtime_error(__func__ + std::string(": index(") + std::to_string(_index)
-                         + ") out of range(" + std::to_string(m_data._arr.size()) + ")");
-  return m_data._arr[_index];
+                         + ") out of range(" + std::to_string(m_data._arr->size()) + ")");
+  mark_changed();
+  return (*m_data._arr)[_index];
 }
 
 const value& value::operator[](const std::string& _key) const
 {
   if ( ! is_object() )
     throw std::runtime_error(__func__ + std::string(": can be used only for object type"));
-  for ( const auto& entry : m_data.map() )
-    if ( entry.first == _key ) return entry.second;
+  if ( auto it = m_data._map.find(_key); it != m_data._map.end() )
+    return it->second;
   throw std::runtime_error(__func__ + std::string(": key(") + _key + ") not found");
 }
 
@@ -611,9 +1287,10 @@ value& value::operator[](const std::string& _key)
   if ( ! is_object() )
   {
     this->clear();
-    m_type = m_data.init(value_type::object);
+    init(value_type::object);
   }
-  return (m_data.map())[_key];
+  mark_changed();
+  return m_data._map[_key];
 }
 
 // Erase value from the array
@@ -621,7 +1298,7 @@ void value::erase(const std::string& _key)
 {
   if ( ! is_object() )
     throw std::runtime_error(__func__ + std::string("key can be used only for object type"));
-  m_data.map().erase(_key);
+  m_data._map.erase(_key);
 }
 
 value& value::append(const value& _obj)
@@ -629,10 +1306,23 @@ value& value::append(const value& _obj)
   if ( ! is_array() )
   {
     this->clear();
-    m_type = m_data.init(value_type::array);
+    init(value_type::array);
   }
-  m_data._arr.push_back(_obj);
-  return m_data._arr[m_data._arr.size()-1];
+  mark_changed();
+  return m_data._arr->emplace_back(_obj);
+}
+
+value& value::append(value&& _obj)
+{
+  // _obj may be this value or within it. So, take it out before changing this value.
+  value tmp(std::move(_obj));
+  if ( ! is_array() )
+  {
+    this->clear();
+    init(value_type::array);
+  }
+  mark_changed();
+  return m_data._arr->emplace_back(std::move(tmp));
 }
 
 value& value::append()
@@ -640,11 +1330,10 @@ value& value::append()
   if ( ! is_array() )
   {
     this->clear();
-    m_type = m_data.init(value_type::array);
+    init(value_type::array);
   }
-  value jval;
-  m_data._arr.push_back(std::move(jval));
-  return m_data._arr[m_data._arr.size()-1];
+  mark_changed();
+  return m_data._arr->emplace_back();
 }
 
 // Erase value from the array
@@ -652,177 +1341,141 @@ void value::erase(const size_t _index)
 {
   if ( ! is_array() )
     throw std::runtime_error(__func__ + std::string(": can be used only for array type"));
-  if ( _index >= m_data._arr.size() )
+  if ( _index >= m_data._arr->size() )
     throw std::out_of_range(__func__ + std::string("; Attempting to delete index ") + std::to_string(_index));
-  m_data._arr.erase(m_data._arr.begin() + _index);
+  m_data._arr->erase(m_data._arr->begin() + _index);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 //
-// Implementation of value::union_data
+// Implementation of value_pool
 //
 ///////////////////////////////////////////////////////////////////////////////////////////////////
-value::union_data::union_data(const value_type _type)
+void value_pool::recycle(value& _jval)
 {
-  init(_type);
-}
+  const size_t firstString = m_strings.size();
+  const size_t firstArray = m_arrays.size();
+  const size_t firstObject = m_objects.size();
 
-value::union_data::union_data(const union_data& _obj, const value_type _type)
-{
-  init(_obj, true, _type);
+  // Walk the tree in document order so that the next parse takes the storage back in the same
+  // order, and a string gets the buffer of the string that was at its place.
+  m_pending.clear();
+  m_pending.push_back(&_jval);
+  while ( ! m_pending.empty() )
+  {
+    value& jval = *m_pending.back();
+    m_pending.pop_back();
+    value::union_data& data = jval.m_data;
+    // The storage of an arena is not pooled
+    if ( jval.is_complex_type() && jval.m_size != 0 )
+    {
+      jval.clear();
+      continue;
+    }
+    switch ( jval.m_type )
+    {
+    case value_type::string:
+      // A short string has no storage of its own
+      if ( jval.m_size == value::long_size )
+        m_strings.emplace_back(data._str);
+      break;
+    case value_type::array:
+      // The elements stay where they are until the array is cleared below
+      for ( auto it = data._arr->rbegin(); it != data._arr->rend(); ++it )
+        m_pending.push_back(&(*it));
+      m_arrays.emplace_back(data._arr);
+      break;
+    case value_type::object:
+      // The members stay where they are until the object is cleared below
+      for ( auto it = data._map.end(); it != data._map.begin(); )
+        m_pending.push_back(&(--it)->second);
+      m_objects.push_back(std::move(data._map));
+      data._map.~object();
+      break;
+    default: break;
+    }
+    jval.m_type = value_type::null;
+  }
+  // All the elements and members are null now
+  for ( size_t i = firstArray; i < m_arrays.size(); i++ )
+    m_arrays[i]->clear();
+  for ( size_t i = firstObject; i < m_objects.size(); i++ )
+    m_objects[i].clear();
+  // Storage is taken from the back
+  std::reverse(m_strings.begin() + firstString, m_strings.end());
+  std::reverse(m_arrays.begin() + firstArray, m_arrays.end());
+  std::reverse(m_objects.begin() + firstObject, m_objects.end());
 }
 
-value::union_data::union_data(union_data&& _obj, const value_type _type) noexcept
+void value_pool::release()
 {
-  init(std::move(_obj), _type);
+  m_strings.clear();
+  m_strings.shrink_to_fit();
+  m_arrays.clear();
+  m_arrays.shrink_to_fit();
+  m_objects.clear();
+  m_objects.shrink_to_fit();
+  m_keys.clear();
+  m_pending.clear();
+  m_pending.shrink_to_fit();
 }
 
-value::union_data::~union_data()
+bool value_pool::empty() const
 {
+  return m_strings.empty() && m_arrays.empty() && m_objects.empty() && m_keys.size() == 0;
 }
 
-#include <iostream>
-using namespace std;
-value_type value::union_data::clear(const value_type _type)
+bool value_pool::take(value& _jval, const value_type _type, const object_layout _layout/* = object::default_layout()*/)
 {
+  _jval.clear();
   switch ( _type )
   {
-  case value_type::string: _str.~string(); break;
   case value_type::array:
-    // Iteratively delete all entries
-    for ( auto& entry : _arr )
-      entry.clear();
-    _arr.~array_t();
-    break;
+    if ( m_arrays.empty() )
+      break;
+    _jval.m_data._arr = m_arrays.back().release();
+    _jval.m_type = value_type::array;
+    m_arrays.pop_back();
+    return false;
   case value_type::object:
-    // Iteratively delete all entries
-    for ( auto& entry : *_map )
-      entry.second.clear();
-    delete _map;
-    _map = nullptr;
-    //--json_gobjects_alloc;
-    break;
+    // An object allocates nothing until it has members
+    if ( ! m_objects.empty() && m_objects.back().layout() == _layout )
+    {
+      new (&_jval.m_data._map) value::object_t(std::move(m_objects.back()));
+      m_objects.pop_back();
+    }
+    else
+      new (&_jval.m_data._map) value::object_t(_layout);
+    _jval.m_type = value_type::object;
+    return false;
   default: break;
   }
-  return value_type::null;
-}
-
-value_type value::union_data::init(const value_type _type/* = value_type::null*/)
-{
-  switch ( _type )
-  {
-  case value_type::null:      break;
-  case value_type::string:    new (&_str) std::string; break;
-  case value_type::_signed:   _i64 = 0; break;
-  case value_type::_unsigned: _u64 = 0; break;
-  case value_type::_double:   _dbl = 0; break;
-  case value_type::boolean:   _bval = false; break;
-  case value_type::array:     new (&_arr) array_t; break;
-  case value_type::object:    _map = new object_t; /*++json_gobjects_alloc;*/ break;
-  }
-  return _type;
-}
-
-value_type value::union_data::init(
-  const union_data& _obj,
-  const bool        _new/* = true*/,
-  const value_type  _type/* = value_type::null*/
-  )
-{
-  switch ( _type )
-  {
-  case value_type::null:      break;
-  case value_type::string:    init(_obj._str);  break;
-  case value_type::_signed:   init(_obj._i64);  break;
-  case value_type::_unsigned: init(_obj._u64);  break;
-  case value_type::_double:   init(_obj._dbl);  break;
-  case value_type::boolean:   init(_obj._bval); break;
-  case value_type::array:     init(_obj._arr);  break;
-  case value_type::object:    init(_obj.map(), _new); break;
-  }
-  return _type;
-}
-
-value_type value::union_data::init(const int _val)
-{
-  return this->init(static_cast<int64_t>(_val));
-}
-
-value_type value::union_data::init(const int64_t _val)
-{
-  _i64 = _val;
-  return value_type::_signed;
+  _jval.init(_type);
+  return ( _type == value_type::array );
 }
 
-value_type value::union_data::init(const uint64_t _val)
+bool value_pool::take(value& _jval, const std::string_view _str)
 {
-  _u64 = _val;
-  return value_type::_unsigned;
-}
-
-value_type value::union_data::init(const long double _val)
-{
-  _dbl = _val;
-  return value_type::_double;
-}
-
-value_type value::union_data::init(const bool _val)
-{
-  _bval = _val;
-  return value_type::boolean;
-}
-
-value_type value::union_data::init(const std::string& _val)
-{
-  new (&_str) std::string(_val);
-  return value_type::string;
-}
-
-value_type value::union_data::init(const char* _val)
-{
-  if ( _val != nullptr )
-    return init(std::string(_val));
-  return init(value_type::null);
-}
-
-value_type value::union_data::init(const array_t& _val)
-{
-  new (&_arr) array_t(_val);
-  return value_type::array;
-}
-
-value_type value::union_data::init(const object_t& _val, const bool _new/* = true*/)
-{
-  if ( _new )
+  _jval.clear();
+  if ( _str.size() <= value::short_capacity )
   {
-    _map = new object_t(_val);
-    /*++json_gobjects_alloc;*/
+    _jval.init_str(_str);
+    return false;
   }
-  else
-    *_map = _val;
-  return value_type::object;
-}
-
-//! Move initializer routine
-value_type value::union_data::init(union_data&& _obj, value_type _type) noexcept
-{
-  switch ( _type )
+  if ( m_strings.empty() )
   {
-  case value_type::null:            break;
-  case value_type::string:          new (&_str) std::string(_obj._str); break;
-  case value_type::_signed:         _i64  = _obj._i64;  break;
-  case value_type::_unsigned:       _u64  = _obj._u64;  break;
-  case value_type::_double:         _dbl  = _obj._dbl;  break;
-  case value_type::boolean:         _bval = _obj._bval; break;
-  case value_type::array:           new (&_arr) array_t(_obj._arr); break;
-  case value_type::object:          _map  = _obj._map;  break;
+    _jval.init_str(_str);
+    return true;
   }
-  // We've made a copy of the string and array objects.
-  // So, we need to clear them from _obj
-  // object uses a pointer. We don't want to clear the object type alone
-  if ( _type != value_type::object )
-    _obj.clear(_type);
-  return _type;
+  // The pooled string keeps its capacity
+  std::string& str = *m_strings.back();
+  const size_t capacity = str.capacity();
+  str.assign(_str.data(), _str.size());
+  _jval.m_data._str = m_strings.back().release();
+  _jval.m_size = value::long_size;
+  _jval.m_type = value_type::string;
+  m_strings.pop_back();
+  return str.capacity() != capacity;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -38,6 +38,10 @@ LICENSE: END
  */
 #include <gtest/gtest.h>
 #include "json/json.h"
+#include <fstream>
+#include <cstdio>
+#include <mutex>
+#include <functional>
 
 using namespace sid::json;
 
@@ -204,4 +208,1179 @@ TEST_F(ParserTest, DuplicateKeyHandling) {
     // Reject should throw exception
     ctrl.dupKey = parser_control::dup_key::reject;
     EXPECT_THROW(value::parse(out, json, ctrl), std::exception);
-}
\ No newline at end of file
+}
+TEST_F(ParserTest, StructuralIndex) {
+    // Build a document that crosses many 64-byte blocks and index windows with strings
+    // containing structural characters, escaped quotes and backslash runs at every offset
+    std::string json = "[\n";
+    for ( int i = 0; i < 5000; i++ ) {
+        json += "  {\"id\": " + std::to_string(i) + ", \"text\": \"a{b}[c]:d,e "
+              + std::string(i % 70, '\\') + std::string(i % 70, '\\') + "\\\" end\",\n"
+              + "   \"list\" : [ true , false,null, -1.5e3 ],\t\"empty\": {} }";
+        json += ( i < 4999 )? ",\n" : "\n";
+    }
+    json += "]\n";
+
+    parser_output out, outBuf;
+    EXPECT_NO_THROW(value::parse(out, json));
+    std::stringbuf sbuf(json, std::ios_base::in);
+    EXPECT_NO_THROW(value::parse(outBuf, sbuf));
+    ASSERT_EQ(out.jroot.size(), 5000);
+    EXPECT_EQ(out.jroot[69]["text"].get_str(),
+              "a{b}[c]:d,e " + std::string(69, '\\') + "\" end");
+    EXPECT_EQ(out.jroot.to_string(), outBuf.jroot.to_string());
+    EXPECT_EQ(out.stats.strings, outBuf.stats.strings);
+    EXPECT_EQ(out.stats.keys, outBuf.stats.keys);
+
+    // Errors must still report the right line
+    json.insert(json.size()-3, ",");
+    try {
+        value::parse(out, json);
+        FAIL() << "Trailing comma must be rejected";
+    }
+    catch (const std::exception& e) {
+        EXPECT_NE(std::string(e.what()).find("@line:10002, @pos:1 "), std::string::npos) << e.what();
+    }
+}
+
+TEST_F(ParserTest, StructuralIndexWithComments) {
+    // The index stops at the first comment. The rest is parsed character by character.
+    std::string json = R"({"a": "x//y#z", "b": [1, 2]  // comment with a "quote
+        , "c": /* another "one" */ "value" # last
+    })";
+    parser_output out;
+    EXPECT_NO_THROW(value::parse(out, json));
+    EXPECT_EQ(out.jroot["a"].get_str(), "x//y#z");
+    EXPECT_EQ(out.jroot["b"].size(), 2);
+    EXPECT_EQ(out.jroot["c"].get_str(), "value");
+}
+
+TEST_F(ParserTest, StringRuns) {
+    // Long strings with escapes and raw control characters at every offset of a vector
+    std::string json = "[", expected;
+    for ( int i = 0; i < 80; i++ ) {
+        const std::string pad(i, 'x');
+        json += std::string(i? ",":"") + "\"" + pad + "\\t\\\\" + pad + "\\u00e9\t\n" + pad + "\"";
+    }
+    json += "]";
+
+    // Without the structural index (relaxed mode) and with it (strict mode)
+    parser_control relaxed;
+    relaxed.mode.allowNocaseValues = true;
+    parser_output out, outRelaxed;
+    EXPECT_NO_THROW(value::parse(out, json));
+    EXPECT_NO_THROW(value::parse(outRelaxed, json, relaxed));
+    ASSERT_EQ(out.jroot.size(), 80);
+    for ( size_t i = 0; i < 80; i++ ) {
+        const std::string pad(i, 'x');
+        EXPECT_EQ(out.jroot[i].get_str(), pad + "\t\\" + pad + "\xC3\xA9\t\n" + pad);
+        EXPECT_EQ(outRelaxed.jroot[i].get_str(), out.jroot[i].get_str());
+    }
+
+    // Newlines within strings are counted for the error location
+    json = "[\"a\nb\nc\", tru]";
+    try {
+        value::parse(out, json, relaxed);
+        FAIL() << "Invalid literal must be rejected";
+    }
+    catch (const std::exception& e) {
+        EXPECT_NE(std::string(e.what()).find("@line:3"), std::string::npos) << e.what();
+    }
+    // Unterminated string
+    EXPECT_THROW(value::parse(out, std::string("[\"abc")), std::exception);
+    EXPECT_THROW(value::parse(out, std::string("[\"abc\\")), std::exception);
+}
+
+TEST_F(ParserTest, NumberDecoding) {
+    std::string json = R"([0, -0, 12345678, 1234567890123456789, 18446744073709551615,
+        18446744073709551616, -9223372036854775808, -9223372036854775809,
+        0.1, 2.2250738585072014e-308, 1.7976931348623157e308, 9007199254740993.0,
+        1.00000000000000011102230246251565404236316680908203126, 1e-400, 7E+2])";
+    parser_output out, outStream;
+    ASSERT_NO_THROW(value::parse(out, json));
+    std::stringbuf sbuf(json);
+    ASSERT_NO_THROW(value::parse(outStream, sbuf));
+    ASSERT_EQ(out.jroot.size(), 15);
+    EXPECT_TRUE(out.jroot[0].is_unsigned());
+    EXPECT_TRUE(out.jroot[1].is_signed());
+    EXPECT_EQ(out.jroot[2].get_uint64(), 12345678u);
+    EXPECT_EQ(out.jroot[3].get_uint64(), 1234567890123456789u);
+    EXPECT_EQ(out.jroot[4].get_uint64(), 18446744073709551615u);
+    // Integers that do not fit become doubles
+    EXPECT_TRUE(out.jroot[5].is_double());
+    EXPECT_EQ(out.jroot[5].get_double(), 18446744073709551616.0L);
+    EXPECT_EQ(out.jroot[6].get_int64(), INT64_MIN);
+    EXPECT_TRUE(out.jroot[7].is_double());
+    EXPECT_EQ(out.jroot[7].get_double(), static_cast<value::number_t>(-9223372036854775809.0L));
+    // Doubles are correctly rounded to the stored type
+#ifdef SID_JSON_LONG_DOUBLE
+    EXPECT_EQ(out.jroot[8].get_double(), 0.1L);
+    EXPECT_EQ(out.jroot[9].get_double(), 2.2250738585072014e-308L);
+    EXPECT_EQ(out.jroot[10].get_double(), 1.7976931348623157e308L);
+    EXPECT_EQ(out.jroot[11].get_double(), 9007199254740993.0L);
+    EXPECT_EQ(out.jroot[12].get_double(), 1.00000000000000011102230246251565404236316680908203126L);
+    EXPECT_EQ(out.jroot[13].get_double(), 1e-400L);
+#else
+    EXPECT_EQ(out.jroot[8].get_double(), static_cast<long double>(0.1));
+    EXPECT_EQ(out.jroot[9].get_double(), static_cast<long double>(2.2250738585072014e-308));
+    EXPECT_EQ(out.jroot[10].get_double(), static_cast<long double>(1.7976931348623157e308));
+    EXPECT_EQ(out.jroot[11].get_double(), static_cast<long double>(9007199254740992.0));
+    EXPECT_EQ(out.jroot[12].get_double(), static_cast<long double>(1.0000000000000002));
+    EXPECT_EQ(out.jroot[13].get_double(), 0.0L);
+#endif
+    EXPECT_EQ(out.jroot[14].get_double(), 700.0L);
+    for ( size_t i = 0; i < out.jroot.size(); i++ ) {
+        EXPECT_EQ(out.jroot[i].type(), outStream.jroot[i].type()) << i;
+        if ( out.jroot[i].is_double() )
+            EXPECT_EQ(out.jroot[i].get_double(), outStream.jroot[i].get_double()) << i;
+        else
+            EXPECT_EQ(out.jroot[i].get_uint64(), outStream.jroot[i].get_uint64()) << i;
+    }
+#ifdef SID_JSON_LONG_DOUBLE
+    // The range of long double is kept too
+    ASSERT_NO_THROW(value::parse(out, std::string("[1e999, -1e-4000]")));
+    EXPECT_EQ(out.jroot[0].get_double(), 1e999L);
+    EXPECT_EQ(out.jroot[1].get_double(), -1e-4000L);
+#endif
+
+    // Invalid numbers are rejected by both paths
+    for ( const char* bad : { "[01]", "[-]", "[1.]", "[1.e5]", "[1e]", "[1e+]", "[+1]", "[0x10]", "[1e99999]" } ) {
+        std::stringbuf sbad(bad);
+        EXPECT_THROW(value::parse(out, bad), std::exception) << bad;
+        EXPECT_THROW(value::parse(out, sbad), std::exception) << bad;
+    }
+    try {
+        value::parse(out, std::string("[1, 2.x]"));
+        FAIL() << "Missing fraction digit must be rejected";
+    }
+    catch (const std::exception& e) {
+        EXPECT_NE(std::string(e.what()).find("Invalid digit (x) Expected a digit for fraction @line:1, @pos:7"),
+                  std::string::npos) << e.what();
+    }
+}
+
+TEST_F(ParserTest, StreamBlocks) {
+    // Stream buffers are read in 64KB blocks. Move the tokens across the block boundary.
+    const std::string record = R"({"id": 517093426, "data": -960, "s": "abc\n", "t": true, "f": 2.5e-3})";
+    for ( size_t shift = 0; shift < record.size() + 2; shift++ ) {
+        std::string json = "[" + std::string(65535 - record.size() + shift, ' ');
+        for ( int i = 0; i < 3; i++ )
+            json += (i? "," : "") + record;
+        json += "]";
+        parser_output out, outBuf;
+        std::stringbuf sbuf(json, std::ios_base::in);
+        ASSERT_NO_THROW(value::parse(out, json)) << shift;
+        ASSERT_NO_THROW(value::parse(outBuf, sbuf)) << shift;
+        EXPECT_EQ(out.jroot.to_string(), outBuf.jroot.to_string()) << shift;
+        EXPECT_EQ(outBuf.stats.data_size, json.size()) << shift;
+    }
+
+    // Unquoted strings go back to the start of the value, which may be in the previous block
+    parser_control relaxed;
+    relaxed.mode.allowFlexibleStrings = true;
+    for ( size_t shift = 0; shift < 12; shift++ ) {
+        const std::string json = "[" + std::string(65535 - 11 + shift, ' ') + "nothing, tr]";
+        parser_output out;
+        std::stringbuf sbuf(json, std::ios_base::in);
+        ASSERT_NO_THROW(value::parse(out, sbuf, relaxed)) << shift;
+        EXPECT_EQ(out.jroot[0].get_str(), "nothing");
+        EXPECT_EQ(out.jroot[1].get_str(), "tr");
+    }
+
+    // Stream buffers that cannot be positioned, like pipes, are read from where they are
+    struct pipe_buf : public std::stringbuf {
+        using std::stringbuf::stringbuf;
+        pos_type seekoff(off_type, std::ios_base::seekdir, std::ios_base::openmode) override { return pos_type(-1); }
+        pos_type seekpos(pos_type, std::ios_base::openmode) override { return pos_type(-1); }
+    } pbuf(R"({"a": [1, 2, 3]})", std::ios_base::in);
+    parser_output out;
+    ASSERT_NO_THROW(value::parse(out, pbuf));
+    EXPECT_EQ(out.jroot["a"].size(), 3);
+}
+
+TEST_F(ParserTest, NestingDepth) {
+    auto nested = [](size_t depth) {
+        std::string json;
+        for ( size_t i = 0; i < depth; i++ )
+            json += ( i % 2 )? "{\"k\": " : "[1, ";
+        json += "2";
+        for ( size_t i = depth; i > 0; i-- )
+            json += ( (i-1) % 2 )? "}" : "]";
+        return json;
+    };
+    parser_output out;
+    EXPECT_NO_THROW(value::parse(out, nested(parser_control::default_max_depth)));
+    EXPECT_EQ(out.stats.arrays + out.stats.objects, parser_control::default_max_depth);
+    try {
+        value::parse(out, nested(parser_control::default_max_depth + 1));
+        FAIL() << "Nesting beyond the maximum depth must be rejected";
+    }
+    catch (const std::exception& e) {
+        EXPECT_NE(std::string(e.what()).find("Maximum nesting depth of 1024 exceeded"), std::string::npos) << e.what();
+    }
+
+    parser_control ctrl;
+    ctrl.maxDepth = 3;
+    EXPECT_NO_THROW(value::parse(out, std::string(R"({"a": [{"b": 1}], "c": [[]]})"), ctrl));
+    EXPECT_THROW(value::parse(out, std::string(R"({"a": [{"b": [1]}]})"), ctrl), std::exception);
+    std::stringbuf sbuf(nested(4), std::ios_base::in);
+    EXPECT_THROW(value::parse(out, sbuf, ctrl), std::exception);
+
+    // No limit. The parser does not recurse, so the depth is bounded only by memory.
+    ctrl.maxDepth = 0;
+    EXPECT_NO_THROW(value::parse(out, nested(5000), ctrl));
+    const value* jval = &out.jroot;
+    for ( size_t i = 1; i < 5000; i++ )
+        jval = ( i % 2 )? &(*jval)[1] : &(*jval)["k"];
+    EXPECT_EQ((*jval)["k"].get_uint64(), 2u);
+
+    // Ignored duplicate keys with nested values
+    ctrl.dupKey = parser_control::dup_key::ignore;
+    EXPECT_NO_THROW(value::parse(out, std::string(R"({"a": 1, "a": {"a": [2], "a": {"x": [3]}, "b": 4}, "c": 5})"), ctrl));
+    EXPECT_EQ(out.jroot["a"].get_uint64(), 1u);
+    EXPECT_EQ(out.jroot["c"].get_uint64(), 5u);
+    EXPECT_EQ(out.jroot.size(), 2);
+}
+
+TEST_F(ParserTest, ErrorLocation) {
+    // Lines are counted only for the error message. String and stream input must agree,
+    // also when the error refers to a position in an earlier block of the stream.
+    const std::string lines(70000, '\n');
+    const std::string docs[] = {
+        "{\n  \"a\": 1,\n  \"b\": tru\n}",
+        "[" + lines + "1,\n 2.]",
+        "[1,\n \"" + lines + "unterminated" + lines,
+        "[1,\n  /* comment" + lines + " not closed",
+    };
+    const std::string expected[] = {
+        "Invalid value [tru] @line:3, @pos:11",
+        "@line:70002, @pos:4",
+        "Missing \" for string starting @line:2, @pos:2",
+        "Comments starting @line:2, @pos:4 is not closed",
+    };
+    parser_control relaxed;
+    relaxed.mode.allowNocaseValues = true;
+    for ( size_t i = 0; i < 4; i++ ) {
+        std::string errors[3];
+        for ( int m = 0; m < 3; m++ ) {
+            parser_output out;
+            std::stringbuf sbuf(docs[i], std::ios_base::in);
+            try {
+                if ( m == 0 ) value::parse(out, docs[i]);
+                else if ( m == 1 ) value::parse(out, docs[i], relaxed);
+                else value::parse(out, sbuf);
+                FAIL() << "Document " << i << " must be rejected";
+            }
+            catch (const std::exception& e) {
+                errors[m] = e.what();
+            }
+            EXPECT_NE(errors[m].find(expected[i]), std::string::npos) << i << ": " << errors[m];
+        }
+        EXPECT_EQ(errors[0], errors[1]);
+        EXPECT_EQ(errors[0], errors[2]);
+    }
+}
+
+TEST_F(ParserTest, Literals) {
+    parser_control nocase;
+    nocase.mode.allowNocaseValues = true;
+    // Every case combination of the literals, before a separator and before the end of the array
+    for ( const std::string& word : std::vector<std::string>{ "true", "false", "null" } ) {
+        for ( uint32_t bits = 0; bits < (1u << word.size()); bits++ ) {
+            std::string lit = word;
+            for ( size_t i = 0; i < lit.size(); i++ )
+                if ( bits & (1u << i) ) lit[i] = static_cast<char>(::toupper(lit[i]));
+            const std::string capitalized = std::string(1, static_cast<char>(::toupper(word[0]))) + word.substr(1);
+            std::string upper = word;
+            for ( auto& c : upper ) c = static_cast<char>(::toupper(c));
+            const bool strictOk = ( lit == word );
+            const bool nocaseOk = strictOk || lit == capitalized || lit == upper;
+            for ( const std::string& json : { "[" + lit + ", 1]", "[1, " + lit + "]", "{\"a\": " + lit + "\n}" } ) {
+                for ( int m = 0; m < 4; m++ ) {
+                    parser_output out;
+                    std::stringbuf sbuf(json, std::ios_base::in);
+                    const parser_control& ctrl = ( m % 2 )? nocase : parser_control();
+                    const bool ok = ( m % 2 )? nocaseOk : strictOk;
+                    auto parse = [&]() { if ( m < 2 ) value::parse(out, json, ctrl); else value::parse(out, sbuf, ctrl); };
+                    if ( !ok ) {
+                        EXPECT_THROW(parse(), std::exception) << json << " mode " << m;
+                        continue;
+                    }
+                    ASSERT_NO_THROW(parse()) << json << " mode " << m;
+                    const value& jval = ( json[0] == '{' )? out.jroot["a"] : out.jroot[json[1] == '1'? 1 : 0];
+                    if ( word == "null" )
+                        EXPECT_TRUE(jval.is_null()) << json;
+                    else
+                        EXPECT_EQ(jval.get_bool(), word == "true") << json;
+                }
+            }
+        }
+    }
+
+    // Literals must end at a separator or space
+    parser_output out;
+    for ( const char* json : { "[truex]", "[nul]", "[true}", "[false/]", "[null1]", "[tru" } )
+        EXPECT_THROW(value::parse(out, json), std::exception) << json;
+
+    // null overwrites the value of a duplicate key
+    EXPECT_NO_THROW(value::parse(out, std::string(R"({"a": 1, "a": null, "b": "x", "b": true})")));
+    EXPECT_TRUE(out.jroot["a"].is_null());
+    EXPECT_TRUE(out.jroot["b"].get_bool());
+    EXPECT_EQ(out.stats.nulls, 1);
+    EXPECT_EQ(out.stats.booleans, 1);
+}
+
+TEST_F(ParserTest, DuplicateKeyValues) {
+    const std::string json = R"({"a": {"x": [1, 2]}, "b": 1, "a": {"y": "s"}, "a": [3], "a": "str"})";
+    parser_control ctrl;
+    parser_output out;
+
+    // overwrite replaces the whole value instead of merging into it
+    EXPECT_NO_THROW(value::parse(out, json, ctrl));
+    EXPECT_EQ(out.jroot["a"].get_str(), "str");
+    EXPECT_NO_THROW(value::parse(out, std::string(R"({"a": {"x": 1}, "a": {"y": 2}, "b": [1], "b": [2]})"), ctrl));
+    EXPECT_EQ(out.jroot.to_string(), R"({"a":{"y":2},"b":[2]})");
+
+    // append keeps every value, including the nested ones, in order
+    ctrl.dupKey = parser_control::dup_key::append;
+    EXPECT_NO_THROW(value::parse(out, json, ctrl));
+    EXPECT_EQ(out.jroot.to_string(), R"({"a":[{"x":[1,2]},{"y":"s"},[3],"str"],"b":1})");
+    EXPECT_EQ(out.stats.keys, 7);
+
+    // Many duplicates of a large value
+    std::string many = "{";
+    std::string big = "[0.5";
+    for ( int i = 1; i < 1000; i++ )
+        big += ", 1.5";
+    big += "]";
+    for ( int i = 0; i < 2000; i++ )
+        many += std::string(i? "," : "") + "\"k\": {\"v\": " + big + ", \"i\": " + std::to_string(i) + "}";
+    many += "}";
+    EXPECT_NO_THROW(value::parse(out, many, ctrl));
+    ASSERT_EQ(out.jroot["k"].size(), 2000);
+    EXPECT_EQ(out.jroot["k"][1999]["i"].get_uint64(), 1999u);
+    EXPECT_TRUE(out.jroot["k"][0]["v"][1].is_double());
+
+    // reject names the key
+    ctrl.dupKey = parser_control::dup_key::reject;
+    try {
+        value::parse(out, json, ctrl);
+        FAIL() << "Duplicate key must be rejected";
+    }
+    catch (const std::exception& e) {
+        EXPECT_NE(std::string(e.what()).find("Duplicate key \"a\" encountered"), std::string::npos) << e.what();
+    }
+}
+
+TEST_F(ParserTest, ReusableOutput) {
+    const std::string json = R"({"name": "a string that does not fit in place", "list": [1, "two", {"three": [3.5, true, null]}],)"
+                             R"( "nested": {"long key that needs its own buffer": ["x", "y", "z"], "empty": {}}})";
+    parser_output out;
+    out.reuse = true;
+
+    EXPECT_NO_THROW(value::parse(out, json));
+    const std::string expected = out.jroot.to_string();
+    EXPECT_GT(out.stats.allocations, 0);
+
+    // The same document parses into the storage of the previous one. Long object keys come back
+    // in the order they are stored, so the first reuse may still grow a few key buffers.
+    EXPECT_NO_THROW(value::parse(out, json));
+    EXPECT_LT(out.stats.allocations, 4);
+    for ( int i = 0; i < 3; i++ )
+    {
+        EXPECT_NO_THROW(value::parse(out, json));
+        EXPECT_EQ(out.jroot.to_string(), expected);
+        EXPECT_EQ(out.stats.allocations, 0) << "Parse " << i;
+    }
+
+    // Differently shaped documents still parse correctly
+    EXPECT_NO_THROW(value::parse(out, std::string(R"([{"name": [1, 2]}, "list", {"a": "b", "c": {"d": []}}])")));
+    EXPECT_EQ(out.jroot.to_string(), R"([{"name":[1,2]},"list",{"a":"b","c":{"d":[]}}])");
+    EXPECT_NO_THROW(value::parse(out, json));
+    EXPECT_EQ(out.jroot.to_string(), expected);
+
+    // Duplicate keys take no key from the pool
+    parser_control ctrl;
+    ctrl.dupKey = parser_control::dup_key::append;
+    EXPECT_NO_THROW(value::parse(out, std::string(R"({"a": 1, "a": "text", "b": {"a": 2}})"), ctrl));
+    EXPECT_EQ(out.jroot.to_string(), R"({"a":[1,"text"],"b":{"a":2}})");
+
+    // Without reuse every parse allocates
+    parser_output outFresh;
+    EXPECT_NO_THROW(value::parse(outFresh, json));
+    EXPECT_NO_THROW(value::parse(outFresh, json));
+    EXPECT_GT(outFresh.stats.allocations, 0);
+
+    out.pool.release();
+    EXPECT_TRUE(out.pool.empty());
+}
+
+TEST_F(ParserTest, PushParser) {
+    struct test_case { std::string json; parser_control ctrl; };
+    parser_control relaxed;
+    relaxed.mode.allowFlexibleKeys = 1;
+    relaxed.mode.allowFlexibleStrings = 1;
+    relaxed.mode.allowNocaseValues = 1;
+    const test_case cases[] = {
+        { R"({"name": "a \"quoted\" string \\ with \/ escapes A\n", "list": [1, -2.5e-3, 12345678901234567890,)"
+          R"( true, false, null, [], {}], "nested": {"a": {"b": [[1], [2, {"c": "d"}]]}}})", parser_control() },
+        { "[\n  1,\n  2 # comment\n, /* block ** comment */ 3 // line\n]\n", parser_control() },
+        { "{key: value, other: [a, b/c, TRUE, Null], \"q\": x:y}", relaxed },
+        { "  [  \"\"  ,  0  ,  -0.0  ,  \"\\\\\"  ]  ", parser_control() }
+    };
+    for ( const auto& tc : cases )
+    {
+        parser_output expected;
+        ASSERT_NO_THROW(value::parse(expected, tc.json, tc.ctrl)) << tc.json;
+        for ( size_t chunk : { 1, 2, 3, 7, 64, 4096 } )
+        {
+            parser_output out;
+            push_parser parser(out, tc.ctrl);
+            for ( size_t i = 0; i < tc.json.length(); i += chunk )
+                ASSERT_NO_THROW(parser.feed(tc.json.substr(i, chunk))) << tc.json << " chunk " << chunk;
+            ASSERT_NO_THROW(parser.finish()) << tc.json << " chunk " << chunk;
+            EXPECT_TRUE(parser.done());
+            EXPECT_EQ(out.jroot.to_string(), expected.jroot.to_string()) << "chunk " << chunk;
+            EXPECT_EQ(out.stats.objects, expected.stats.objects);
+            EXPECT_EQ(out.stats.arrays, expected.stats.arrays);
+            EXPECT_EQ(out.stats.strings, expected.stats.strings);
+            EXPECT_EQ(out.stats.numbers, expected.stats.numbers);
+            EXPECT_EQ(out.stats.keys, expected.stats.keys);
+            EXPECT_EQ(out.stats.data_size, tc.json.length());
+        }
+    }
+
+    // The last tokens wait for more input or finish(), as they may continue in the next chunk
+    {
+        parser_output out;
+        push_parser parser(out);
+        parser.feed("{\"a\": [1, 2, 3]");
+        EXPECT_FALSE(parser.done());
+        parser.feed("}\n \n");
+        EXPECT_FALSE(parser.done());
+        parser.finish();
+        EXPECT_TRUE(parser.done());
+        EXPECT_EQ(out.jroot["a"][2].get_int64(), 3);
+    }
+
+    // Errors are the same as with the whole input, with the same location
+    const std::string invalid[] = {
+        "{\"a\": 1,\n \"b\": tru }",
+        "[1, 2\n\n",
+        "[\"abc",
+        "[1, /* not closed ",
+        "{\"a\": 1} x",
+        "[01]",
+        "{\"a\" 1}",
+        ""
+    };
+    for ( const auto& json : invalid )
+    {
+        std::string expected, actual;
+        try { parser_output out; value::parse(out, json); } catch (const std::exception& e) { expected = e.what(); }
+        ASSERT_FALSE(expected.empty()) << json;
+        for ( size_t chunk : { 1, 3, 4096 } )
+        {
+            actual.clear();
+            parser_output out;
+            push_parser parser(out);
+            try
+            {
+                for ( size_t i = 0; i < json.length(); i += chunk )
+                    parser.feed(json.substr(i, chunk));
+                parser.finish();
+            }
+            catch (const std::exception& e) { actual = e.what(); }
+            EXPECT_EQ(actual, expected) << json << " chunk " << chunk;
+            // The parser cannot be used after an error
+            EXPECT_THROW(parser.feed("]"), std::exception);
+        }
+    }
+}
+
+TEST_F(ParserTest, MultipleDocuments) {
+    const std::string lines = "{\"id\": 1, \"tags\": [\"a\", \"b\"]}\n"
+                              "{\"id\": 2, \"tags\": []}\n"
+                              "\n"
+                              "\x1e{\"id\": 3, \"tags\": [\"c\"]}\n"
+                              "\x1e[4, 5]\n";
+    parser_output out;
+    out.reuse = true;
+    std::vector<std::string> docs;
+    uint64_t keys = 0;
+    auto collect = [&](parser_output& _out) {
+        docs.push_back(_out.jroot.to_string());
+        EXPECT_EQ(_out.stats.documents, 1);
+        keys += _out.stats.keys;
+        return true;
+    };
+    const std::vector<std::string> expected = {
+        R"({"id":1,"tags":["a","b"]})", R"({"id":2,"tags":[]})", R"({"id":3,"tags":["c"]})", "[4,5]"
+    };
+
+    parser_stats total;
+    EXPECT_NO_THROW(total = value::parse(out, lines, collect));
+    EXPECT_EQ(docs, expected);
+    EXPECT_EQ(total.documents, 4);
+    EXPECT_EQ(total.objects, 3);
+    EXPECT_EQ(total.arrays, 4);
+    EXPECT_EQ(total.keys, keys);
+    EXPECT_EQ(total.data_size, lines.length());
+
+    // The same through a stream buffer
+    docs.clear();
+    std::stringbuf sbuf(lines, std::ios_base::in);
+    EXPECT_NO_THROW(total = value::parse(out, sbuf, collect));
+    EXPECT_EQ(docs, expected);
+    EXPECT_EQ(total.documents, 4);
+
+    // The handler stops the parsing
+    docs.clear();
+    EXPECT_NO_THROW(total = value::parse(out, lines, [&](parser_output& _out) { return collect(_out) && docs.size() < 2; }));
+    EXPECT_EQ(docs.size(), 2);
+    EXPECT_EQ(total.documents, 2);
+
+    // Errors give the location within the whole input
+    try {
+        value::parse(out, std::string("{\"a\": 1}\n{\"a\": 2\n{\"a\": 3}\n"), collect);
+        FAIL() << "An unclosed record must fail";
+    }
+    catch (const std::exception& e) {
+        EXPECT_NE(std::string(e.what()).find("@line:3, @pos:1"), std::string::npos) << e.what();
+    }
+
+    // Empty input has no documents
+    EXPECT_NO_THROW(total = value::parse(out, std::string(" \n\x1e\n"), collect));
+    EXPECT_EQ(total.documents, 0);
+
+    // Neither has an empty file, which cannot be mapped
+    const std::string path = ::testing::TempDir() + "sid_json_empty.jsonl";
+    std::ofstream(path).close();
+    EXPECT_NO_THROW(total = value::parse_file(out, path, collect));
+    EXPECT_EQ(total.documents, 0);
+    EXPECT_NO_THROW(total = value::parse_file(path, 2, [&](uint64_t, parser_output& _out) { return collect(_out); }));
+    EXPECT_EQ(total.documents, 0);
+    std::remove(path.c_str());
+}
+
+TEST_F(ParserTest, ParallelDocuments) {
+    // Large enough to be split into several chunks
+    std::string lines;
+    for ( int i = 0; i < 30000; i++ )
+        lines += "{\"id\": " + std::to_string(i) + ", \"tags\": [\"t" + std::to_string(i % 7) + "\", null, true]}\n"
+              + ( i % 1000 == 0 ? "\n" : "" );
+    const std::string path = ::testing::TempDir() + "sid_json_parallel.jsonl";
+    std::ofstream(path) << lines;
+
+    parser_output out;
+    std::vector<std::string> expected;
+    value::parse_file(out, path, [&](parser_output& _out) {
+        expected.push_back(_out.jroot.to_string());
+        return true;
+    });
+    ASSERT_EQ(expected.size(), 30000);
+    // The index of every record, not counting the empty lines
+    std::vector<uint64_t> expectedIndexes;
+    for ( uint64_t i = 0; i < expected.size(); i++ )
+        expectedIndexes.push_back(i);
+
+    for ( uint32_t threads : {1, 2, 4} ) {
+        // In input order
+        std::vector<std::string> docs;
+        std::vector<uint64_t> indexes;
+        parser_stats total;
+        EXPECT_NO_THROW(total = value::parse_file(path, threads, [&](uint64_t _index, parser_output& _out) {
+            docs.push_back(_out.jroot.to_string());
+            indexes.push_back(_index);
+            return true;
+        }));
+        EXPECT_EQ(docs, expected) << threads << " threads";
+        EXPECT_EQ(indexes, expectedIndexes);
+        EXPECT_EQ(total.documents, 30000);
+        EXPECT_EQ(total.objects, 30000);
+        EXPECT_EQ(total.data_size, lines.length());
+
+        // As they are parsed. The index gives the order.
+        std::mutex mutex;
+        std::vector<std::string> unordered(expected.size());
+        std::vector<uint64_t> unorderedLines;
+        EXPECT_NO_THROW(value::parse_file(path, threads, [&](uint64_t _index, parser_output& _out) {
+            std::lock_guard<std::mutex> lock(mutex);
+            unordered[_out.jroot["id"].get_int64()] = _out.jroot.to_string();
+            unorderedLines.push_back(_index);
+            return true;
+        }, false));
+        std::sort(unorderedLines.begin(), unorderedLines.end());
+        EXPECT_EQ(unordered, expected);
+        EXPECT_EQ(unorderedLines, indexes);
+    }
+
+    // Empty lines are not records, and a record on two lines is counted once
+    std::ofstream(path) << "{\"a\": 1}\n\n{\"a\":\n 2}\n  \n{\"a\": 3}\n{\"a\": 4}\n";
+    std::vector<uint64_t> small;
+    EXPECT_NO_THROW(value::parse_file(path, 2, [&](uint64_t _index, parser_output& _out) {
+        EXPECT_EQ(_out.jroot["a"].get_int64(), static_cast<int64_t>(_index + 1));
+        small.push_back(_index);
+        return true;
+    }));
+    EXPECT_EQ(small, (std::vector<uint64_t>{0, 1, 2, 3}));
+    std::ofstream(path) << lines;
+
+    // The handler stops the parsing
+    size_t count = 0;
+    EXPECT_NO_THROW(value::parse_file(path, 4, [&](uint64_t, parser_output&) { return ++count < 100; }));
+    EXPECT_EQ(count, 100);
+
+    // The first error in input order is thrown, after the documents before it
+    lines.replace(lines.find("{\"id\": 20000,"), 1, "[");
+    lines.replace(lines.find("{\"id\": 25000,"), 1, "[");
+    std::ofstream(path) << lines;
+    count = 0;
+    try {
+        value::parse_file(path, 4, [&](uint64_t, parser_output&) { count++; return true; });
+        FAIL() << "An invalid record must fail";
+    }
+    catch (const std::exception& e) {
+        EXPECT_NE(std::string(e.what()).find("@line:20021,"), std::string::npos) << e.what();
+    }
+    EXPECT_EQ(count, 20000);
+    std::remove(path.c_str());
+}
+
+TEST_F(ParserTest, ParallelArray) {
+    // Strings with the characters the pre-scan looks for, split over many parts
+    std::string json = "[\n";
+    for ( int i = 0; i < 20000; i++ ) {
+        if ( i > 0 ) json += ",\n";
+        json += "{\"id\": " + std::to_string(i) + ", \"text\": \"a, [b] {c} \\\"d\\\", e\\\\\", \"list\": [[1, 2], {\"k\": null}, \"]\"]}";
+    }
+    json += "\n]\n";
+    const std::string path = ::testing::TempDir() + "sid_json_parallel.json";
+    std::ofstream(path) << json;
+
+    parser_output expected;
+    ASSERT_NO_THROW(value::parse(expected, json));
+    for ( uint32_t threads : {2, 3, 8} ) {
+        parser_output out;
+        EXPECT_NO_THROW(value::parse_file(out, path, threads));
+        ASSERT_EQ(out.jroot.size(), 20000);
+        EXPECT_EQ(out.jroot.to_string(), expected.jroot.to_string());
+        EXPECT_EQ(out.stats.objects, expected.stats.objects);
+        EXPECT_EQ(out.stats.arrays, expected.stats.arrays);
+        EXPECT_EQ(out.stats.strings, expected.stats.strings);
+        EXPECT_EQ(out.stats.keys, expected.stats.keys);
+        EXPECT_EQ(out.stats.data_size, json.length());
+    }
+
+    // The error is the same as with one thread
+    auto error_of = [](const std::function<void()>& _parse) {
+        try { _parse(); }
+        catch (const std::exception& e) { return std::string(e.what()); }
+        return std::string();
+    };
+    std::string bad = json;
+    bad.replace(bad.find("{\"id\": 15000,"), 1, "}");
+    std::ofstream(path) << bad;
+    parser_output out;
+    const std::string error = error_of([&]() { value::parse(out, bad); });
+    EXPECT_FALSE(error.empty());
+    EXPECT_EQ(error_of([&]() { value::parse_file(out, path, 4); }), error);
+
+    // A missing ] is found in the last part
+    bad = json.substr(0, json.rfind(']'));
+    std::ofstream(path) << bad;
+    EXPECT_EQ(error_of([&]() { value::parse_file(out, path, 4); }), error_of([&]() { value::parse(out, bad); }));
+
+    // Comments and other roots are parsed by one thread
+    std::ofstream(path) << "// records\n" << json;
+    EXPECT_NO_THROW(value::parse_file(out, path, 4));
+    EXPECT_EQ(out.jroot.to_string(), expected.jroot.to_string());
+    std::ofstream(path) << "{\"records\": " << json << "}";
+    EXPECT_NO_THROW(value::parse_file(out, path, 4));
+    EXPECT_EQ(out.jroot["records"].to_string(), expected.jroot.to_string());
+    std::remove(path.c_str());
+}
+
+TEST_F(ParserTest, SaxEvents) {
+    // Records the events, and stops at the event given
+    struct recorder : sax_handler {
+        std::vector<std::string> events;
+        std::vector<const char*> views;
+        size_t stopAt = 0;
+        bool add(const std::string& _event) { events.push_back(_event); return events.size() != stopAt; }
+        bool start_object() override { return add("{"); }
+        bool key(std::string_view _key) override { views.push_back(_key.data()); return add("key:" + std::string(_key)); }
+        bool end_object() override { return add("}"); }
+        bool start_array() override { return add("["); }
+        bool end_array() override { return add("]"); }
+        bool string(std::string_view _val) override { views.push_back(_val.data()); return add("str:" + std::string(_val)); }
+        bool number(int64_t _val) override { return add("i64:" + std::to_string(_val)); }
+        bool number(uint64_t _val) override { return add("u64:" + std::to_string(_val)); }
+        bool number(long double _val) override { return add("dbl:" + std::to_string(static_cast<double>(_val))); }
+        bool boolean(bool _val) override { return add(_val? "true" : "false"); }
+        bool null() override { return add("null"); }
+    };
+    const std::string json = R"({"name": "plain", "esc\"key": "a\tb", "list": [-1, 18446744073709551615, 2.5, true, false, null, {}, []], "k": "v"})";
+    const std::vector<std::string> expected = {
+        "{", "key:name", "str:plain", "key:esc\"key", "str:a\tb", "key:list", "[", "i64:-1", "u64:18446744073709551615",
+        "dbl:2.500000", "true", "false", "null", "{", "}", "[", "]", "]", "key:k", "str:v", "}"
+    };
+
+    recorder rec;
+    parser_stats stats;
+    ASSERT_NO_THROW(stats = value::parse(rec, json));
+    EXPECT_EQ(rec.events, expected);
+    EXPECT_EQ(stats.objects, 2);
+    EXPECT_EQ(stats.arrays, 2);
+    EXPECT_EQ(stats.keys, 4);
+    EXPECT_EQ(stats.strings, 3);
+    EXPECT_EQ(stats.numbers, 3);
+    // The key and the string without escapes point into the input
+    EXPECT_EQ(rec.views[0], json.data() + json.find("name"));
+    EXPECT_EQ(rec.views[1], json.data() + json.find("plain"));
+
+    // The same events from a stream buffer
+    recorder srec;
+    std::stringbuf buf(json);
+    ASSERT_NO_THROW(value::parse(srec, buf));
+    EXPECT_EQ(srec.events, expected);
+
+    // A handler that returns false stops parsing, even before the input is complete
+    for ( size_t stopAt : {1, 3, 10, 15} ) {
+        recorder stopped;
+        stopped.stopAt = stopAt;
+        EXPECT_NO_THROW(value::parse(stopped, json.substr(0, json.length() - 5)));
+        EXPECT_EQ(stopped.events, std::vector<std::string>(expected.begin(), expected.begin() + stopAt));
+    }
+
+    // Errors are reported as when building a value
+    parser_output out;
+    for ( const std::string& bad : {std::string(R"({"a": [1, 2}})"), std::string(R"({"a": 1} x)"), std::string(R"({"a" 1})")} ) {
+        std::string error, saxError;
+        try { value::parse(out, bad); } catch (const std::exception& e) { error = e.what(); }
+        recorder brec;
+        try { value::parse(brec, bad); } catch (const std::exception& e) { saxError = e.what(); }
+        EXPECT_FALSE(error.empty());
+        EXPECT_EQ(saxError, error);
+    }
+}
+
+TEST_F(ParserTest, PullReader) {
+    const std::string json = R"({"id": 7, "esc\"key": "a\tb", "skip": {"x": [1, "]}", {"y": "\\"}], "z": // c ]
+        null}, "list": [-1, 2.5, true, [], {}], "last": "v"})";
+    auto read_all = [](reader& _reader, bool _skip) {
+        std::vector<std::string> tokens;
+        token tok;
+        while ( _reader.next(tok) ) {
+            std::string text = std::string(tok.depth, ' ') + std::string(tok.key) + ":" + to_str(tok.type);
+            if ( tok.type == token_type::string ) text += "=" + std::string(tok.str);
+            else if ( tok.type == token_type::_signed ) text += "=" + std::to_string(tok.i64);
+            else if ( tok.type == token_type::_unsigned ) text += "=" + std::to_string(tok.u64);
+            else if ( tok.type == token_type::_double ) text += "=" + std::to_string(static_cast<double>(tok.dbl));
+            else if ( tok.type == token_type::boolean ) text += tok.bval? "=true" : "=false";
+            tokens.push_back(text);
+            if ( _skip && tok.key == "skip" ) _reader.skip();
+        }
+        EXPECT_EQ(tok.type, token_type::end);
+        EXPECT_FALSE(_reader.next(tok));
+        return tokens;
+    };
+    const std::vector<std::string> expected = {
+        ":start_object", " id:unsigned=7", " esc\"key:string=a\tb", " skip:start_object",
+        " list:start_array", "  :signed=-1", "  :double=2.500000", "  :boolean=true",
+        "  :start_array", "  :end_array", "  :start_object", "  :end_object", " :end_array",
+        " last:string=v", ":end_object"
+    };
+    reader r(json);
+    EXPECT_EQ(read_all(r, true), expected);
+
+    // Without skipping, the skipped tokens are given
+    reader all(json);
+    std::vector<std::string> tokens = read_all(all, false);
+    EXPECT_EQ(tokens.size(), expected.size() + 9);
+    EXPECT_EQ(tokens[4], "  x:start_array");
+    EXPECT_EQ(tokens[12], " :end_object");
+
+    // The same tokens from a stream buffer, which is read in blocks
+    std::string big = "[";
+    for ( int i = 0; i < 2000; i++ ) big += json + ",";
+    big += "{\"end\": true}]";
+    std::stringbuf buf(big);
+    reader sr(buf);
+    token tok;
+    ASSERT_TRUE(sr.next(tok));
+    for ( int i = 0; i < 2000; i++ ) {
+        std::vector<std::string> part;
+        while ( sr.next(tok) ) {
+            if ( tok.key == "skip" ) sr.skip();
+            if ( tok.type == token_type::string ) part.push_back(std::string(tok.key) + "=" + std::string(tok.str));
+            if ( tok.depth == 1 && tok.type == token_type::end_object ) break;
+        }
+        ASSERT_EQ(part, std::vector<std::string>({"esc\"key=a\tb", "last=v"})) << i;
+    }
+
+    // The end of a skipped container must match its start, and the rest of the input is checked
+    auto error_of = [](const std::string& _json) {
+        try {
+            reader er(_json);
+            token etok;
+            while ( er.next(etok) )
+                if ( etok.key == "s" ) er.skip();
+        }
+        catch (const std::exception& e) { return std::string(e.what()); }
+        return std::string();
+    };
+    EXPECT_NE(error_of(R"({"s": [1, 2}})").find("Expected ]"), std::string::npos);
+    EXPECT_NE(error_of(R"({"s": [1, "]", {)").find("End of data reached"), std::string::npos);
+    EXPECT_FALSE(error_of(R"({"s": [1, "]"]} x)").empty());
+    EXPECT_TRUE(error_of(R"({"s": [1, "]"]})").empty());
+}
+
+TEST_F(ParserTest, LazyDocument) {
+    const std::string json = R"({"id": 42, "name": "a\"b", "skip": {"x": [1, "]}", {"y": "\\"}]},
+        "list": [-1, 2.5, true, null, {"k": "v"}], "dup": 1, "dup": 2})";
+    const std::string path = ::testing::TempDir() + "sid_json_lazy.json";
+    std::ofstream(path) << json;
+
+    lazy_document doc;
+    ASSERT_NO_THROW(value::parse_file(doc, path));
+    const lazy_value& root = doc.root();
+    EXPECT_TRUE(root.is_object());
+    EXPECT_EQ(root.size(), 5);
+    EXPECT_EQ(root["id"].get_uint64(), 42);
+    EXPECT_EQ(root["name"].get_str(), "a\"b");
+    EXPECT_EQ(root["dup"].get_int64(), 2);
+    EXPECT_TRUE(root.has_key("skip"));
+    EXPECT_FALSE(root.has_key("none"));
+    EXPECT_THROW(root["none"], std::exception);
+    // Nested values are the text of the input until they are accessed
+    EXPECT_EQ(root["skip"].text(), R"({"x": [1, "]}", {"y": "\\"}]})");
+    const lazy_value& list = doc["list"];
+    ASSERT_TRUE(list.is_array());
+    EXPECT_EQ(list.size(), 5);
+    EXPECT_EQ(list[0].get_int64(), -1);
+    EXPECT_DOUBLE_EQ(static_cast<double>(list[1].get_double()), 2.5);
+    EXPECT_TRUE(list[2].get_bool());
+    EXPECT_TRUE(list[3].is_null());
+    EXPECT_EQ(list[4]["k"].get_str(), "v");
+    EXPECT_THROW(list[5], std::exception);
+    EXPECT_EQ(root["skip"].to_value().to_string(), R"({"x":[1,"]}",{"y":"\\"}]})");
+
+    // The nesting and the rest of the input are checked when the file is parsed. The errors within
+    // a nested value are found, with their location in the file, when it is accessed.
+    auto error_of = [&](const std::string& _json, const std::string& _key) {
+        std::ofstream(path) << _json;
+        try {
+            lazy_document bad;
+            value::parse_file(bad, path);
+            if ( !_key.empty() ) bad[_key][0];
+        }
+        catch (const std::exception& e) { return std::string(e.what()); }
+        return std::string();
+    };
+    EXPECT_NE(error_of("{\"a\": [1, 2}]", "").find("Expected }"), std::string::npos);
+    EXPECT_NE(error_of("{\"a\": [1]} x", "").find("Invalid character [x]"), std::string::npos);
+    EXPECT_TRUE(error_of("{\"a\": [1,\n 2 3]}", "").empty());
+    EXPECT_NE(error_of("{\"a\": [1,\n 2 3]}", "a").find("@line:2"), std::string::npos);
+
+    // Duplicate keys follow the duplicate key policy, as they do when parsing into a value
+    const std::string dup = R"({"dup": 1, "x": 0, "dup": [2], "dup": {"k": 3}})";
+    std::ofstream(path) << dup;
+    auto lazy_dup = [&](parser_control::dup_key _dupKey) {
+        parser_control ctrl;
+        ctrl.dupKey = _dupKey;
+        lazy_document ldoc;
+        value::parse_file(ldoc, path, ctrl);
+        EXPECT_EQ(ldoc.root().size(), 2u);
+        EXPECT_EQ(ldoc.root().get_keys(), (std::vector<std::string>{"dup", "x"}));
+        // Scalars are written within an array
+        value jwrap;
+        jwrap.append(ldoc["dup"].to_value());
+        return jwrap.to_string();
+    };
+    EXPECT_EQ(lazy_dup(parser_control::dup_key::overwrite), R"([{"k":3}])");
+    EXPECT_EQ(lazy_dup(parser_control::dup_key::ignore), "[1]");
+    EXPECT_EQ(lazy_dup(parser_control::dup_key::append), R"([[1,[2],{"k":3}]])");
+    std::string rejected;
+    try { lazy_dup(parser_control::dup_key::reject); }
+    catch (const std::exception& e) { rejected = e.what(); }
+    EXPECT_NE(rejected.find("Duplicate key \"dup\""), std::string::npos);
+    EXPECT_NE(rejected.find("@line:1"), std::string::npos);
+    parser_control append;
+    append.dupKey = parser_control::dup_key::append;
+    lazy_document adoc;
+    value::parse_file(adoc, path, append);
+    EXPECT_EQ(adoc["dup"].size(), 3u);
+    EXPECT_EQ(adoc["dup"][1][0].get_int64(), 2);
+    EXPECT_EQ(adoc["dup"][2]["k"].get_int64(), 3);
+    EXPECT_TRUE(adoc["dup"].text().empty());
+    EXPECT_EQ(adoc.root().to_value().to_string(), R"({"dup":[1,[2],{"k":3}],"x":0})");
+    std::remove(path.c_str());
+}
+
+TEST_F(ParserTest, PathFilter) {
+    const std::string json = R"({"meta": {"id": 7, "tags": ["a", "b"], "a/b": 1, "x~y": 2},
+        "items": [{"price": 1, "name": "p"}, {"name": "q"}, {"price": 3, "sub": {"price": 9}}],
+        "big": {"nested": [[1, 2], {"s": "]}"}]}, "tail": "t"})";
+    auto parse_paths = [&](const std::vector<std::string>& _paths) {
+        parser_output out;
+        value::parse(out, json, _paths);
+        return out.jroot.to_string();
+    };
+    EXPECT_EQ(parse_paths({"/meta/id"}), R"({"meta":{"id":7}})");
+    EXPECT_EQ(parse_paths({"/meta/tags/1", "/tail"}), R"({"meta":{"tags":[null,"b"]},"tail":"t"})");
+    EXPECT_EQ(parse_paths({"/meta/a~1b", "/meta/x~0y"}), R"({"meta":{"a/b":1,"x~y":2}})");
+    EXPECT_EQ(parse_paths({"/items/*/price"}), R"({"items":[{"price":1},{},{"price":3}]})");
+    EXPECT_EQ(parse_paths({"/items/*/price", "/items/2/sub"}), R"({"items":[{"price":1},{},{"price":3,"sub":{"price":9}}]})");
+    EXPECT_EQ(parse_paths({"/big", "/big/nested/0"}), R"({"big":{"nested":[[1,2],{"s":"]}"}]}})");
+    EXPECT_EQ(parse_paths({"/none", "/meta/id/deeper"}), R"({"meta":{}})");
+    EXPECT_EQ(parse_paths({""}), parse_paths({"/meta", "/items", "/big", "/tail"}));
+    EXPECT_THROW(parse_paths({"meta"}), std::exception);
+    EXPECT_THROW(parse_paths({"/a~2"}), std::exception);
+
+    // The same from a stream buffer
+    parser_output out;
+    std::stringbuf buf(json);
+    ASSERT_NO_THROW(value::parse(out, buf, std::vector<std::string>{"/items/*/price", "/tail"}));
+    EXPECT_EQ(out.jroot.to_string(), R"({"items":[{"price":1},{},{"price":3}],"tail":"t"})");
+
+    // Parsing stops once the paths without wildcards are found when asked to. The rest is not
+    // checked.
+    parser_control stop;
+    stop.stopWhenFound = true;
+    const std::string bad = R"({"meta": {"id": 7}, "rest": [1, 2} "garbage)";
+    EXPECT_NO_THROW(value::parse(out, bad, {"/meta/id"}, stop));
+    EXPECT_EQ(out.jroot.to_string(), R"({"meta":{"id":7}})");
+    EXPECT_THROW(value::parse(out, bad, {"/meta/id"}), std::exception);
+    parser_control ignore;
+    ignore.dupKey = parser_control::dup_key::ignore;
+    EXPECT_THROW(value::parse(out, bad, {"/meta/id"}, ignore), std::exception);
+    EXPECT_THROW(value::parse(out, bad, {"/meta/id", "/rest"}, stop), std::exception);
+    EXPECT_THROW(value::parse(out, bad, {"/meta/*"}, stop), std::exception);
+
+    // A duplicate key after the path is found follows the duplicate key policy
+    const std::string dup = R"({"a": 1, "b": 0, "a": 2})";
+    auto parse_dup = [&](parser_control::dup_key _dupKey) {
+        parser_control ctrl;
+        ctrl.dupKey = _dupKey;
+        value::parse(out, dup, {"/a"}, ctrl);
+        return out.jroot.to_string();
+    };
+    EXPECT_EQ(parse_dup(parser_control::dup_key::overwrite), R"({"a":2})");
+    EXPECT_EQ(parse_dup(parser_control::dup_key::append), R"({"a":[1,2]})");
+    EXPECT_EQ(parse_dup(parser_control::dup_key::ignore), R"({"a":1})");
+    EXPECT_THROW(parse_dup(parser_control::dup_key::reject), std::exception);
+    // Stopping early keeps the first value
+    ASSERT_NO_THROW(value::parse(out, dup, {"/a"}, stop));
+    EXPECT_EQ(out.jroot.to_string(), R"({"a":1})");
+}
+
+TEST_F(ParserTest, UnicodeStrings) {
+    // The \u escapes are decoded to UTF-8, with or without the structural index
+    const std::string json = R"({"s": "a\u00e9\u20AC\ud83d\ude00b", "\u0041": 1})";
+    parser_control relaxed;
+    relaxed.mode.allowNocaseValues = true;
+    for ( const parser_control& ctrl : { parser_control(), relaxed } ) {
+        parser_output out;
+        value::parse(out, json, ctrl);
+        EXPECT_EQ(out.jroot["s"].get_str(), "a\xC3\xA9\xE2\x82\xAC\xF0\x9F\x98\x80" "b");
+        EXPECT_TRUE(out.jroot.has_key("A"));
+        for ( const char* bad : { R"(["\ud83d"])", R"(["\ud83dx"])", R"(["\ude00"])",
+                                  R"(["\ud83dA"])", R"(["\u00g0"])" } )
+            EXPECT_THROW(value::parse(out, bad, ctrl), std::runtime_error) << bad;
+    }
+
+    // UTF-8 is checked only when asked for. The invalid byte follows a long run of ASCII.
+    const std::string pad(40, 'x');
+    parser_control checked;
+    checked.checkUtf8 = true;
+    parser_output out;
+    EXPECT_NO_THROW(value::parse(out, "[\"" + pad + "\xC3\xA9\xF0\x9F\x98\x80\"]", checked));
+    for ( const char* bad : { "\xC3(", "\xC0\xAF", "\xED\xA0\x80", "\xF4\x90\x80\x80", "\xE2\x82" } ) {
+        const std::string data = "[\"" + pad + bad + "\"]";
+        EXPECT_NO_THROW(value::parse(out, data));
+        EXPECT_THROW(value::parse(out, data, checked), std::runtime_error);
+        EXPECT_THROW(value::parse(out, "{\"" + pad + bad + "\": 1}", checked), std::runtime_error);
+    }
+
+    // Output escapes ", \ and the control characters, and optionally all that is not ASCII
+    value::parse(out, json);
+    out.jroot["s"] = std::string("q\"\\\x01\xC3\xA9\xF0\x9F\x98\x80");
+    EXPECT_EQ(out.jroot.to_string(), "{\"s\":\"q\\\"\\\\\\u0001\xC3\xA9\xF0\x9F\x98\x80\",\"A\":1}");
+    format ascii;
+    ascii.escape_unicode = true;
+    const std::string written = out.jroot.to_string(ascii);
+    EXPECT_EQ(written, "{\"s\":\"q\\\"\\\\\\u0001\\u00e9\\ud83d\\ude00\",\"A\":1}");
+    parser_output back;
+    value::parse(back, written);
+    EXPECT_EQ(back.jroot["s"].get_str(), out.jroot["s"].get_str());
+    EXPECT_EQ(format::get("compact:escape-unicode").escape_unicode, true);
+}
+
+TEST_F(ParserTest, TryParse) {
+    parser_output out;
+    EXPECT_FALSE(value::try_parse(out, R"({"a": [1, 2.5, "x"]})"));
+    EXPECT_EQ(out.jroot["a"][1].get_double(), 2.5);
+
+    // The first error with the bytes parsed before it. Nothing is thrown for any of them.
+    struct expected { const char* json; parse_error::code id; uint64_t offset; };
+    parser_control strict;
+    strict.maxDepth = 2;
+    strict.dupKey = parser_control::dup_key::reject;
+    for ( const expected& e : std::initializer_list<expected>{
+            { "",                   parse_error::code::end_of_data,         0 },
+            { "1",                  parse_error::code::expected_root,       0 },
+            { R"({"a" 1})",         parse_error::code::expected_colon,      5 },
+            { R"({"a": 1,})",       parse_error::code::expected_key,        8 },
+            { R"({"a":1,})",        parse_error::code::expected_key,        7 },
+            { "[1,]",               parse_error::code::expected_element,    3 },
+            { "[1 2]",              parse_error::code::expected_separator,  3 },
+            { "[1] x",              parse_error::code::trailing_data,       4 },
+            { "[[[1]]]",            parse_error::code::max_depth,           2 },
+            { R"({"a":1,"a":2})",   parse_error::code::duplicate_key,       11 },
+            { R"(["a\q"])",         parse_error::code::invalid_escape,      4 },
+            { R"(["\u12"])",        parse_error::code::invalid_unicode,     6 },
+            { "[tru]",              parse_error::code::invalid_value,       4 },
+            { "[01]",               parse_error::code::invalid_number,      2 },
+            { "[1e99999]",          parse_error::code::number_out_of_range, 1 },
+            { "[1] /* x",           parse_error::code::invalid_comment,     8 } } ) {
+        const parse_error error = value::try_parse(out, e.json, strict);
+        EXPECT_EQ(error.id, e.id) << e.json;
+        EXPECT_EQ(error.offset, e.offset) << e.json;
+        std::stringbuf buf(e.json);
+        EXPECT_EQ(value::try_parse(out, buf, strict).id, e.id) << e.json;
+        EXPECT_THROW(value::parse(out, e.json, strict), std::runtime_error) << e.json;
+    }
+    EXPECT_EQ(value::try_parse(out, "[1 2]").message(), "Expected , or the end of the object or array at offset 3");
+    // A trailing , fails the same way with and without exceptions
+    for ( const auto& [json, start] : { std::make_pair("[1,]", "End of array character ] found"),
+                                        std::make_pair(R"({"a":1,})", "End of object character } found") } ) {
+        EXPECT_EQ(value::try_parse(out, json).message().rfind(start, 0), 0u) << json;
+        try {
+            value::parse(out, std::string(json));
+            FAIL() << json;
+        }
+        catch (const std::exception& e) {
+            EXPECT_EQ(std::string(e.what()).rfind(start, 0), 0u) << e.what();
+        }
+    }
+
+    // Schema violations are errors too
+    const schema s = schema::parse(std::string(R"({"type": "object", "properties": {"id": {"type": "integer"}}, "required": ["id"]})"));
+    EXPECT_FALSE(value::try_parse(out, R"({"id": 1})", s));
+    EXPECT_EQ(value::try_parse(out, R"({"name": 1})", s).id, parse_error::code::schema_violation);
+    EXPECT_EQ(value::try_parse(out, "[]", s).id, parse_error::code::schema_violation);
+
+    // The format options are converted without exceptions, which are thrown only for the result
+    EXPECT_EQ(format::get("pretty:indent= +3").indent, 3u);
+    for ( const char* bad : { "pretty:indent=3x", "pretty:indent=-1", "pretty:indent=4294967296", "compact:escape-unicode=1" } )
+        EXPECT_THROW(format::get(bad), std::runtime_error) << bad;
+}
+
+TEST_F(ParserTest, InternKeys) {
+    // Keys longer than 15 characters are stored out of line. Copies share them.
+    EXPECT_EQ(sizeof(key), 16u);
+    const key shortKey("fifteen_chars__"), longKey("sixteen_chars___");
+    EXPECT_FALSE(shortKey.is_shared());
+    EXPECT_TRUE(longKey.is_shared());
+    key copy(longKey);
+    EXPECT_EQ(copy.data(), longKey.data());
+    EXPECT_EQ(copy, "sixteen_chars___");
+    EXPECT_TRUE(shortKey < longKey);
+    EXPECT_EQ(key(std::string(longKey.view())).hash(), longKey.hash());
+
+    std::string json = "[";
+    for ( int i = 0; i < 100; i++ )
+        json += std::string(i? "," : "") + R"({"identifier_of_the_record": )" + std::to_string(i)
+              + R"(, "name": "n", "timestamp_of_creation": 0})";
+    json += "]";
+
+    parser_output plain;
+    value::parse(plain, json);
+    const uint64_t plainAllocations = plain.stats.allocations;
+
+    // The same long key is stored once for all the records, and for the next documents
+    parser_output out, next;
+    out.keys = next.keys = std::make_shared<key_table>();
+    value::parse(out, json);
+    EXPECT_EQ(out.keys->size(), 2u);
+    EXPECT_EQ(out.stats.allocations + 198, plainAllocations);
+    value::parse(next, json);
+    const key& first = out.jroot[0].get_object().begin()->first;
+    for ( const parser_output* o : { &out, &next } )
+        for ( size_t i = 0; i < 100; i++ ) {
+            const value::object_t& jmap = o->jroot[i].get_object();
+            EXPECT_EQ(jmap.begin()->first.data(), first.data());
+            EXPECT_FALSE(jmap.find("name")->first.is_shared());
+            EXPECT_EQ(o->jroot[i]["identifier_of_the_record"].get_int64(), static_cast<int64_t>(i));
+        }
+    EXPECT_EQ(out.jroot.to_string(), plain.jroot.to_string());
+
+    // Keys past the maximum size of the table are not interned
+    out.keys = std::make_shared<key_table>(1);
+    value::parse(out, json);
+    EXPECT_EQ(out.keys->size(), 1u);
+    EXPECT_EQ(out.jroot.to_string(), plain.jroot.to_string());
+    out.keys->clear();
+    EXPECT_EQ(out.keys->size(), 0u);
+}
+
+TEST_F(ParserTest, ArenaDocument) {
+    std::string json = "[";
+    for ( int i = 0; i < 200; i++ )
+        json += std::string(i? "," : "") + R"({"identifier_of_the_record": )" + std::to_string(i)
+              + R"(, "description": "a string that is too long to be kept in the value", "tags": ["x", "y"],)"
+              + R"( "dup": 1, "dup": "again", "nested": {"empty": {}, "list": []}})";
+    json += "]";
+    parser_output plain;
+
+    // All the storage of the document comes from the chunks of the arena
+    parser_output out;
+    out.memory = std::make_unique<arena>(nullptr, false, 4096);
+    parser_control ctrl;
+    ctrl.dupKey = parser_control::dup_key::append;
+    value::parse(plain, json, ctrl);
+    value::parse(out, json, ctrl);
+    EXPECT_EQ(out.jroot.to_string(), plain.jroot.to_string());
+    EXPECT_GT(out.memory->used(), 0u);
+    EXPECT_EQ(out.stats.allocations, out.memory->chunk_allocations());
+
+    // A copy is on the heap, and outlives the document
+    const value copy = out.jroot[7];
+    const key copiedKey = out.jroot[7].get_object().begin()->first;
+    EXPECT_FALSE(copiedKey.data() == out.jroot[7].get_object().begin()->first.data());
+
+    // The next document reuses the chunks
+    const size_t capacity = out.memory->capacity();
+    const uint64_t chunks = out.memory->chunk_allocations();
+    out.clear();
+    EXPECT_EQ(out.memory->used(), 0u);
+    value::parse(out, json, ctrl);
+    EXPECT_EQ(out.memory->capacity(), capacity);
+    EXPECT_EQ(out.memory->chunk_allocations(), chunks);
+    EXPECT_EQ(out.stats.allocations, 0u);
+    EXPECT_EQ(copy.to_string(), plain.jroot[7].to_string());
+    EXPECT_EQ(copiedKey, "identifier_of_the_record");
+
+    // Values of the heap added to the document are freed with it
+    out.jroot[3]["description"] = std::string("another string that is too long to be kept in the value");
+    out.jroot[3]["nested"]["list"].append(copy);
+    out.jroot.append(copy);
+    EXPECT_EQ(out.jroot.size(), 201u);
+    EXPECT_EQ(out.jroot[3]["nested"]["list"][0].to_string(), copy.to_string());
+    out.jroot[5] = out.jroot[6];
+    EXPECT_EQ(out.jroot[5].to_string(), plain.jroot[6].to_string());
+    out.clear();
+    EXPECT_TRUE(out.jroot.is_null());
+
+    // The chunks may come from another resource, or from huge pages
+    std::pmr::unsynchronized_pool_resource upstream;
+    out.memory = std::make_unique<arena>(&upstream);
+    value::parse(out, json, ctrl);
+    EXPECT_EQ(out.jroot.to_string(), plain.jroot.to_string());
+    out.clear();
+    out.memory = std::make_unique<arena>(nullptr, true);
+    value::parse(out, json, ctrl);
+    EXPECT_EQ(out.jroot.to_string(), plain.jroot.to_string());
+    EXPECT_EQ(out.memory->chunk_allocations(), 1u);
+}
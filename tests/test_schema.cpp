@@ -253,4 +253,58 @@ TEST_F(SchemaTest, PropertyConstraints) {
     
     EXPECT_EQ(prop.minProperties.value(), 1);
     EXPECT_EQ(prop.maxProperties.value(), 5);
-}
\ No newline at end of file
+}
+TEST_F(SchemaTest, ValidateWhileParsing) {
+    schema s = schema::parse(std::string(R"({
+        "type": "object",
+        "properties": {
+            "name": { "type": "string", "minLength": 1, "maxLength": 4 },
+            "age": { "type": "integer", "minimum": 0, "maximum": 150 },
+            "score": { "type": "number", "exclusiveMaximum": 10 },
+            "tags": { "type": "array", "minItems": 1, "maxItems": 2 },
+            "address": {
+                "type": ["object", "null"],
+                "maxProperties": 2,
+                "properties": { "city": { "type": "string" } },
+                "required": ["city"]
+            }
+        },
+        "required": ["name"]
+    })"));
+    parser_output out;
+
+    value::parse(out, R"({"name": "Ann", "age": 30, "score": 9.5, "tags": ["a", 1],
+                          "address": {"city": "X", "zip": 1}, "other": [true]})", s);
+    EXPECT_EQ(out.jroot["address"]["city"].get_str(), "X");
+    value::parse(out, R"({"name": "Ann", "address": null, "age": 7})", s);
+    EXPECT_EQ(out.jroot["age"].get_int64(), 7);
+    // Characters are counted, not bytes
+    value::parse(out, "{\"name\": \"\xC3\xA9\xC3\xA9\xC3\xA9\xC3\xA9\"}", s);
+
+    for ( const char* data : {
+            R"({"age": 1})",                                 // name is required
+            R"({"name": ""})",                               // minLength
+            R"({"name": "Annie"})",                          // maxLength
+            R"({"name": 5})",                                // type
+            R"({"name": "A", "age": -1})",                   // minimum
+            R"({"name": "A", "age": 151})",                  // maximum
+            R"({"name": "A", "age": 1.5})",                  // a double is not an integer
+            R"({"name": "A", "score": 10})",                 // exclusiveMaximum
+            R"({"name": "A", "tags": []})",                  // minItems
+            R"({"name": "A", "tags": [1, 2, 3]})",           // maxItems
+            R"({"name": "A", "tags": {}})",                  // type of a container
+            R"({"name": "A", "address": {"zip": 1}})",       // required in a nested object
+            R"({"name": "A", "address": {"city": "X", "a": 1, "b": 2}})", // maxProperties
+            R"([1])" } )                                     // type of the root
+    {
+        EXPECT_THROW(value::parse(out, data, s), std::runtime_error) << data;
+    }
+
+    // It fails at the first violation, before the rest of the input is parsed
+    try {
+        value::parse(out, R"({"name": 5, "age": 1, )", s);
+        FAIL() << "Expected a schema violation";
+    } catch (const std::runtime_error& e) {
+        EXPECT_NE(std::string(e.what()).find("Schema violation"), std::string::npos) << e.what();
+    }
+}
@@ -286,4 +286,168 @@ TEST_F(ValueTest, EraseErrorHandling)
   // Test erase non-existent key (should not throw)
   obj.erase("nonexistent");
   EXPECT_EQ(obj.size(), 1);
-}
\ No newline at end of file
+}
+
+TEST_F(ValueTest, CompactNode)
+{
+#ifndef SID_JSON_LONG_DOUBLE
+  EXPECT_EQ(sizeof(value), 16u);
+  EXPECT_EQ(alignof(value), alignof(double));
+#endif
+
+  // Strings of up to 14 characters are kept in place, longer ones out of line
+  const std::string shortStr(14, 's'), longStr(15, 'l');
+  value arr;
+  arr.append(shortStr);
+  arr.append(longStr);
+  arr.append("");
+  value copy(arr);
+  value moved(std::move(arr));
+  EXPECT_TRUE(arr.is_null());
+  for ( const value* jval : { &copy, &moved } )
+  {
+    EXPECT_EQ((*jval)[0].get_str(), shortStr);
+    EXPECT_EQ((*jval)[1].get_str_view(), longStr);
+    EXPECT_EQ((*jval)[2].get_str(), "");
+  }
+  copy[0] = copy[1];
+  moved[1] = std::move(moved[0]);
+  EXPECT_EQ(copy.to_string(), "[\"" + longStr + "\",\"" + longStr + "\",\"\"]");
+  EXPECT_EQ(moved[1].get_str(), shortStr);
+  EXPECT_THROW(moved[0].get_str_view(), std::runtime_error);
+
+  // Numbers are stored as double unless long double is enabled
+  value num(0.1);
+  EXPECT_EQ(num.get_double(), static_cast<value::number_t>(0.1));
+}
+
+TEST_F(ValueTest, ObjectLayouts)
+{
+  // More members than are searched one by one, in reverse key order
+  std::string json = "{";
+  for ( int i = 39; i >= 0; i-- )
+    json += "\"k" + std::to_string(10 + i) + "\":" + std::to_string(i) + ( i? "," : "}" );
+  format sorted;
+  sorted.sort_keys = true;
+
+  for ( const object_layout layout : { object_layout::ordered, object_layout::flat, object_layout::hash } )
+  {
+    parser_output out;
+    parser_control ctrl;
+    ctrl.objectLayout = layout;
+    value::parse(out, json, ctrl);
+    const value::object_t& jmap = out.jroot.get_object();
+    EXPECT_EQ(jmap.layout(), layout);
+    ASSERT_EQ(jmap.size(), 40u);
+    EXPECT_EQ(jmap.is_sorted(), layout == object_layout::flat);
+    // The order they are added in is kept unless the layout sorts them
+    EXPECT_EQ(jmap.begin()->first, layout == object_layout::flat? "k10" : "k49");
+    for ( int i = 0; i < 40; i++ )
+      EXPECT_EQ(out.jroot["k" + std::to_string(10 + i)].get_int64(), i);
+    EXPECT_FALSE(out.jroot.has_key("k50"));
+
+    value copy(out.jroot);
+    copy.erase("k30");
+    copy.erase("k49");
+    copy["new"] = "member";
+    EXPECT_EQ(copy.size(), 39u);
+    EXPECT_EQ(copy.get_object().layout(), layout);
+    EXPECT_FALSE(copy.has_key("k30"));
+    EXPECT_EQ(copy["k48"].get_int64(), 38);
+    EXPECT_EQ(copy["new"].get_str(), "member");
+    if ( layout == object_layout::ordered )
+    {
+      EXPECT_EQ((copy.get_object().end() - 1)->first, "new");
+    }
+
+    // Keys are sorted when writing only if it is asked for
+    std::string keys;
+    for ( int i = 0; i < 40; i++ )
+      keys += std::string(i? "," : "") + "\"k" + std::to_string(10 + i) + "\":" + std::to_string(i);
+    EXPECT_EQ(out.jroot.to_string(sorted), "{" + keys + "}");
+    EXPECT_EQ(out.jroot.to_string() == "{" + keys + "}", layout == object_layout::flat);
+  }
+  EXPECT_TRUE(format::get("compact:sort-keys").sort_keys);
+}
+
+TEST_F(ValueTest, OrderedObjectReferences)
+{
+  // The members of an ordered object are not moved when it grows past its capacity. The objects
+  // of a value are ordered unless the library is configured with another SID_JSON_OBJECT_LAYOUT.
+  if ( object::default_layout() != object_layout::ordered )
+    return;
+  value doc;
+  doc["a"] = "first";
+  doc["b"] = 2;
+  doc["c"] = doc["a"];
+  EXPECT_EQ(doc["c"].get_str(), "first");
+  value& a = doc["a"];
+  const value* b = &doc["b"];
+  for ( int i = 0; i < 100; i++ )
+    doc["k" + std::to_string(i)] = i;
+  EXPECT_EQ(&doc["a"], &a);
+  EXPECT_EQ(&doc["b"], b);
+  a = "hello";
+  EXPECT_EQ(doc["a"].get_str(), "hello");
+  EXPECT_EQ(doc["k99"].get_int64(), 99);
+
+  // Erased places are used again, and the order of the others is kept
+  doc.erase("b");
+  doc.erase("k50");
+  doc["x"] = doc["a"];
+  doc["y"] = doc["k0"];
+  EXPECT_EQ(&doc["a"], &a);
+  EXPECT_EQ(doc.size(), 103u);
+  const value::object_t& jmap = doc.get_object();
+  EXPECT_EQ(jmap.begin()->first, "a");
+  EXPECT_EQ((jmap.begin() + 1)->first, "c");
+  EXPECT_EQ((jmap.end() - 1)->first, "y");
+  EXPECT_EQ(jmap.end() - jmap.begin(), 103);
+  EXPECT_EQ(doc["x"].get_str(), "hello");
+
+  // A copy has members of its own
+  value copy(doc);
+  EXPECT_NE(&copy["a"], &a);
+  EXPECT_EQ(copy.to_string(), doc.to_string());
+}
+
+TEST_F(ValueTest, MoveSemantics)
+{
+  // A long string keeps its characters when it is moved into a value
+  std::string text(100, 't');
+  const char* chars = text.data();
+  value jstr(std::move(text));
+  EXPECT_EQ(jstr.get_str_view().data(), chars);
+  std::string other(100, 'o');
+  chars = other.data();
+  jstr = std::move(other);
+  EXPECT_EQ(jstr.get_str_view().data(), chars);
+
+  // Elements and members are moved, not copied, into containers and when arrays grow
+  value arr;
+  arr.append(std::move(jstr));
+  EXPECT_TRUE(jstr.is_null());
+  for ( int i = 0; i < 100; i++ )
+    arr.emplace_back(std::string(50, 'a' + i % 26));
+  EXPECT_EQ(arr[0].get_str_view().data(), chars);
+  value doc;
+  doc.emplace("list", std::move(arr));
+  doc.emplace("copy", doc["list"]);
+  EXPECT_TRUE(arr.is_null());
+  EXPECT_EQ(doc["list"][0].get_str_view().data(), chars);
+  EXPECT_NE(doc["copy"][0].get_str_view().data(), chars);
+  EXPECT_EQ(doc["list"].size(), 101u);
+
+  // The value moved may be within the container it is moved to
+  doc["list"].append(std::move(doc["list"][0]));
+  EXPECT_TRUE(doc["list"][0].is_null());
+  EXPECT_EQ(doc["list"][101].get_str_view().data(), chars);
+  doc.emplace("first", std::move(doc["list"][101]));
+  EXPECT_EQ(doc["first"].get_str_view().data(), chars);
+  value& item = doc["list"].emplace_back(value_type::object);
+  item.emplace("n", 5);
+  EXPECT_EQ(doc["list"][102].to_string(), "{\"n\":5}");
+  doc.append(std::move(doc));
+  EXPECT_TRUE(doc.is_array());
+  EXPECT_EQ(doc[0]["first"].get_str_view().data(), chars);
+}